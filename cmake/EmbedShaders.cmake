@@ -0,0 +1,52 @@
+# Compiles every shader of SHADER_DIR to SPIR-V with GLSLANG_VALIDATOR and
+# embeds the binaries as constexpr uint32_t arrays in the OUTPUT header.
+#
+#   cmake -DGLSLANG_VALIDATOR=<exe> -DSHADER_DIR=<dir> -DOUTPUT=<header> -P EmbedShaders.cmake
+#
+# shaders/shader.vert becomes ktw::shaders::shader_vert, and
+# ktw::shaders::shader_vert_source keeps the GLSL path for the runtime dev mode.
+
+file(GLOB SHADERS
+	"${SHADER_DIR}/*.vert"
+	"${SHADER_DIR}/*.tesc"
+	"${SHADER_DIR}/*.tese"
+	"${SHADER_DIR}/*.geom"
+	"${SHADER_DIR}/*.frag"
+	"${SHADER_DIR}/*.comp"
+)
+
+get_filename_component(OUTPUT_DIR ${OUTPUT} DIRECTORY)
+file(MAKE_DIRECTORY ${OUTPUT_DIR})
+
+set(CONTENT "#pragma once\n\n// Generated by cmake/EmbedShaders.cmake, do not edit\n\n#include <cstdint>\n\nnamespace ktw::shaders {\n")
+
+foreach(SHADER ${SHADERS})
+	get_filename_component(NAME ${SHADER} NAME)
+	string(MAKE_C_IDENTIFIER ${NAME} IDENTIFIER)
+	set(SPIRV ${OUTPUT_DIR}/${NAME}.spv)
+
+	execute_process(
+		COMMAND ${GLSLANG_VALIDATOR} -V ${SHADER} -o ${SPIRV}
+		RESULT_VARIABLE RESULT
+		OUTPUT_VARIABLE LOG
+		ERROR_VARIABLE LOG
+	)
+	if(NOT RESULT EQUAL 0)
+		message(FATAL_ERROR "Failed to compile ${SHADER}:\n${LOG}")
+	endif()
+
+	# SPIR-V words are little-endian
+	file(READ ${SPIRV} HEX HEX)
+	string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " WORDS "${HEX}")
+	string(REGEX REPLACE "((0x[0-9a-f]+, ){8})" "\\1\n\t\t" WORDS "${WORDS}")
+
+	string(APPEND CONTENT "\tconstexpr uint32_t ${IDENTIFIER}[] = {\n\t\t${WORDS}\n\t};\n")
+	string(APPEND CONTENT "\tconstexpr const char* ${IDENTIFIER}_source = \"${SHADER}\";\n\n")
+endforeach()
+
+string(APPEND CONTENT "}\n")
+
+# Only touch the header when the SPIR-V changed, so dependents are not rebuilt for nothing
+file(WRITE ${OUTPUT}.tmp "${CONTENT}")
+configure_file(${OUTPUT}.tmp ${OUTPUT} COPYONLY)
+file(REMOVE ${OUTPUT}.tmp)
@@ -26,8 +26,14 @@ project "ktwVulkanGameEngine"
 		"src/**.cpp"
 	}
 
+	-- Compile shaders to SPIR-V and embed them in a generated header
+	prebuildcommands {
+		"cmake -DGLSLANG_VALIDATOR=\"$(VULKAN_SDK)/Bin/glslangValidator\" -DSHADER_DIR=\"%{wks.location}/shaders\" -DOUTPUT=\"%{wks.location}/bin-generated/ktwVulkanGameEngine/EmbeddedShaders.hpp\" -P \"%{wks.location}/cmake/EmbedShaders.cmake\""
+	}
+
 	includedirs {
 		"src",
+		"bin-generated",
 		"vendor/spdlog/include",
 		"vendor/glfw/include",
 		"vendor/glm",
@@ -48,8 +54,107 @@ project "ktwVulkanGameEngine"
 	filter "system:windows"
 		systemversion "latest"
 
+	filter "configurations:Debug"
+		symbols "on"
+		defines { "KTW_RUNTIME_SHADERS" }
+
+	filter "configurations:Release"
+		optimize "on"
+project "MeshConverter"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "on"
+
+	targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("bin-obj/" .. outputdir .. "/%{prj.name}")
+
+	files {
+		"tools/MeshConverter/**.cpp",
+		"src/ktwVulkanGameEngine/MeshFormat.hpp",
+		"src/ktwVulkanGameEngine/MeshOptimizer.hpp",
+		"src/ktwVulkanGameEngine/MeshOptimizer.cpp",
+		"src/ktwVulkanGameEngine/MeshletBuilder.hpp",
+		"src/ktwVulkanGameEngine/MeshletBuilder.cpp",
+		"src/ktwVulkanGameEngine/MeshSimplifier.hpp",
+		"src/ktwVulkanGameEngine/MeshSimplifier.cpp",
+		"src/ktwVulkanGameEngine/Quantization.hpp",
+		"src/ktwVulkanGameEngine/Quantization.cpp"
+	}
+
+	includedirs {
+		"src",
+		"src/ktwVulkanGameEngine",
+		"vendor/spdlog/include",
+		"vendor/glm"
+	}
+
+	filter "configurations:Debug"
+		symbols "on"
+
+	filter "configurations:Release"
+		optimize "on"
+project "CullingBenchmark"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "on"
+
+	targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("bin-obj/" .. outputdir .. "/%{prj.name}")
+
+	files {
+		"tools/CullingBenchmark/**.cpp",
+		"src/ktwVulkanGameEngine/FrustumCuller.hpp",
+		"src/ktwVulkanGameEngine/FrustumCuller.cpp",
+		"src/ktwVulkanGameEngine/JobSystem.hpp",
+		"src/ktwVulkanGameEngine/JobSystem.cpp",
+		"src/ktwVulkanGameEngine/Log.hpp",
+		"src/ktwVulkanGameEngine/Log.cpp"
+	}
+
+	includedirs {
+		"src",
+		"src/ktwVulkanGameEngine",
+		"vendor/spdlog/include",
+		"vendor/glm"
+	}
+
+	filter "configurations:Debug"
+		symbols "on"
+
+	filter "configurations:Release"
+		optimize "on"
+project "BvhBenchmark"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "on"
+
+	targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("bin-obj/" .. outputdir .. "/%{prj.name}")
+
+	files {
+		"tools/BvhBenchmark/**.cpp",
+		"src/ktwVulkanGameEngine/DynamicBvh.hpp",
+		"src/ktwVulkanGameEngine/DynamicBvh.cpp",
+		"src/ktwVulkanGameEngine/FrustumCuller.hpp",
+		"src/ktwVulkanGameEngine/FrustumCuller.cpp",
+		"src/ktwVulkanGameEngine/JobSystem.hpp",
+		"src/ktwVulkanGameEngine/JobSystem.cpp",
+		"src/ktwVulkanGameEngine/Log.hpp",
+		"src/ktwVulkanGameEngine/Log.cpp"
+	}
+
+	includedirs {
+		"src",
+		"src/ktwVulkanGameEngine",
+		"vendor/spdlog/include",
+		"vendor/glm"
+	}
+
 	filter "configurations:Debug"
 		symbols "on"
 
 	filter "configurations:Release"
-		optimize "on"
\ No newline at end of file
+		optimize "on"
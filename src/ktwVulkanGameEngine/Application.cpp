@@ -45,7 +45,11 @@ namespace ktw {
 
 		swapChain = std::make_unique<ktw::SwapChain>(*context);
 
-		renderer = std::make_unique<ktw::Renderer>(*context);
+		renderer = std::make_unique<ktw::Renderer>(*context, jobSystem);
+
+#ifdef KTW_RUNTIME_SHADERS
+		renderer->enableShaderHotReload();
+#endif
 	}
 
 	void Application::mainLoop() {
@@ -87,4 +91,12 @@ namespace ktw {
 	ktw::SwapChain* Application::getSwapchain() {
 		return &(*swapChain);
 	}
+
+	ktw::World& Application::getWorld() {
+		return world;
+	}
+
+	ktw::JobSystem& Application::getJobSystem() {
+		return jobSystem;
+	}
 }
\ No newline at end of file
@@ -11,6 +11,8 @@
 #include "Instance.hpp"
 #include "Context.hpp"
 #include "SwapChain.hpp"
+#include "World.hpp"
+#include "JobSystem.hpp"
 
 namespace ktw {
 	class Application {
@@ -19,6 +21,10 @@ namespace ktw {
 		~Application();
 		void run();
 		ktw::SwapChain* getSwapchain();
+		// Scene state, entities only reference the meshes and pipelines the subclass owns
+		ktw::World& getWorld();
+		// Worker threads shared with the engine, userUpdate can split its work over them
+		ktw::JobSystem& getJobSystem();
 
 	private:
 		virtual void userSetup(ktw::Renderer& renderer) = 0;
@@ -36,7 +42,10 @@ namespace ktw {
 		std::unique_ptr<ktw::Instance> instance;
 		std::unique_ptr<ktw::Context> context;
 		std::unique_ptr<ktw::SwapChain> swapChain;
+		// Declared before the renderer, whose destruction may still wait on jobs
+		ktw::JobSystem jobSystem;
 		std::unique_ptr<ktw::Renderer> renderer;
+		ktw::World world;
 	};
 }
 
@@ -0,0 +1,141 @@
+#include "pch.hpp"
+#include "BindlessHeap.hpp"
+
+namespace ktw {
+	BindlessHeap::BindlessHeap(ktw::Context& context, ktw::LayoutCache& layoutCache, uint32_t maxStorageBuffers, uint32_t maxCombinedImageSamplers) : context(context) {
+		if(!context.supportsDescriptorIndexing()) {
+			throw std::runtime_error("bindless mode needs descriptor indexing (Vulkan 1.2), not supported by this GPU");
+		}
+
+		auto limits = context.getPhysicalDevice().getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceDescriptorIndexingProperties>().get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+		storageBuffers = {std::min({maxStorageBuffers, limits.maxDescriptorSetUpdateAfterBindStorageBuffers, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers}), 0, {}, {}};
+		// Combined image samplers count both as sampled images and as samplers
+		combinedImageSamplers = {std::min({maxCombinedImageSamplers, limits.maxDescriptorSetUpdateAfterBindSampledImages, limits.maxPerStageDescriptorUpdateAfterBindSampledImages, limits.maxDescriptorSetUpdateAfterBindSamplers, limits.maxPerStageDescriptorUpdateAfterBindSamplers}), 0, {}, {}};
+
+		std::vector<vk::DescriptorSetLayoutBinding> bindings = {
+			vk::DescriptorSetLayoutBinding(storageBufferBinding, vk::DescriptorType::eStorageBuffer, storageBuffers.capacity, vk::ShaderStageFlagBits::eAllGraphics),
+			vk::DescriptorSetLayoutBinding(combinedImageSamplerBinding, vk::DescriptorType::eCombinedImageSampler, combinedImageSamplers.capacity, vk::ShaderStageFlagBits::eAllGraphics)
+		};
+
+		// Slots are filled and emptied while the set is bound, and most are never written
+		std::vector<vk::DescriptorBindingFlags> bindingFlags(bindings.size(), vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending | vk::DescriptorBindingFlagBits::ePartiallyBound);
+
+		auto bindingFlagsInfo = vk::DescriptorSetLayoutBindingFlagsCreateInfo()
+			.setBindingCount(static_cast<uint32_t>(bindingFlags.size()))
+			.setPBindingFlags(bindingFlags.data());
+
+		auto layoutInfo = vk::DescriptorSetLayoutCreateInfo()
+			.setPNext(&bindingFlagsInfo)
+			.setFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool)
+			.setBindingCount(static_cast<uint32_t>(bindings.size()))
+			.setPBindings(bindings.data());
+
+		layout = context.getDevice().createDescriptorSetLayoutUnique(layoutInfo);
+
+		vk::DescriptorPoolSize poolSizes[] = {
+			{vk::DescriptorType::eStorageBuffer, storageBuffers.capacity},
+			{vk::DescriptorType::eCombinedImageSampler, combinedImageSamplers.capacity}
+		};
+
+		auto poolInfo = vk::DescriptorPoolCreateInfo()
+			.setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind)
+			.setPoolSizeCount(2)
+			.setPPoolSizes(poolSizes)
+			.setMaxSets(1);
+
+		pool = context.getDevice().createDescriptorPoolUnique(poolInfo);
+
+		auto allocInfo = vk::DescriptorSetAllocateInfo()
+			.setDescriptorPool(*pool)
+			.setDescriptorSetCount(1)
+			.setPSetLayouts(&(*layout));
+
+		descriptorSet = context.getDevice().allocateDescriptorSets(allocInfo)[0];
+
+		layoutCache.setBindlessLayout(*layout, bindings);
+		pipelineLayout = layoutCache.getPipelineLayout({*layout}, 0);
+
+		LOG_TRACE("Bindless Heap Created ({} storage buffers, {} combined image samplers)", storageBuffers.capacity, combinedImageSamplers.capacity);
+	}
+
+	uint32_t BindlessHeap::allocateSlot(Slots& slots) {
+		if(!slots.freeIndices.empty()) {
+			uint32_t index = slots.freeIndices.back();
+			slots.freeIndices.pop_back();
+			return index;
+		}
+
+		if(slots.next == slots.capacity) {
+			throw std::runtime_error("bindless heap is full");
+		}
+		return slots.next++;
+	}
+
+	uint32_t BindlessHeap::addStorageBuffer(ktw::Buffer& buffer) {
+		uint32_t index = allocateSlot(storageBuffers);
+
+		auto bufferInfo = vk::DescriptorBufferInfo()
+			.setBuffer(buffer.getBuffer())
+			.setOffset(0)
+			.setRange(VK_WHOLE_SIZE);
+
+		auto write = vk::WriteDescriptorSet()
+			.setDstSet(descriptorSet)
+			.setDstBinding(storageBufferBinding)
+			.setDstArrayElement(index)
+			.setDescriptorCount(1)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setPBufferInfo(&bufferInfo);
+
+		context.getDevice().updateDescriptorSets(1, &write, 0, nullptr);
+		return index;
+	}
+
+	uint32_t BindlessHeap::addCombinedImageSampler(vk::ImageView imageView, vk::Sampler sampler) {
+		uint32_t index = allocateSlot(combinedImageSamplers);
+
+		auto imageInfo = vk::DescriptorImageInfo()
+			.setImageView(imageView)
+			.setSampler(sampler)
+			.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+
+		auto write = vk::WriteDescriptorSet()
+			.setDstSet(descriptorSet)
+			.setDstBinding(combinedImageSamplerBinding)
+			.setDstArrayElement(index)
+			.setDescriptorCount(1)
+			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+			.setPImageInfo(&imageInfo);
+
+		context.getDevice().updateDescriptorSets(1, &write, 0, nullptr);
+		return index;
+	}
+
+	uint32_t BindlessHeap::addTexture(ktw::Texture& texture) {
+		return addCombinedImageSampler(texture.getImageView(), texture.getSampler());
+	}
+
+	void BindlessHeap::removeStorageBuffer(uint32_t index) {
+		storageBuffers.retiredIndices.push_back(index);
+	}
+
+	void BindlessHeap::removeCombinedImageSampler(uint32_t index) {
+		combinedImageSamplers.retiredIndices.push_back(index);
+	}
+
+	void BindlessHeap::recycle() {
+		// Called once the frame is rendered, nothing reads the retired slots anymore
+		for(auto slots : {&storageBuffers, &combinedImageSamplers}) {
+			slots->freeIndices.insert(slots->freeIndices.end(), slots->retiredIndices.begin(), slots->retiredIndices.end());
+			slots->retiredIndices.clear();
+		}
+	}
+
+	vk::DescriptorSet BindlessHeap::getDescriptorSet() {
+		return descriptorSet;
+	}
+
+	vk::PipelineLayout BindlessHeap::getPipelineLayout() {
+		return pipelineLayout;
+	}
+}
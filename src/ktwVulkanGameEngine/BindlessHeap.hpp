@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Context.hpp"
+#include "Buffer.hpp"
+#include "Texture.hpp"
+#include "LayoutCache.hpp"
+
+namespace ktw {
+	// One update-after-bind descriptor set holding large arrays of every
+	// resource type. Shaders declare it as set 0 and address resources by the
+	// index returned when adding them, passed through push constants or
+	// instance data:
+	//
+	//   layout(set = 0, binding = 0) buffer Buffers { ... } buffers[];
+	//   layout(set = 0, binding = 1) uniform sampler2D textures[];
+	class BindlessHeap {
+	public:
+		static const uint32_t storageBufferBinding = 0;
+		static const uint32_t combinedImageSamplerBinding = 1;
+
+		BindlessHeap(ktw::Context& context, ktw::LayoutCache& layoutCache, uint32_t maxStorageBuffers, uint32_t maxCombinedImageSamplers);
+		uint32_t addStorageBuffer(ktw::Buffer& buffer);
+		uint32_t addCombinedImageSampler(vk::ImageView imageView, vk::Sampler sampler);
+		uint32_t addTexture(ktw::Texture& texture);
+		void removeStorageBuffer(uint32_t index);
+		void removeCombinedImageSampler(uint32_t index);
+		void recycle();
+		vk::DescriptorSet getDescriptorSet();
+		vk::PipelineLayout getPipelineLayout();
+
+	private:
+		struct Slots {
+			uint32_t capacity;
+			uint32_t next;
+			std::vector<uint32_t> freeIndices;
+			// Removed this frame, may still be read by commands in flight
+			std::vector<uint32_t> retiredIndices;
+		};
+
+		ktw::Context& context;
+		vk::UniqueDescriptorSetLayout layout;
+		vk::UniqueDescriptorPool pool;
+		vk::DescriptorSet descriptorSet;
+		vk::PipelineLayout pipelineLayout;
+		Slots storageBuffers;
+		Slots combinedImageSamplers;
+
+		uint32_t allocateSlot(Slots& slots);
+	};
+}
@@ -1,8 +1,10 @@
 #include "pch.hpp"
 #include "Buffer.hpp"
 
+#include <limits>
+
 namespace ktw {
-	Buffer::Buffer(ktw::Context& context, uint32_t itemSize, uint32_t count, ktw::BufferUsage usage, void* data) : itemSize(itemSize), count(count), context(context) {
+	Buffer::Buffer(ktw::Context& context, uint32_t itemSize, uint32_t count, ktw::BufferUsage usage, void* data) : itemSize(itemSize), count(count), context(context), id(context.createResourceId()) {
 		auto bufferInfo = vk::BufferCreateInfo()
 			.setSize(itemSize * count)
 			.setUsage((vk::BufferUsageFlagBits) usage)
@@ -27,6 +29,27 @@ namespace ktw {
 		LOG_TRACE("Buffer Created");
 	}
 
+	namespace {
+		uint32_t indexSize(const uint32_t* indices, uint32_t count) {
+			uint32_t maxIndex = count > 0 ? *std::max_element(indices, indices + count) : 0;
+			return maxIndex <= std::numeric_limits<uint16_t>::max() ? sizeof(uint16_t) : sizeof(uint32_t);
+		}
+	}
+
+	Buffer::Buffer(ktw::Context& context, const uint32_t* indices, uint32_t count) : Buffer(context, indexSize(indices, count), count, ktw::BufferUsage::eIndexBuffer, nullptr) {
+		if(itemSize == sizeof(uint16_t)) {
+			std::vector<uint16_t> narrowIndices(indices, indices + count);
+			setData(narrowIndices.data());
+		}
+		else {
+			setData(const_cast<uint32_t*>(indices));
+		}
+	}
+
+	Buffer::~Buffer() {
+		context.destroyResourceId(id);
+	}
+
 	uint32_t Buffer::findMemoryType(ktw::Context& context, uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
 		vk::PhysicalDeviceMemoryProperties memProperties = context.getPhysicalDevice().getMemoryProperties();
 		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
@@ -50,9 +73,27 @@ namespace ktw {
 		return count;
 	}
 
+	uint64_t Buffer::getId() {
+		return id;
+	}
+
+	vk::IndexType Buffer::getIndexType() {
+		return itemSize == sizeof(uint16_t) ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+	}
+
+	void* Buffer::getMappedData() {
+		// Freeing the memory unmaps it, there is nothing to undo in the destructor
+		if(!mappedData) {
+			mappedData = context.getDevice().mapMemory(*bufferMemory, 0, VK_WHOLE_SIZE);
+		}
+		return mappedData;
+	}
+
+	void Buffer::setData(const void* data, vk::DeviceSize offset, vk::DeviceSize size) {
+		memcpy(static_cast<uint8_t*>(getMappedData()) + offset, data, (size_t) size);
+	}
+
 	void Buffer::setData(void* data) {
-		void* bufferData = context.getDevice().mapMemory(*bufferMemory, 0, itemSize*count);
-		memcpy(bufferData, data, (size_t) itemSize*count);
-		context.getDevice().unmapMemory(*bufferMemory);
+		memcpy(getMappedData(), data, (size_t) itemSize*count);
 	}
 }
\ No newline at end of file
@@ -6,24 +6,37 @@ namespace ktw {
 	enum BufferUsage {
 		eVertexBuffer = vk::BufferUsageFlagBits::eVertexBuffer,
 		eIndexBuffer = vk::BufferUsageFlagBits::eIndexBuffer,
-		eUniformBuffer = vk::BufferUsageFlagBits::eUniformBuffer
+		eUniformBuffer = vk::BufferUsageFlagBits::eUniformBuffer,
+		eStorageBuffer = vk::BufferUsageFlagBits::eStorageBuffer,
+		eIndirectBuffer = vk::BufferUsageFlagBits::eIndirectBuffer,
+		eTransferSrc = vk::BufferUsageFlagBits::eTransferSrc
 	};
 	
 	class Buffer {
 	public:
 		Buffer(ktw::Context& context, uint32_t itemSize, uint32_t count, ktw::BufferUsage usage, void* data);
+		// Index buffer, narrowed to 16-bit indices when they all fit
+		Buffer(ktw::Context& context, const uint32_t* indices, uint32_t count);
+		~Buffer();
 
 		vk::Buffer& getBuffer();
 		uint32_t getItemSize();
 		uint32_t getCount();
+		uint64_t getId();
+		vk::IndexType getIndexType();
 		void setData(void* data);
+		void setData(const void* data, vk::DeviceSize offset, vk::DeviceSize size);
+		// The memory is host coherent and stays mapped once this was called
+		void* getMappedData();
+
+		static uint32_t findMemoryType(ktw::Context& context, uint32_t typeFilter, vk::MemoryPropertyFlags properties);
 	private:
 		ktw::Context& context;
 		vk::UniqueBuffer buffer;
 		vk::UniqueDeviceMemory bufferMemory;
 		uint32_t count;
 		uint32_t itemSize;
-
-		uint32_t findMemoryType(ktw::Context& context, uint32_t typeFilter, vk::MemoryPropertyFlags properties);
+		uint64_t id;
+		void* mappedData = nullptr;
 	};
 }
\ No newline at end of file
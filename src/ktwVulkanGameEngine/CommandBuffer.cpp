@@ -2,27 +2,155 @@
 #include "CommandBuffer.hpp"
 
 namespace ktw {
-	CommandBuffer::CommandBuffer(ktw::FrameBuffer& framebuffer, vk::CommandBuffer commandBuffer) : commandBuffer(commandBuffer) {
-		vk::ClearValue clearColor(vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}));
-		vk::Rect2D renderArea = { {0, 0}, {framebuffer.getWidth(), framebuffer.getHeight()} };
-		
+	CommandBuffer::CommandBuffer(ktw::Context& context, ktw::FrameBuffer& framebuffer, vk::CommandBuffer commandBuffer) :
+		context(&context),
+		framebuffer(&framebuffer),
+		commandBuffer(commandBuffer),
+		multiDrawIndirect(context.supportsMultiDrawIndirect())
+	{
 		auto beginInfo = vk::CommandBufferBeginInfo()
 			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
 
 		commandBuffer.begin(beginInfo);
+	}
+
+	void CommandBuffer::beginRenderPass() {
+		if(insideRenderPass) {
+			return;
+		}
+
+		if(computeWritesPending) {
+			// One barrier for all the dispatches, they run concurrently before it
+			auto barrier = vk::MemoryBarrier()
+				.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+				.setDstAccessMask(vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eShaderRead);
+
+			commandBuffer.pipelineBarrier(
+				vk::PipelineStageFlagBits::eComputeShader,
+				vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader,
+				{}, barrier, nullptr, nullptr
+			);
+			computeWritesPending = false;
+		}
+
+		insideRenderPass = true;
+		if(!framebuffer->getRenderPass()) {
+			beginRendering();
+			return;
+		}
+
+		vk::ClearValue clearValues[] = {
+			vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}),
+			vk::ClearDepthStencilValue(1.0f, 0)
+		};
+		vk::Rect2D renderArea = { {0, 0}, {framebuffer->getWidth(), framebuffer->getHeight()} };
 
 		auto renderPassInfo = vk::RenderPassBeginInfo()
-				.setRenderPass(framebuffer.getRenderPass())
-				.setFramebuffer(framebuffer.getHandle())
+				.setRenderPass(framebuffer->getRenderPass())
+				.setFramebuffer(framebuffer->getHandle())
 				.setRenderArea(renderArea)
-				.setClearValueCount(1)
-				.setPClearValues(&clearColor);
+				.setClearValueCount(framebuffer->getDepthFormat() == vk::Format::eUndefined ? 1 : 2)
+				.setPClearValues(clearValues);
 
 		commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
 	}
 
+	void CommandBuffer::beginRendering() {
+		// The layout transitions the render pass did, the previous content is cleared anyway
+		ktw::DepthBuffer* depthBuffer = framebuffer->getDepthBuffer();
+		std::vector<vk::ImageMemoryBarrier> barriers = {
+			vk::ImageMemoryBarrier()
+				.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+				.setOldLayout(vk::ImageLayout::eUndefined)
+				.setNewLayout(vk::ImageLayout::eColorAttachmentOptimal)
+				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setImage(framebuffer->getImage())
+				.setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1})
+		};
+		if(depthBuffer) {
+			// The depth buffer is shared, the previous frame's depth tests finish before it is cleared
+			barriers.push_back(vk::ImageMemoryBarrier()
+				.setSrcAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+				.setDstAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+				.setOldLayout(vk::ImageLayout::eUndefined)
+				.setNewLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setImage(depthBuffer->getImage())
+				.setSubresourceRange({depthBuffer->getAspectMask(), 0, 1, 0, 1}));
+		}
+
+		commandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests,
+			vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+			{}, nullptr, nullptr, barriers
+		);
+
+		auto colorAttachment = vk::RenderingAttachmentInfoKHR()
+			.setImageView(framebuffer->getImageView())
+			.setImageLayout(vk::ImageLayout::eColorAttachmentOptimal)
+			.setLoadOp(vk::AttachmentLoadOp::eClear)
+			.setStoreOp(vk::AttachmentStoreOp::eStore)
+			.setClearValue(vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}));
+
+		// Cleared each frame and never read back, so it is not stored
+		auto depthAttachment = vk::RenderingAttachmentInfoKHR()
+			.setImageView(depthBuffer ? depthBuffer->getImageView() : vk::ImageView())
+			.setImageLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+			.setLoadOp(vk::AttachmentLoadOp::eClear)
+			.setStoreOp(vk::AttachmentStoreOp::eDontCare)
+			.setClearValue(vk::ClearDepthStencilValue(1.0f, 0));
+
+		vk::Rect2D renderArea = { {0, 0}, {framebuffer->getWidth(), framebuffer->getHeight()} };
+
+		auto renderingInfo = vk::RenderingInfoKHR()
+			.setRenderArea(renderArea)
+			.setLayerCount(1)
+			.setColorAttachmentCount(1)
+			.setPColorAttachments(&colorAttachment)
+			.setPDepthAttachment(depthBuffer ? &depthAttachment : nullptr);
+
+		commandBuffer.beginRenderingKHR(renderingInfo, context->getDispatchLoader());
+
+		// Pipelines made for dynamic rendering leave the viewport to the command buffer
+		auto viewport = vk::Viewport()
+			.setX(0.0f)
+			.setY(0.0f)
+			.setWidth((float) framebuffer->getWidth())
+			.setHeight((float) framebuffer->getHeight())
+			.setMinDepth(0.0f)
+			.setMaxDepth(1.0f);
+
+		commandBuffer.setViewport(0, viewport);
+		commandBuffer.setScissor(0, renderArea);
+	}
+
 	ktw::CommandBuffer& CommandBuffer::end() {
-		commandBuffer.endRenderPass();
+		// Still clears the framebuffer when nothing was drawn
+		beginRenderPass();
+		if(framebuffer->getRenderPass()) {
+			commandBuffer.endRenderPass();
+		}
+		else {
+			commandBuffer.endRenderingKHR(context->getDispatchLoader());
+
+			auto barrier = vk::ImageMemoryBarrier()
+				.setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+				.setDstAccessMask(vk::AccessFlagBits::eMemoryRead)
+				.setOldLayout(vk::ImageLayout::eColorAttachmentOptimal)
+				.setNewLayout(framebuffer->getFinalLayout())
+				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setImage(framebuffer->getImage())
+				.setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
+
+			commandBuffer.pipelineBarrier(
+				vk::PipelineStageFlagBits::eColorAttachmentOutput,
+				vk::PipelineStageFlagBits::eAllCommands,
+				{}, nullptr, nullptr, barrier
+			);
+		}
 		commandBuffer.end();
 
 		return *this;
@@ -34,7 +162,61 @@ namespace ktw {
 		return *this;
 	}
 
+	ktw::CommandBuffer& CommandBuffer::bindDepthPipeline(ktw::GraphicsPipeline* pipeline) {
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->getDepthPipeline());
+
+		return *this;
+	}
+
+	ktw::CommandBuffer& CommandBuffer::bindPipeline(ktw::ComputePipeline* pipeline) {
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline->getPipeline());
+
+		return *this;
+	}
+
+	ktw::CommandBuffer& CommandBuffer::bindDescriptorSet(ktw::GraphicsPipeline* pipeline, uint32_t set, vk::DescriptorSet descriptorSet) {
+		return bindDescriptorSet(pipeline->getPipelineLayout(), set, descriptorSet);
+	}
+
+	ktw::CommandBuffer& CommandBuffer::bindDescriptorSet(ktw::ComputePipeline* pipeline, uint32_t set, vk::DescriptorSet descriptorSet) {
+		return bindDescriptorSet(pipeline->getPipelineLayout(), set, descriptorSet, vk::PipelineBindPoint::eCompute);
+	}
+
+	ktw::CommandBuffer& CommandBuffer::bindDescriptorSet(vk::PipelineLayout layout, uint32_t set, vk::DescriptorSet descriptorSet, vk::PipelineBindPoint bindPoint) {
+		commandBuffer.bindDescriptorSets(bindPoint, layout, set, 1, &descriptorSet, 0, nullptr);
+
+		return *this;
+	}
+
+	ktw::CommandBuffer& CommandBuffer::pushConstants(ktw::GraphicsPipeline* pipeline, const void* data, uint32_t size, uint32_t offset) {
+		// Pipeline layouts declare their push constant range for all graphics stages (see LayoutCache)
+		commandBuffer.pushConstants(pipeline->getPipelineLayout(), vk::ShaderStageFlagBits::eAllGraphics, offset, size, data);
+
+		return *this;
+	}
+
+	ktw::CommandBuffer& CommandBuffer::pushConstants(ktw::ComputePipeline* pipeline, const void* data, uint32_t size, uint32_t offset) {
+		commandBuffer.pushConstants(pipeline->getPipelineLayout(), vk::ShaderStageFlagBits::eCompute, offset, size, data);
+
+		return *this;
+	}
+
+	ktw::CommandBuffer& CommandBuffer::dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
+		if(insideRenderPass) {
+			throw std::runtime_error("compute work must be recorded before the first draw of the command buffer");
+		}
+		commandBuffer.dispatch(groupCountX, groupCountY, groupCountZ);
+		computeWritesPending = true;
+
+		return *this;
+	}
+
 	ktw::CommandBuffer& CommandBuffer::bindVertexBuffer(ktw::Buffer* buffer) {
+		if(buffer->getBuffer() == boundVertexBuffer) {
+			return *this;
+		}
+		boundVertexBuffer = buffer->getBuffer();
+
 		vk::Buffer vertexBuffers[] = {buffer->getBuffer()};
 		vk::DeviceSize offsets[] = {0};
 
@@ -44,13 +226,109 @@ namespace ktw {
 	}
 
 	ktw::CommandBuffer& CommandBuffer::CommandBuffer::bindIndexBuffer(ktw::Buffer* buffer) {
-		commandBuffer.bindIndexBuffer(buffer->getBuffer(), 0, vk::IndexType::eUint32);
+		if(buffer->getBuffer() == boundIndexBuffer && buffer->getIndexType() == boundIndexType) {
+			return *this;
+		}
+		boundIndexBuffer = buffer->getBuffer();
+		boundIndexType = buffer->getIndexType();
+
+		commandBuffer.bindIndexBuffer(buffer->getBuffer(), 0, buffer->getIndexType());
+
+		return *this;
+	}
+
+	ktw::CommandBuffer& CommandBuffer::drawIndexed(uint32_t count, uint32_t firstIndex, int32_t vertexOffset) {
+		beginRenderPass();
+		commandBuffer.drawIndexed(count, 1, firstIndex, vertexOffset, 0);
+
+		return *this;
+	}
+
+	ktw::CommandBuffer& CommandBuffer::drawIndexedIndirect(ktw::Buffer* buffer, uint32_t drawCount, vk::DeviceSize offset) {
+		beginRenderPass();
+		uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+		if(multiDrawIndirect) {
+			commandBuffer.drawIndexedIndirect(buffer->getBuffer(), offset, drawCount, stride);
+		}
+		else {
+			// Without multiDrawIndirect each call is limited to one draw
+			for(uint32_t i = 0; i < drawCount; i++) {
+				commandBuffer.drawIndexedIndirect(buffer->getBuffer(), offset + i * stride, 1, stride);
+			}
+		}
+
+		return *this;
+	}
+
+	ktw::CommandBuffer& CommandBuffer::drawMesh(ktw::Mesh* mesh) {
+		bindVertexBuffer(mesh->getVertexBuffer());
+		bindIndexBuffer(mesh->getIndexBuffer());
+		for(auto& submesh : mesh->getSubmeshes()) {
+			drawIndexed(submesh.indexCount, submesh.firstIndex, submesh.vertexOffset);
+		}
+
+		return *this;
+	}
+
+	ktw::CommandBuffer& CommandBuffer::drawMesh(ktw::Mesh* mesh, const ktw::LodSelector& lodSelector, const glm::mat4& model) {
+		glm::vec3 center = glm::vec3(model * glm::vec4((mesh->getBoundsMin() + mesh->getBoundsMax()) * 0.5f, 1.0f));
+		float scale = std::max({glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))});
+		float radius = glm::length(mesh->getBoundsMax() - mesh->getBoundsMin()) * 0.5f * scale;
+
+		bindVertexBuffer(mesh->getVertexBuffer());
+		bindIndexBuffer(mesh->getIndexBuffer());
+		for(auto& submesh : mesh->getSubmeshes()) {
+			auto& lod = submesh.lods[lodSelector.select(submesh.lods, center, radius, scale)];
+			drawIndexed(lod.indexCount, lod.firstIndex, submesh.vertexOffset);
+		}
 
 		return *this;
 	}
 
-	ktw::CommandBuffer& CommandBuffer::drawIndexed(uint32_t count) {
-		commandBuffer.drawIndexed(count, 1, 0, 0, 0);
+	ktw::CommandBuffer& CommandBuffer::drawRenderables(ktw::World& world) {
+		// The depth of ePrePass entities first, so the shading pass only shades their visible pixels
+		drawRenderables(world, true);
+		drawRenderables(world, false);
+
+		return *this;
+	}
+
+	void CommandBuffer::drawRenderables(ktw::World& world, bool prePass) {
+		// Pipelines and buffers are only bound when they change from one entity to the next
+		ktw::GraphicsPipeline* boundPipeline = nullptr;
+		bool pushTransform = false;
+		world.eachChunk<ktw::Transform, ktw::Renderable>([&](uint32_t count, const ktw::Entity*, ktw::Transform* transforms, ktw::Renderable* renderables) {
+			for(uint32_t i = 0; i < count; i++) {
+				if(prePass && renderables[i].pipeline->getDepthMode() != ktw::DepthMode::ePrePass) {
+					continue;
+				}
+				if(renderables[i].pipeline != boundPipeline) {
+					boundPipeline = renderables[i].pipeline;
+					pushTransform = boundPipeline->getPushConstantSize() >= sizeof(glm::mat4);
+					if(prePass) {
+						bindDepthPipeline(boundPipeline);
+					}
+					else {
+						bindPipeline(boundPipeline);
+					}
+				}
+				if(pushTransform) {
+					pushConstants(boundPipeline, &transforms[i].matrix, sizeof(glm::mat4));
+				}
+				drawMesh(renderables[i].mesh);
+			}
+		});
+	}
+
+	ktw::CommandBuffer& CommandBuffer::drawMeshlets(ktw::Mesh* mesh) {
+		if(mesh->getMeshletCount() == 0) {
+			throw std::runtime_error("mesh has no meshlets, convert it with MeshConverter");
+		}
+
+		// Culled meshlets are left in the buffer with an instance count of 0
+		bindVertexBuffer(mesh->getVertexBuffer());
+		bindIndexBuffer(mesh->getIndexBuffer());
+		drawIndexedIndirect(mesh->getDrawCommandBuffer(), mesh->getMeshletCount());
 
 		return *this;
 	}
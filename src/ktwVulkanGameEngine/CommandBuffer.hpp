@@ -2,20 +2,63 @@
 
 #include "FrameBuffer.hpp"
 #include "GraphicsPipeline.hpp"
+#include "ComputePipeline.hpp"
 #include "Buffer.hpp"
+#include "Mesh.hpp"
+#include "LodSelector.hpp"
+#include "World.hpp"
+#include "Components.hpp"
 
 namespace ktw {
+	// The render pass begins with the first draw, so compute work (culling,
+	// ...) can be recorded before it in the same command buffer. Its results
+	// are made visible to the draws when the render pass begins. Framebuffers
+	// without a render pass are drawn with dynamic rendering instead.
 	class CommandBuffer {
 	public:
-		CommandBuffer(ktw::FrameBuffer& framebuffer, vk::CommandBuffer commandBuffer);
+		CommandBuffer(ktw::Context& context, ktw::FrameBuffer& framebuffer, vk::CommandBuffer commandBuffer);
 		ktw::CommandBuffer& end();
 		ktw::CommandBuffer& bindPipeline(ktw::GraphicsPipeline* pipeline);
+		// Depth only variant of an ePrePass pipeline, to record its pre-pass by hand
+		ktw::CommandBuffer& bindDepthPipeline(ktw::GraphicsPipeline* pipeline);
+		ktw::CommandBuffer& bindPipeline(ktw::ComputePipeline* pipeline);
+		ktw::CommandBuffer& bindDescriptorSet(ktw::GraphicsPipeline* pipeline, uint32_t set, vk::DescriptorSet descriptorSet);
+		ktw::CommandBuffer& bindDescriptorSet(ktw::ComputePipeline* pipeline, uint32_t set, vk::DescriptorSet descriptorSet);
+		ktw::CommandBuffer& bindDescriptorSet(vk::PipelineLayout layout, uint32_t set, vk::DescriptorSet descriptorSet, vk::PipelineBindPoint bindPoint = vk::PipelineBindPoint::eGraphics);
+		ktw::CommandBuffer& pushConstants(ktw::GraphicsPipeline* pipeline, const void* data, uint32_t size, uint32_t offset = 0);
+		ktw::CommandBuffer& pushConstants(ktw::ComputePipeline* pipeline, const void* data, uint32_t size, uint32_t offset = 0);
+		ktw::CommandBuffer& dispatch(uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1);
 		ktw::CommandBuffer& bindVertexBuffer(ktw::Buffer* buffer);
 		ktw::CommandBuffer& bindIndexBuffer(ktw::Buffer* buffer);
-		ktw::CommandBuffer& drawIndexed(uint32_t count);
+		ktw::CommandBuffer& drawIndexed(uint32_t count, uint32_t firstIndex = 0, int32_t vertexOffset = 0);
+		ktw::CommandBuffer& drawIndexedIndirect(ktw::Buffer* buffer, uint32_t drawCount, vk::DeviceSize offset = 0);
+		ktw::CommandBuffer& drawMesh(ktw::Mesh* mesh);
+		// Each submesh at the level of detail the selector picks for the mesh bounds
+		ktw::CommandBuffer& drawMesh(ktw::Mesh* mesh, const ktw::LodSelector& lodSelector, const glm::mat4& model);
+		// Every entity with a Transform and a Renderable, the matrix is pushed at offset 0
+		// when the pipeline declares push constants large enough for it. Entities with an
+		// ePrePass pipeline are drawn depth only first.
+		ktw::CommandBuffer& drawRenderables(ktw::World& world);
+		// Draws the meshlets left visible by MeshletCuller::cull
+		ktw::CommandBuffer& drawMeshlets(ktw::Mesh* mesh);
+		// Raw commands are recorded as is, outside the render pass before the first draw.
+		// Buffers bound through it are not seen by bindVertexBuffer and bindIndexBuffer.
 		vk::CommandBuffer getHandle();
 
 	private:
+		ktw::Context* context;
+		ktw::FrameBuffer* framebuffer;
 		vk::CommandBuffer commandBuffer;
+		bool multiDrawIndirect;
+		bool insideRenderPass = false;
+		bool computeWritesPending = false;
+		// Meshes sharing GeometryArena buffers are drawn without rebinding them
+		vk::Buffer boundVertexBuffer;
+		vk::Buffer boundIndexBuffer;
+		vk::IndexType boundIndexType = vk::IndexType::eUint32;
+
+		void beginRenderPass();
+		void beginRendering();
+		void drawRenderables(ktw::World& world, bool prePass);
 	};
 }
\ No newline at end of file
@@ -28,6 +28,32 @@ namespace ktw
 		allocatedCommandBuffer.insert(buffer);
 	}
 
+	vk::CommandBuffer CommandPool::beginSingleTimeCommands() {
+		vk::CommandBuffer buffer = getCommandBuffer();
+
+		auto beginInfo = vk::CommandBufferBeginInfo()
+			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+
+		buffer.begin(beginInfo);
+		return buffer;
+	}
+
+	void CommandPool::endSingleTimeCommands(vk::CommandBuffer buffer) {
+		buffer.end();
+
+		auto submitInfo = vk::SubmitInfo()
+			.setCommandBufferCount(1)
+			.setPCommandBuffers(&buffer);
+
+		// Only used for uploads at load time, waiting for the queue keeps it simple
+		if(context.getGraphicsQueue().submit(1, &submitInfo, nullptr) != vk::Result::eSuccess) {
+			throw std::runtime_error("Error while submitting command buffer");
+		}
+		context.getGraphicsQueue().waitIdle();
+
+		freeCommandBuffer(buffer);
+	}
+
 	vk::CommandBuffer CommandPool::createCommandBuffer() {
 		auto allocInfo = vk::CommandBufferAllocateInfo()
 			.setCommandPool(*commandPool)
@@ -11,6 +11,8 @@ namespace ktw
 		CommandPool(ktw::Context& context);
 		vk::CommandBuffer getCommandBuffer();
 		void freeCommandBuffer(vk::CommandBuffer buffer);
+		vk::CommandBuffer beginSingleTimeCommands();
+		void endSingleTimeCommands(vk::CommandBuffer buffer);
 
 	private:
 		ktw::Context& context;
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+#include "GraphicsPipeline.hpp"
+
+namespace ktw {
+	// World transform of an entity
+	struct Transform {
+		glm::mat4 matrix = glm::mat4(1.0f);
+	};
+
+	// Drawn by CommandBuffer::drawRenderables with the entity's Transform.
+	// The mesh and the pipeline are not owned by the entity.
+	struct Renderable {
+		ktw::Mesh* mesh = nullptr;
+		ktw::GraphicsPipeline* pipeline = nullptr;
+	};
+}
@@ -0,0 +1,55 @@
+#include "pch.hpp"
+#include "ComputePipeline.hpp"
+
+namespace ktw {
+	ComputePipeline::ComputePipeline(ktw::Context& context, ktw::LayoutCache& layoutCache, const ktw::ShaderSource& shaderSource, const ktw::SpecializationConstants& specializationConstants) {
+		shader = std::make_unique<ktw::Shader>(context, shaderSource);
+		auto& reflection = shader->getReflection();
+		if(reflection.getStage() != vk::ShaderStageFlagBits::eCompute) {
+			throw std::runtime_error(shader->getFilename() + " is not a compute shader");
+		}
+
+		uint32_t setCount = 0;
+		for(auto& binding : reflection.getDescriptorBindings()) {
+			setCount = std::max(setCount, binding.set + 1);
+		}
+		std::vector<std::vector<vk::DescriptorSetLayoutBinding>> sets(setCount);
+		for(auto& binding : reflection.getDescriptorBindings()) {
+			if(binding.count == 0) {
+				throw std::runtime_error("unsized descriptor arrays are not supported (set " + std::to_string(binding.set) + " binding " + std::to_string(binding.binding) + ")");
+			}
+			sets[binding.set].push_back(vk::DescriptorSetLayoutBinding(binding.binding, binding.type, binding.count, vk::ShaderStageFlagBits::eCompute));
+		}
+		for(auto& set : sets) {
+			descriptorSetLayouts.push_back(layoutCache.getDescriptorSetLayout(set, vk::ShaderStageFlagBits::eCompute));
+		}
+		pipelineLayout = layoutCache.getPipelineLayout(descriptorSetLayouts, reflection.getPushConstantSize(), vk::ShaderStageFlagBits::eCompute);
+
+		vk::SpecializationInfo specializationInfo = specializationConstants.getInfo();
+
+		auto stageInfo = vk::PipelineShaderStageCreateInfo()
+			.setStage(vk::ShaderStageFlagBits::eCompute)
+			.setModule(*(shader->getModule()))
+			.setPName("main")
+			.setPSpecializationInfo(specializationConstants.empty() ? nullptr : &specializationInfo);
+
+		auto pipelineInfo = vk::ComputePipelineCreateInfo()
+			.setStage(stageInfo)
+			.setLayout(pipelineLayout);
+
+		pipeline = context.getDevice().createComputePipelineUnique(nullptr, pipelineInfo).value;
+		LOG_TRACE("Compute Pipeline Created");
+	}
+
+	vk::Pipeline ComputePipeline::getPipeline() {
+		return *pipeline;
+	}
+
+	vk::PipelineLayout ComputePipeline::getPipelineLayout() {
+		return pipelineLayout;
+	}
+
+	const std::vector<vk::DescriptorSetLayout>& ComputePipeline::getDescriptorSetLayouts() {
+		return descriptorSetLayouts;
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Shader.hpp"
+#include "LayoutCache.hpp"
+#include "SpecializationConstants.hpp"
+#include "Context.hpp"
+
+namespace ktw {
+	// Compute counterpart of GraphicsPipeline, with its layouts reflected from
+	// the shader. Compute layouts are visible to the compute stage only, so
+	// they never use the bindless set 0, and they are not hot-reloaded.
+	class ComputePipeline {
+	public:
+		ComputePipeline(ktw::Context& context, ktw::LayoutCache& layoutCache, const ktw::ShaderSource& shaderSource, const ktw::SpecializationConstants& specializationConstants = ktw::SpecializationConstants());
+		vk::Pipeline getPipeline();
+		vk::PipelineLayout getPipelineLayout();
+		const std::vector<vk::DescriptorSetLayout>& getDescriptorSetLayouts();
+
+	private:
+		std::unique_ptr<ktw::Shader> shader;
+		// Owned by the LayoutCache
+		std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
+		vk::PipelineLayout pipelineLayout;
+		vk::UniquePipeline pipeline;
+	};
+}
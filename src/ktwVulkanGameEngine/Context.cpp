@@ -124,6 +124,13 @@ namespace ktw {
 			throw std::runtime_error("failed to find a suitable GPU!");
 		}
 		LOG_INFO("Selected GPU: {}", physicalDevice.getProperties().deviceName);
+
+		auto features = physicalDevice.getFeatures();
+		textureCompressionSupport.bc = features.textureCompressionBC;
+		textureCompressionSupport.etc2 = features.textureCompressionETC2;
+		textureCompressionSupport.astc = features.textureCompressionASTC_LDR;
+		LOG_INFO("Texture compression: BC {}, ETC2 {}, ASTC {}", textureCompressionSupport.bc, textureCompressionSupport.etc2, textureCompressionSupport.astc);
+		multiDrawIndirectSupported = features.multiDrawIndirect;
 	}
 
 	void Context::createLogicalDevice() {
@@ -149,15 +156,68 @@ namespace ktw {
 		}
 
 		vk::PhysicalDeviceFeatures deviceFeatures{};
+		deviceFeatures
+			.setTextureCompressionBC(textureCompressionSupport.bc)
+			.setTextureCompressionETC2(textureCompressionSupport.etc2)
+			.setTextureCompressionASTC_LDR(textureCompressionSupport.astc)
+			.setMultiDrawIndirect(multiDrawIndirectSupported);
+
+		// Descriptor indexing (core in Vulkan 1.2) backs the opt-in bindless mode
+		auto descriptorIndexingFeatures = vk::PhysicalDeviceDescriptorIndexingFeatures();
+		descriptorIndexingSupported = false;
+		if(physicalDevice.getProperties().apiVersion >= VK_API_VERSION_1_2) {
+			auto supported = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDescriptorIndexingFeatures>().get<vk::PhysicalDeviceDescriptorIndexingFeatures>();
+			descriptorIndexingSupported =
+				supported.runtimeDescriptorArray &&
+				supported.descriptorBindingPartiallyBound &&
+				supported.descriptorBindingUpdateUnusedWhilePending &&
+				supported.descriptorBindingStorageBufferUpdateAfterBind &&
+				supported.descriptorBindingSampledImageUpdateAfterBind &&
+				supported.shaderStorageBufferArrayNonUniformIndexing &&
+				supported.shaderSampledImageArrayNonUniformIndexing;
+		}
+		if(descriptorIndexingSupported) {
+			descriptorIndexingFeatures
+				.setRuntimeDescriptorArray(true)
+				.setDescriptorBindingPartiallyBound(true)
+				.setDescriptorBindingUpdateUnusedWhilePending(true)
+				.setDescriptorBindingStorageBufferUpdateAfterBind(true)
+				.setDescriptorBindingSampledImageUpdateAfterBind(true)
+				.setShaderStorageBufferArrayNonUniformIndexing(true)
+				.setShaderSampledImageArrayNonUniformIndexing(true);
+		}
+
+		// Dynamic rendering (core in Vulkan 1.3) backs the opt-in render pass free path,
+		// the extension is enabled whenever available as the instance targets 1.2
+		std::vector<const char*> enabledExtensions = deviceExtensions;
+		auto dynamicRenderingFeatures = vk::PhysicalDeviceDynamicRenderingFeaturesKHR();
+		dynamicRenderingSupported = false;
+		if(physicalDevice.getProperties().apiVersion >= VK_API_VERSION_1_2) {
+			auto availableExtensions = physicalDevice.enumerateDeviceExtensionProperties();
+			bool available = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const vk::ExtensionProperties& extension) {
+				return std::string(extension.extensionName) == VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME;
+			});
+			dynamicRenderingSupported = available && physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDynamicRenderingFeaturesKHR>().get<vk::PhysicalDeviceDynamicRenderingFeaturesKHR>().dynamicRendering;
+		}
+		void* featureChain = descriptorIndexingSupported ? &descriptorIndexingFeatures : nullptr;
+		if(dynamicRenderingSupported) {
+			dynamicRenderingFeatures
+				.setDynamicRendering(true)
+				.setPNext(featureChain);
+			featureChain = &dynamicRenderingFeatures;
+			enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+		}
 
 		auto createInfo = vk::DeviceCreateInfo()
+			.setPNext(featureChain)
 			.setPQueueCreateInfos(queueCreateInfos.data())
 			.setQueueCreateInfoCount(static_cast<uint32_t>(queueCreateInfos.size()))
 			.setPEnabledFeatures(&deviceFeatures)
-			.setEnabledExtensionCount(static_cast<uint32_t>(deviceExtensions.size()))
-			.setPpEnabledExtensionNames(deviceExtensions.data());
+			.setEnabledExtensionCount(static_cast<uint32_t>(enabledExtensions.size()))
+			.setPpEnabledExtensionNames(enabledExtensions.data());
 
 		device = physicalDevice.createDeviceUnique(createInfo);
+		dispatchLoader = vk::DispatchLoaderDynamic(getInstance(), vkGetInstanceProcAddr, *device);
 		graphicsQueue = device->getQueue(graphicsQueueIndex, 0);
 		presentQueue = device->getQueue(presentQueueIndex, 0);
 		LOG_TRACE("Logical Device Created");
@@ -174,4 +234,43 @@ namespace ktw {
 	vk::SurfaceKHR Context::getSurface() {
 		return *surface;
 	}
+
+	bool Context::supportsDescriptorIndexing() {
+		return descriptorIndexingSupported;
+	}
+
+	bool Context::supportsMultiDrawIndirect() {
+		return multiDrawIndirectSupported;
+	}
+
+	bool Context::supportsDynamicRendering() {
+		return dynamicRenderingSupported;
+	}
+
+	const vk::DispatchLoaderDynamic& Context::getDispatchLoader() {
+		return dispatchLoader;
+	}
+
+	const ktw::TextureCompressionSupport& Context::getTextureCompressionSupport() {
+		return textureCompressionSupport;
+	}
+
+	uint64_t Context::createResourceId() {
+		return nextResourceId++;
+	}
+
+	void Context::destroyResourceId(uint64_t id) {
+		for(auto& [index, listener] : resourceDestroyedListeners) {
+			listener(id);
+		}
+	}
+
+	size_t Context::addResourceDestroyedListener(std::function<void(uint64_t)> listener) {
+		resourceDestroyedListeners[nextResourceDestroyedListener] = listener;
+		return nextResourceDestroyedListener++;
+	}
+
+	void Context::removeResourceDestroyedListener(size_t listener) {
+		resourceDestroyedListeners.erase(listener);
+	}
 }
\ No newline at end of file
@@ -4,7 +4,18 @@
 
 #include "Instance.hpp"
 
+#include <atomic>
+#include <functional>
+#include <map>
+
 namespace ktw {
+	// Block-compressed texture families the selected GPU can sample
+	struct TextureCompressionSupport {
+		bool bc = false;
+		bool etc2 = false;
+		bool astc = false;
+	};
+
 	class Context {
 	public:
 		Context(ktw::Instance& instance, VkSurfaceKHR surface, uint32_t width, uint32_t height);
@@ -18,6 +29,18 @@ namespace ktw {
 		uint32_t getWidth();
 		uint32_t getHeight();
 		vk::SurfaceKHR getSurface();
+		bool supportsDescriptorIndexing();
+		bool supportsMultiDrawIndirect();
+		bool supportsDynamicRendering();
+		// Extension commands (dynamic rendering) go through it, the static loader only has core ones
+		const vk::DispatchLoaderDynamic& getDispatchLoader();
+		const ktw::TextureCompressionSupport& getTextureCompressionSupport();
+		// Resources (buffers, images) get an id that is never reused, unlike
+		// Vulkan handles, and caches are told when it is destroyed
+		uint64_t createResourceId();
+		void destroyResourceId(uint64_t id);
+		size_t addResourceDestroyedListener(std::function<void(uint64_t)> listener);
+		void removeResourceDestroyedListener(size_t listener);
 
 	private:
 		ktw::Instance& instance;
@@ -31,6 +54,15 @@ namespace ktw {
 		uint32_t presentQueueIndex;
 		uint32_t width;
 		uint32_t height;
+		bool descriptorIndexingSupported;
+		bool multiDrawIndirectSupported;
+		bool dynamicRenderingSupported;
+		vk::DispatchLoaderDynamic dispatchLoader;
+		ktw::TextureCompressionSupport textureCompressionSupport;
+		// Resources may be created from jobs
+		std::atomic<uint64_t> nextResourceId{1};
+		size_t nextResourceDestroyedListener = 0;
+		std::map<size_t, std::function<void(uint64_t)>> resourceDestroyedListeners;
 
 		void pickPhysicalDevice();
 		void createLogicalDevice();
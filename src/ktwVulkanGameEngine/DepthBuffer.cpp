@@ -0,0 +1,73 @@
+#include "pch.hpp"
+#include "DepthBuffer.hpp"
+#include "Buffer.hpp"
+
+namespace ktw {
+	DepthBuffer::DepthBuffer(ktw::Context& context, uint32_t width, uint32_t height) : format(findFormat(context)) {
+		auto imageInfo = vk::ImageCreateInfo()
+			.setImageType(vk::ImageType::e2D)
+			.setExtent(vk::Extent3D(width, height, 1))
+			.setMipLevels(1)
+			.setArrayLayers(1)
+			.setFormat(format)
+			.setTiling(vk::ImageTiling::eOptimal)
+			.setInitialLayout(vk::ImageLayout::eUndefined)
+			.setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment)
+			.setSamples(vk::SampleCountFlagBits::e1)
+			.setSharingMode(vk::SharingMode::eExclusive);
+
+		image = context.getDevice().createImageUnique(imageInfo);
+
+		vk::MemoryRequirements memRequirements = context.getDevice().getImageMemoryRequirements(*image);
+
+		auto allocInfo = vk::MemoryAllocateInfo()
+			.setAllocationSize(memRequirements.size)
+			.setMemoryTypeIndex(ktw::Buffer::findMemoryType(context, memRequirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal));
+
+		imageMemory = context.getDevice().allocateMemoryUnique(allocInfo);
+
+		context.getDevice().bindImageMemory(*image, *imageMemory, 0);
+
+		auto viewInfo = vk::ImageViewCreateInfo()
+			.setImage(*image)
+			.setViewType(vk::ImageViewType::e2D)
+			.setFormat(format)
+			.setSubresourceRange(vk::ImageSubresourceRange()
+				.setAspectMask(getAspectMask())
+				.setLevelCount(1)
+				.setLayerCount(1));
+
+		imageView = context.getDevice().createImageViewUnique(viewInfo);
+
+		LOG_TRACE("Depth Buffer Created ({}x{}, {})", width, height, vk::to_string(format));
+	}
+
+	vk::Image DepthBuffer::getImage() {
+		return *image;
+	}
+
+	vk::ImageView DepthBuffer::getImageView() {
+		return *imageView;
+	}
+
+	vk::Format DepthBuffer::getFormat() {
+		return format;
+	}
+
+	vk::ImageAspectFlags DepthBuffer::getAspectMask() {
+		if(format == vk::Format::eD32Sfloat) {
+			return vk::ImageAspectFlagBits::eDepth;
+		}
+		return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+	}
+
+	vk::Format DepthBuffer::findFormat(ktw::Context& context) {
+		for(vk::Format format : {vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint}) {
+			vk::FormatProperties properties = context.getPhysicalDevice().getFormatProperties(format);
+			if(properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment) {
+				return format;
+			}
+		}
+		throw std::runtime_error("no depth format is supported by this GPU");
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Context.hpp"
+
+namespace ktw {
+	// Depth attachment in device local memory, in the best depth format the
+	// GPU supports. Its content is only needed during the render pass.
+	class DepthBuffer {
+	public:
+		DepthBuffer(ktw::Context& context, uint32_t width, uint32_t height);
+		vk::Image getImage();
+		vk::ImageView getImageView();
+		vk::Format getFormat();
+		// Stencil included for the combined formats
+		vk::ImageAspectFlags getAspectMask();
+
+		// First of D32, D32S8 and D24S8 usable as a depth attachment
+		static vk::Format findFormat(ktw::Context& context);
+
+	private:
+		vk::Format format;
+		vk::UniqueImage image;
+		vk::UniqueDeviceMemory imageMemory;
+		vk::UniqueImageView imageView;
+	};
+}
@@ -2,78 +2,109 @@
 #include "DescriptorPool.hpp"
 
 namespace ktw {
-	DescriptorPool::DescriptorPool(ktw::Context& context, uint32_t maxSets, uint32_t maxBuffers, uint32_t maxTextures) : context(context), maxSets(maxSets), maxBuffers(maxBuffers), maxTextures(maxTextures) {
+	// Growth stops there, a pool that big is never exhausted in a sane frame
+	const uint32_t maxSetsPerPool = 4096;
 
+	DescriptorPool::DescriptorPool(ktw::Context& context, uint32_t maxSets, const std::vector<vk::DescriptorPoolSize>& poolSizes) : context(context) {
+		setPoolSizes(maxSets, poolSizes);
 	}
 
 	DescriptorPool::~DescriptorPool() {
 		for(auto descriptorPool : allocatedDescriptorPool) {
 			context.getDevice().destroyDescriptorPool(descriptorPool);
 		}
+		for(auto& [frameBuffer, descriptorPools] : lockedDescriptorPool) {
+			for(auto descriptorPool : descriptorPools) {
+				context.getDevice().destroyDescriptorPool(descriptorPool);
+			}
+		}
+	}
+
+	void DescriptorPool::setPoolSizes(uint32_t maxSets, const std::vector<vk::DescriptorPoolSize>& poolSizes) {
+		setsPerPool = std::max(maxSets, 1u);
+		setsPerOverflowPool = setsPerPool;
+		descriptorsPerSet.clear();
+		for(auto& poolSize : poolSizes) {
+			descriptorsPerSet.push_back({poolSize.type, static_cast<float>(poolSize.descriptorCount) / setsPerPool});
+		}
 	}
 
-	vk::DescriptorPool DescriptorPool::createDescriptorPool() {
-		auto poolSize = vk::DescriptorPoolSize()
-			.setDescriptorCount(maxBuffers);
+	vk::DescriptorPool DescriptorPool::createDescriptorPool(uint32_t sets) {
+		std::vector<vk::DescriptorPoolSize> poolSizes;
+		for(auto& [type, ratio] : descriptorsPerSet) {
+			poolSizes.push_back(vk::DescriptorPoolSize()
+				.setType(type)
+				.setDescriptorCount(std::max(1u, static_cast<uint32_t>(ratio * sets))));
+		}
 
 		auto poolInfo = vk::DescriptorPoolCreateInfo()
-			.setPoolSizeCount(1)
-			.setPPoolSizes(&poolSize)
-			.setMaxSets(maxSets);
+			.setPoolSizeCount(static_cast<uint32_t>(poolSizes.size()))
+			.setPPoolSizes(poolSizes.data())
+			.setMaxSets(sets);
 
 		vk::DescriptorPool descriptorPool = context.getDevice().createDescriptorPool(poolInfo);
 
-		LOG_INFO("New vk::DescriptorPool Created");
+		LOG_INFO("New vk::DescriptorPool Created ({} sets)", sets);
 		return descriptorPool;
 	}
 
-	bool DescriptorPool::createDescriptorSet(vk::DescriptorPool descriptorPool, vk::DescriptorSet& descriptorSet, vk::DescriptorSetLayout layout) {
+	vk::DescriptorPool DescriptorPool::acquireDescriptorPool(uint32_t sets) {
+		if(allocatedDescriptorPool.empty()) {
+			return createDescriptorPool(sets);
+		}
+
+		vk::DescriptorPool pool = allocatedDescriptorPool.back();
+		allocatedDescriptorPool.pop_back();
+		return pool;
+	}
+
+	vk::Result DescriptorPool::createDescriptorSet(vk::DescriptorPool descriptorPool, vk::DescriptorSet& descriptorSet, vk::DescriptorSetLayout layout) {
 		auto allocInfo = vk::DescriptorSetAllocateInfo()
 			.setDescriptorPool(descriptorPool)
 			.setDescriptorSetCount(1)
 			.setPSetLayouts(&layout);
 
-		try {
-			descriptorSet = context.getDevice().allocateDescriptorSets(allocInfo)[0];
-			return true;
-		}
-		catch(std::exception e) {
-			LOG_WARN(e.what());
-			return false;
-		}
+		// The pointer overload reports a full pool through its result instead of throwing
+		return context.getDevice().allocateDescriptorSets(&allocInfo, &descriptorSet);
 	}
 
 	vk::DescriptorSet DescriptorPool::getDescriptorSet(ktw::FrameBuffer& frameBuffer, vk::DescriptorSetLayout layout) {
-		vk::DescriptorPool pool;
-		if(lockedDescriptorPool.find(frameBuffer.getHandle()) == lockedDescriptorPool.end()) {
-			if(allocatedDescriptorPool.empty()) {
-				pool = createDescriptorPool();
-			}
-			else {
-				pool = *(allocatedDescriptorPool.begin());
-				allocatedDescriptorPool.erase(allocatedDescriptorPool.begin());
-			}
-			lockedDescriptorPool[frameBuffer.getHandle()] = {pool};
-		}
-		else {
-			pool = lockedDescriptorPool[frameBuffer.getHandle()].back();
+		auto& descriptorPools = lockedDescriptorPool[&frameBuffer];
+		if(descriptorPools.empty()) {
+			descriptorPools.push_back(acquireDescriptorPool(setsPerPool));
 		}
 
 		vk::DescriptorSet set;
-		if(!createDescriptorSet(pool, set, layout)) {
-			pool = createDescriptorPool();
-			lockedDescriptorPool[frameBuffer.getHandle()].push_back(pool);
-			createDescriptorSet(pool, set, layout);
+		vk::Result result = createDescriptorSet(descriptorPools.back(), set, layout);
+		while(result == vk::Result::eErrorOutOfPoolMemory || result == vk::Result::eErrorFragmentedPool) {
+			// A pool was not enough, the next ones created are bigger
+			setsPerOverflowPool = std::max(setsPerOverflowPool, std::min(setsPerOverflowPool * 2, maxSetsPerPool));
+			bool freshPool = allocatedDescriptorPool.empty();
+			descriptorPools.push_back(acquireDescriptorPool(setsPerOverflowPool));
+			result = createDescriptorSet(descriptorPools.back(), set, layout);
+			if(freshPool) {
+				// Even a new pool cannot hold this layout, growing more will not help
+				break;
+			}
+		}
+
+		if(result != vk::Result::eSuccess) {
+			throw std::runtime_error("failed to allocate descriptor set: " + vk::to_string(result));
 		}
 		return set;
 	}
 
 	void DescriptorPool::freeDescriptorPools(ktw::FrameBuffer& frameBuffer) {
-		for(auto descriptorPool : lockedDescriptorPool[frameBuffer.getHandle()]) {
+		auto it = lockedDescriptorPool.find(&frameBuffer);
+		if(it == lockedDescriptorPool.end()) {
+			return;
+		}
+
+		for(auto descriptorPool : it->second) {
 			context.getDevice().resetDescriptorPool(descriptorPool);
-			allocatedDescriptorPool.insert(descriptorPool);
+			allocatedDescriptorPool.push_back(descriptorPool);
 		}
 
-		lockedDescriptorPool.erase(frameBuffer.getHandle());
+		lockedDescriptorPool.erase(it);
 	}
-}
\ No newline at end of file
+}
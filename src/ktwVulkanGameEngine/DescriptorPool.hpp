@@ -8,22 +8,29 @@
 #include <vector>
 
 namespace ktw {
+	// Per-frame descriptor arena. Sets are allocated from pools locked by the
+	// frame being recorded; when a pool runs out a bigger one is chained, and
+	// all of a frame's pools are reset at once when its rendering is done.
 	class DescriptorPool {
 	public:
-		DescriptorPool(ktw::Context& context, uint32_t maxSets, uint32_t maxBuffers, uint32_t maxTextures);
+		DescriptorPool(ktw::Context& context, uint32_t maxSets, const std::vector<vk::DescriptorPoolSize>& poolSizes);
 		~DescriptorPool();
+		void setPoolSizes(uint32_t maxSets, const std::vector<vk::DescriptorPoolSize>& poolSizes);
 		vk::DescriptorSet getDescriptorSet(ktw::FrameBuffer& frameBuffer, vk::DescriptorSetLayout layout);
 		void freeDescriptorPools(ktw::FrameBuffer& frameBuffer);
 
 	private:
 		ktw::Context& context;
-		uint32_t maxSets;
-		uint32_t maxBuffers;
-		uint32_t maxTextures;
-		std::set<vk::DescriptorPool> allocatedDescriptorPool;
-		std::unordered_map<vk::Framebuffer, std::vector<vk::DescriptorPool>> lockedDescriptorPool;
+		// Pool sizes are kept as descriptors per set so they scale with the pool
+		std::vector<std::pair<vk::DescriptorType, float>> descriptorsPerSet;
+		// First pool of each frame buffer, and the size of the pools added when one runs out
+		uint32_t setsPerPool;
+		uint32_t setsPerOverflowPool;
+		std::vector<vk::DescriptorPool> allocatedDescriptorPool;
+		std::unordered_map<ktw::FrameBuffer*, std::vector<vk::DescriptorPool>> lockedDescriptorPool;
 
-		vk::DescriptorPool createDescriptorPool();
-		bool createDescriptorSet(vk::DescriptorPool descriptorPool, vk::DescriptorSet& descriptorSet, vk::DescriptorSetLayout layout);
+		vk::DescriptorPool acquireDescriptorPool(uint32_t sets);
+		vk::DescriptorPool createDescriptorPool(uint32_t sets);
+		vk::Result createDescriptorSet(vk::DescriptorPool descriptorPool, vk::DescriptorSet& descriptorSet, vk::DescriptorSetLayout layout);
 	};
-}
\ No newline at end of file
+}
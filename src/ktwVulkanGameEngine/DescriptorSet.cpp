@@ -2,12 +2,19 @@
 #include "DescriptorSet.hpp"
 
 namespace ktw {
-	DescriptorSet::DescriptorSet(ktw::Context& context) {
-		// std::vector<VkDescriptorSetLayout> layouts(swapChainImages.size(), descriptorSetLayout);
-		// VkDescriptorSetAllocateInfo allocInfo{};
-		// allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		// allocInfo.descriptorPool = descriptorPool;
-		// allocInfo.descriptorSetCount = 1;
-		// allocInfo.pSetLayouts = layouts.data();
+	DescriptorSet::DescriptorSet(vk::DescriptorSetLayout layout) : layout(layout) {}
+
+	ktw::DescriptorSet& DescriptorSet::bindBuffer(uint32_t binding, ktw::Buffer& buffer, vk::DescriptorType type, vk::DeviceSize offset, vk::DeviceSize range) {
+		bindings.push_back({binding, type, buffer.getId(), buffer.getBuffer(), offset, range, nullptr, nullptr, vk::ImageLayout::eUndefined});
+		return *this;
+	}
+
+	ktw::DescriptorSet& DescriptorSet::bindTexture(uint32_t binding, ktw::Texture& texture) {
+		return bindImage(binding, texture.getId(), texture.getImageView(), texture.getSampler());
+	}
+
+	ktw::DescriptorSet& DescriptorSet::bindImage(uint32_t binding, uint64_t resourceId, vk::ImageView imageView, vk::Sampler sampler, vk::DescriptorType type, vk::ImageLayout imageLayout) {
+		bindings.push_back({binding, type, resourceId, nullptr, 0, 0, imageView, sampler, imageLayout});
+		return *this;
 	}
-}
\ No newline at end of file
+}
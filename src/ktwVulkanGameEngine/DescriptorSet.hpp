@@ -1,13 +1,36 @@
 #pragma once
 
 #include "Context.hpp"
+#include "Buffer.hpp"
+#include "Texture.hpp"
 
 namespace ktw {
+	// Describes what a descriptor set binds. Two descriptions with the same
+	// layout and resources give the same set out of the DescriptorSetCache.
 	class DescriptorSet {
 	public:
-		DescriptorSet(ktw::Context& context);
+		DescriptorSet(vk::DescriptorSetLayout layout);
+
+		ktw::DescriptorSet& bindBuffer(uint32_t binding, ktw::Buffer& buffer, vk::DescriptorType type = vk::DescriptorType::eUniformBuffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+		ktw::DescriptorSet& bindTexture(uint32_t binding, ktw::Texture& texture);
+		ktw::DescriptorSet& bindImage(uint32_t binding, uint64_t resourceId, vk::ImageView imageView, vk::Sampler sampler, vk::DescriptorType type = vk::DescriptorType::eCombinedImageSampler, vk::ImageLayout imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
 
 	private:
-		vk::UniqueDescriptorSet descriptorSet;
+		friend class DescriptorSetCache;
+
+		struct Binding {
+			uint32_t binding;
+			vk::DescriptorType type;
+			uint64_t resourceId;
+			vk::Buffer buffer;
+			vk::DeviceSize offset;
+			vk::DeviceSize range;
+			vk::ImageView imageView;
+			vk::Sampler sampler;
+			vk::ImageLayout imageLayout;
+		};
+
+		vk::DescriptorSetLayout layout;
+		std::vector<Binding> bindings;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,171 @@
+#include "pch.hpp"
+#include "DescriptorSetCache.hpp"
+
+namespace ktw {
+	DescriptorSetCache::DescriptorSetCache(ktw::Context& context, uint32_t setsPerPool, const std::vector<vk::DescriptorPoolSize>& poolSizes) :
+		context(context),
+		setsPerPool(std::max(setsPerPool, 1u)),
+		poolSizes(poolSizes)
+	{
+		resourceDestroyedListener = context.addResourceDestroyedListener([this](uint64_t resourceId) {
+			evict(resourceId);
+		});
+	}
+
+	DescriptorSetCache::~DescriptorSetCache() {
+		context.removeResourceDestroyedListener(resourceDestroyedListener);
+		for(auto descriptorPool : descriptorPools) {
+			context.getDevice().destroyDescriptorPool(descriptorPool);
+		}
+	}
+
+	DescriptorSetCache::Key DescriptorSetCache::makeKey(const ktw::DescriptorSet& descriptorSet) {
+		// Resources are identified by their id, Vulkan handles of destroyed objects can come back
+		Key key = {(uint64_t) static_cast<VkDescriptorSetLayout>(descriptorSet.layout)};
+		for(auto& binding : descriptorSet.bindings) {
+			key.insert(key.end(), {
+				binding.binding,
+				static_cast<uint64_t>(binding.type),
+				binding.resourceId,
+				binding.offset,
+				binding.range,
+				(uint64_t) static_cast<VkImageView>(binding.imageView),
+				(uint64_t) static_cast<VkSampler>(binding.sampler),
+				static_cast<uint64_t>(binding.imageLayout)
+			});
+		}
+		return key;
+	}
+
+	DescriptorSetCache::Entry DescriptorSetCache::allocateDescriptorSet(vk::DescriptorSetLayout layout) {
+		vk::DescriptorSet set;
+		auto allocInfo = vk::DescriptorSetAllocateInfo()
+			.setDescriptorSetCount(1)
+			.setPSetLayouts(&layout);
+
+		if(!descriptorPools.empty()) {
+			allocInfo.setDescriptorPool(descriptorPools.back());
+			if(context.getDevice().allocateDescriptorSets(&allocInfo, &set) == vk::Result::eSuccess) {
+				return {set, descriptorPools.back()};
+			}
+		}
+
+		// Older pools get room back as sets are evicted, they are full again once an allocation fails
+		while(!poolsWithFreeSets.empty()) {
+			vk::DescriptorPool pool = poolsWithFreeSets.back();
+			allocInfo.setDescriptorPool(pool);
+			if(context.getDevice().allocateDescriptorSets(&allocInfo, &set) == vk::Result::eSuccess) {
+				return {set, pool};
+			}
+			poolsWithFreeSets.pop_back();
+		}
+
+		// Sets are freed one by one when evicted, the pools have to allow it
+		auto poolInfo = vk::DescriptorPoolCreateInfo()
+			.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
+			.setPoolSizeCount(static_cast<uint32_t>(poolSizes.size()))
+			.setPPoolSizes(poolSizes.data())
+			.setMaxSets(setsPerPool);
+
+		descriptorPools.push_back(context.getDevice().createDescriptorPool(poolInfo));
+		LOG_INFO("New cached vk::DescriptorPool Created ({} sets)", setsPerPool);
+
+		allocInfo.setDescriptorPool(descriptorPools.back());
+		vk::Result result = context.getDevice().allocateDescriptorSets(&allocInfo, &set);
+		if(result != vk::Result::eSuccess) {
+			throw std::runtime_error("failed to allocate cached descriptor set: " + vk::to_string(result));
+		}
+		return {set, descriptorPools.back()};
+	}
+
+	void DescriptorSetCache::writeDescriptorSet(vk::DescriptorSet set, const ktw::DescriptorSet& descriptorSet) {
+		// Reserved up front, the writes keep pointers into these
+		std::vector<vk::DescriptorBufferInfo> bufferInfos;
+		std::vector<vk::DescriptorImageInfo> imageInfos;
+		bufferInfos.reserve(descriptorSet.bindings.size());
+		imageInfos.reserve(descriptorSet.bindings.size());
+
+		std::vector<vk::WriteDescriptorSet> writes;
+		for(auto& binding : descriptorSet.bindings) {
+			auto write = vk::WriteDescriptorSet()
+				.setDstSet(set)
+				.setDstBinding(binding.binding)
+				.setDescriptorCount(1)
+				.setDescriptorType(binding.type);
+
+			if(binding.buffer) {
+				bufferInfos.push_back(vk::DescriptorBufferInfo(binding.buffer, binding.offset, binding.range));
+				write.setPBufferInfo(&bufferInfos.back());
+			}
+			else {
+				imageInfos.push_back(vk::DescriptorImageInfo(binding.sampler, binding.imageView, binding.imageLayout));
+				write.setPImageInfo(&imageInfos.back());
+			}
+			writes.push_back(write);
+		}
+
+		context.getDevice().updateDescriptorSets(writes, nullptr);
+	}
+
+	vk::DescriptorSet DescriptorSetCache::getDescriptorSet(const ktw::DescriptorSet& descriptorSet) {
+		Key key = makeKey(descriptorSet);
+		auto it = entries.find(key);
+		if(it != entries.end()) {
+			return it->second.set;
+		}
+
+		Entry entry = allocateDescriptorSet(descriptorSet.layout);
+		writeDescriptorSet(entry.set, descriptorSet);
+
+		for(auto& binding : descriptorSet.bindings) {
+			entry.resourceIds.push_back(binding.resourceId);
+		}
+		std::sort(entry.resourceIds.begin(), entry.resourceIds.end());
+		entry.resourceIds.erase(std::unique(entry.resourceIds.begin(), entry.resourceIds.end()), entry.resourceIds.end());
+		for(uint64_t resourceId : entry.resourceIds) {
+			keysByResource[resourceId].push_back(key);
+		}
+		entries[key] = entry;
+		return entry.set;
+	}
+
+	void DescriptorSetCache::evict(uint64_t resourceId) {
+		auto it = keysByResource.find(resourceId);
+		if(it == keysByResource.end()) {
+			return;
+		}
+
+		std::vector<Key> keys = std::move(it->second);
+		keysByResource.erase(it);
+		for(auto& key : keys) {
+			auto entry = entries.find(key);
+			if(entry == entries.end()) {
+				continue;
+			}
+			// The set is gone for the other resources it references too
+			for(uint64_t otherId : entry->second.resourceIds) {
+				auto other = keysByResource.find(otherId);
+				if(other == keysByResource.end()) {
+					continue;
+				}
+				other->second.erase(std::remove(other->second.begin(), other->second.end(), key), other->second.end());
+				if(other->second.empty()) {
+					keysByResource.erase(other);
+				}
+			}
+			retiredEntries.push_back(std::move(entry->second));
+			entries.erase(entry);
+		}
+	}
+
+	void DescriptorSetCache::recycle() {
+		// Called once the frame is rendered, no command buffer references the retired sets anymore
+		for(auto& entry : retiredEntries) {
+			context.getDevice().freeDescriptorSets(entry.pool, entry.set);
+			if(entry.pool != descriptorPools.back() && std::find(poolsWithFreeSets.begin(), poolsWithFreeSets.end(), entry.pool) == poolsWithFreeSets.end()) {
+				poolsWithFreeSets.push_back(entry.pool);
+			}
+		}
+		retiredEntries.clear();
+	}
+}
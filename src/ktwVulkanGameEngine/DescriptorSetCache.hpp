@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Context.hpp"
+#include "DescriptorSet.hpp"
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace ktw {
+	// Long-lived descriptor sets, written once and handed out again to every
+	// identical DescriptorSet description. A set is dropped as soon as one of
+	// the resources it references is destroyed, and freed once the frame that
+	// may still use it has been rendered.
+	class DescriptorSetCache {
+	public:
+		DescriptorSetCache(ktw::Context& context, uint32_t setsPerPool, const std::vector<vk::DescriptorPoolSize>& poolSizes);
+		~DescriptorSetCache();
+		vk::DescriptorSet getDescriptorSet(const ktw::DescriptorSet& descriptorSet);
+		void recycle();
+
+	private:
+		using Key = std::vector<uint64_t>;
+
+		struct Entry {
+			vk::DescriptorSet set;
+			vk::DescriptorPool pool;
+			// Each listed once, the set's key is under each of them in keysByResource
+			std::vector<uint64_t> resourceIds;
+		};
+
+		ktw::Context& context;
+		uint32_t setsPerPool;
+		std::vector<vk::DescriptorPoolSize> poolSizes;
+		std::vector<vk::DescriptorPool> descriptorPools;
+		// Pools sets were freed from since they last ran out, tried before creating a new one
+		std::vector<vk::DescriptorPool> poolsWithFreeSets;
+		std::map<Key, Entry> entries;
+		std::unordered_map<uint64_t, std::vector<Key>> keysByResource;
+		std::vector<Entry> retiredEntries;
+		size_t resourceDestroyedListener;
+
+		Key makeKey(const ktw::DescriptorSet& descriptorSet);
+		Entry allocateDescriptorSet(vk::DescriptorSetLayout layout);
+		void writeDescriptorSet(vk::DescriptorSet set, const ktw::DescriptorSet& descriptorSet);
+		void evict(uint64_t resourceId);
+	};
+}
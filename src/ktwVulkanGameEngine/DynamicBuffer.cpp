@@ -0,0 +1,65 @@
+#include "pch.hpp"
+#include "DynamicBuffer.hpp"
+
+#include <cstring>
+
+namespace ktw {
+	DynamicBuffer::DynamicBuffer(ktw::Context& context, uint32_t itemSize, ktw::BufferUsage usage, uint32_t initialCapacity, uint32_t frameCount) :
+		context(context),
+		itemSize(itemSize),
+		usage(usage),
+		frames(std::max(frameCount, 1u))
+	{
+		for(auto& frame : frames) {
+			frame.buffer = std::make_unique<ktw::Buffer>(context, itemSize, std::max(initialCapacity, 1u), usage, nullptr);
+		}
+
+		LOG_TRACE("Dynamic Buffer Created");
+	}
+
+	void DynamicBuffer::clear() {
+		currentFrame = (currentFrame + 1) % frames.size();
+		// frameCount frames later, the commands of the frame this buffer was filled for have completed
+		frames[currentFrame].retiredBuffers.clear();
+		frames[currentFrame].size = 0;
+	}
+
+	uint32_t DynamicBuffer::append(const void* items, uint32_t count) {
+		Frame& frame = frames[currentFrame];
+		uint32_t first = frame.size;
+		if(first + count > frame.buffer->getCount()) {
+			reserve(std::max(frame.buffer->getCount() * 2, first + count));
+		}
+		memcpy(static_cast<uint8_t*>(frame.buffer->getMappedData()) + static_cast<size_t>(first) * itemSize, items, static_cast<size_t>(count) * itemSize);
+		frame.size += count;
+		return first;
+	}
+
+	void DynamicBuffer::reserve(uint32_t capacity) {
+		Frame& frame = frames[currentFrame];
+		if(capacity <= frame.buffer->getCount()) {
+			return;
+		}
+
+		auto buffer = std::make_unique<ktw::Buffer>(context, itemSize, capacity, usage, nullptr);
+		memcpy(buffer->getMappedData(), frame.buffer->getMappedData(), static_cast<size_t>(frame.size) * itemSize);
+		frame.retiredBuffers.push_back(std::move(frame.buffer));
+		frame.buffer = std::move(buffer);
+	}
+
+	uint32_t DynamicBuffer::size() {
+		return frames[currentFrame].size;
+	}
+
+	uint32_t DynamicBuffer::capacity() {
+		return frames[currentFrame].buffer->getCount();
+	}
+
+	void* DynamicBuffer::data() {
+		return frames[currentFrame].buffer->getMappedData();
+	}
+
+	ktw::Buffer* DynamicBuffer::getBuffer() {
+		return frames[currentFrame].buffer.get();
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Context.hpp"
+#include "Buffer.hpp"
+
+namespace ktw {
+	// Buffer rebuilt every frame (procedural geometry, debug lines, UI...),
+	// filled like a std::vector through persistently mapped memory. Each of
+	// the frameCount frames writes its own buffer, so the CPU never touches
+	// one the GPU may still read. A full buffer is replaced by one twice as
+	// large holding the same items; the old one lives until its frame comes
+	// around again, so draws already recorded from it stay valid.
+	class DynamicBuffer {
+	public:
+		DynamicBuffer(ktw::Context& context, uint32_t itemSize, ktw::BufferUsage usage, uint32_t initialCapacity = 1024, uint32_t frameCount = 2);
+		// Moves to the next frame's buffer, empty. Once per frame, before appending
+		void clear();
+		// Returns the index of the first item appended, to use as firstIndex or vertexOffset
+		uint32_t append(const void* items, uint32_t count);
+		template<typename T>
+		uint32_t push_back(const T& item) {
+			return append(&item, 1);
+		}
+		void reserve(uint32_t capacity);
+		uint32_t size();
+		uint32_t capacity();
+		void* data();
+		// Changes when the buffer grows, get it again after appending
+		ktw::Buffer* getBuffer();
+
+	private:
+		struct Frame {
+			std::unique_ptr<ktw::Buffer> buffer;
+			// Outgrown during the frame, still referenced by its commands
+			std::vector<std::unique_ptr<ktw::Buffer>> retiredBuffers;
+			uint32_t size = 0;
+		};
+
+		ktw::Context& context;
+		uint32_t itemSize;
+		ktw::BufferUsage usage;
+		std::vector<Frame> frames;
+		uint32_t currentFrame = 0;
+	};
+}
@@ -0,0 +1,364 @@
+#include "pch.hpp"
+#include "DynamicBvh.hpp"
+
+#include <cmath>
+
+namespace ktw {
+	namespace {
+		const uint32_t allPlanes = (1u << 6) - 1;
+	}
+
+	bool Aabb::contains(const ktw::Aabb& other) const {
+		return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z
+			&& other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+	}
+
+	bool Aabb::overlaps(const ktw::Aabb& other) const {
+		return min.x <= other.max.x && min.y <= other.max.y && min.z <= other.max.z
+			&& other.min.x <= max.x && other.min.y <= max.y && other.min.z <= max.z;
+	}
+
+	float Aabb::surfaceArea() const {
+		glm::vec3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	ktw::Aabb Aabb::merge(const ktw::Aabb& a, const ktw::Aabb& b) {
+		return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+	}
+
+	DynamicBvh::DynamicBvh(float margin) : margin(margin) {
+		LOG_TRACE("Dynamic BVH Created");
+	}
+
+	uint32_t DynamicBvh::insert(const ktw::Aabb& bounds, uint32_t userData) {
+		uint32_t leaf = allocateNode();
+		nodes[leaf].bounds = {bounds.min - glm::vec3(margin), bounds.max + glm::vec3(margin)};
+		nodes[leaf].userData = userData;
+		nodes[leaf].height = 0;
+		insertLeaf(leaf);
+		leafCount++;
+		return leaf;
+	}
+
+	void DynamicBvh::remove(uint32_t leaf) {
+		removeLeaf(leaf);
+		freeNode(leaf);
+		leafCount--;
+	}
+
+	bool DynamicBvh::move(uint32_t leaf, const ktw::Aabb& bounds, const glm::vec3& displacement) {
+		ktw::Aabb fatBounds = {bounds.min - glm::vec3(margin), bounds.max + glm::vec3(margin)};
+		fatBounds.min += glm::min(displacement, glm::vec3(0.0f));
+		fatBounds.max += glm::max(displacement, glm::vec3(0.0f));
+
+		const ktw::Aabb& treeBounds = nodes[leaf].bounds;
+		if(treeBounds.contains(bounds)) {
+			// Still inside, unless the object shrank or slowed down a lot the stored bounds are kept
+			ktw::Aabb hugeBounds = {fatBounds.min - glm::vec3(4.0f * margin), fatBounds.max + glm::vec3(4.0f * margin)};
+			if(hugeBounds.contains(treeBounds)) {
+				return false;
+			}
+		}
+
+		removeLeaf(leaf);
+		nodes[leaf].bounds = fatBounds;
+		insertLeaf(leaf);
+		return true;
+	}
+
+	uint32_t DynamicBvh::getUserData(uint32_t leaf) const {
+		return nodes[leaf].userData;
+	}
+
+	const ktw::Aabb& DynamicBvh::getFatBounds(uint32_t leaf) const {
+		return nodes[leaf].bounds;
+	}
+
+	uint32_t DynamicBvh::size() const {
+		return leafCount;
+	}
+
+	uint32_t DynamicBvh::getHeight() const {
+		return root == nullNode ? 0 : static_cast<uint32_t>(nodes[root].height);
+	}
+
+	void DynamicBvh::queryFrustum(const ktw::Frustum& frustum, std::vector<uint32_t>& userData) const {
+		if(root == nullNode) {
+			return;
+		}
+		// Each entry carries the planes its node still straddles, a subtree fully
+		// inside some plane skips that plane's test below it
+		TraversalStack traversal(getHeight());
+		TraversalStack planeTraversal(getHeight());
+		uint32_t* stack = traversal.entries;
+		uint32_t* planeMasks = planeTraversal.entries;
+		uint32_t count = 0;
+		stack[count] = root;
+		planeMasks[count++] = allPlanes;
+		while(count > 0) {
+			count--;
+			const Node& node = nodes[stack[count]];
+			uint32_t planeMask = planeMasks[count];
+
+			if(planeMask != 0) {
+				glm::vec3 center = (node.bounds.min + node.bounds.max) * 0.5f;
+				glm::vec3 extent = (node.bounds.max - node.bounds.min) * 0.5f;
+				bool outside = false;
+				for(uint32_t p = 0; p < 6; p++) {
+					if(!(planeMask & (1u << p))) {
+						continue;
+					}
+					const glm::vec4& plane = frustum.planes[p];
+					float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+					float radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+					if(distance < -radius) {
+						outside = true;
+						break;
+					}
+					if(distance >= radius) {
+						planeMask &= ~(1u << p);
+					}
+				}
+				if(outside) {
+					continue;
+				}
+			}
+
+			if(node.isLeaf()) {
+				userData.push_back(node.userData);
+			}
+			else {
+				stack[count] = node.child1;
+				planeMasks[count++] = planeMask;
+				stack[count] = node.child2;
+				planeMasks[count++] = planeMask;
+			}
+		}
+	}
+
+	void DynamicBvh::queryAabb(const ktw::Aabb& bounds, std::vector<uint32_t>& userData) const {
+		if(root == nullNode) {
+			return;
+		}
+		TraversalStack traversal(getHeight());
+		uint32_t* stack = traversal.entries;
+		uint32_t count = 0;
+		stack[count++] = root;
+		while(count > 0) {
+			const Node& node = nodes[stack[--count]];
+			if(!node.bounds.overlaps(bounds)) {
+				continue;
+			}
+			if(node.isLeaf()) {
+				userData.push_back(node.userData);
+			}
+			else {
+				stack[count++] = node.child1;
+				stack[count++] = node.child2;
+			}
+		}
+	}
+
+	void DynamicBvh::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& userData) const {
+		if(root == nullNode) {
+			return;
+		}
+		TraversalStack traversal(getHeight());
+		uint32_t* stack = traversal.entries;
+		uint32_t count = 0;
+		stack[count++] = root;
+		while(count > 0) {
+			const Node& node = nodes[stack[--count]];
+			glm::vec3 offset = glm::clamp(center, node.bounds.min, node.bounds.max) - center;
+			if(glm::dot(offset, offset) > radius * radius) {
+				continue;
+			}
+			if(node.isLeaf()) {
+				userData.push_back(node.userData);
+			}
+			else {
+				stack[count++] = node.child1;
+				stack[count++] = node.child2;
+			}
+		}
+	}
+
+	uint32_t DynamicBvh::allocateNode() {
+		if(freeList == nullNode) {
+			nodes.emplace_back();
+			return static_cast<uint32_t>(nodes.size() - 1);
+		}
+		uint32_t index = freeList;
+		freeList = nodes[index].parent;
+		nodes[index] = Node();
+		return index;
+	}
+
+	void DynamicBvh::freeNode(uint32_t index) {
+		nodes[index].parent = freeList;
+		nodes[index].height = -1;
+		freeList = index;
+	}
+
+	void DynamicBvh::insertLeaf(uint32_t leaf) {
+		if(root == nullNode) {
+			root = leaf;
+			nodes[leaf].parent = nullNode;
+			return;
+		}
+
+		// Surface area heuristic descent: a child is entered while pairing the leaf
+		// below it costs less than pairing it with the current node
+		ktw::Aabb leafBounds = nodes[leaf].bounds;
+		uint32_t index = root;
+		while(!nodes[index].isLeaf()) {
+			const Node& node = nodes[index];
+			float area = node.bounds.surfaceArea();
+			float combinedArea = ktw::Aabb::merge(node.bounds, leafBounds).surfaceArea();
+			// Pairing here adds a parent of the combined area
+			float cost = 2.0f * combinedArea;
+			// Going down grows every ancestor below this one
+			float inheritanceCost = 2.0f * (combinedArea - area);
+
+			auto childCost = [&](uint32_t child) {
+				const Node& childNode = nodes[child];
+				float mergedArea = ktw::Aabb::merge(leafBounds, childNode.bounds).surfaceArea();
+				return (childNode.isLeaf() ? mergedArea : mergedArea - childNode.bounds.surfaceArea()) + inheritanceCost;
+			};
+			float cost1 = childCost(node.child1);
+			float cost2 = childCost(node.child2);
+			if(cost < cost1 && cost < cost2) {
+				break;
+			}
+			index = cost1 < cost2 ? node.child1 : node.child2;
+		}
+
+		uint32_t sibling = index;
+		uint32_t oldParent = nodes[sibling].parent;
+		uint32_t newParent = allocateNode();
+		nodes[newParent].parent = oldParent;
+		nodes[newParent].bounds = ktw::Aabb::merge(leafBounds, nodes[sibling].bounds);
+		nodes[newParent].height = nodes[sibling].height + 1;
+		nodes[newParent].child1 = sibling;
+		nodes[newParent].child2 = leaf;
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+		if(oldParent == nullNode) {
+			root = newParent;
+		}
+		else if(nodes[oldParent].child1 == sibling) {
+			nodes[oldParent].child1 = newParent;
+		}
+		else {
+			nodes[oldParent].child2 = newParent;
+		}
+
+		for(index = nodes[leaf].parent; index != nullNode; index = nodes[index].parent) {
+			index = balance(index);
+			refit(index);
+		}
+	}
+
+	void DynamicBvh::removeLeaf(uint32_t leaf) {
+		if(leaf == root) {
+			root = nullNode;
+			return;
+		}
+
+		uint32_t parent = nodes[leaf].parent;
+		uint32_t grandParent = nodes[parent].parent;
+		uint32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+		freeNode(parent);
+		nodes[sibling].parent = grandParent;
+		if(grandParent == nullNode) {
+			root = sibling;
+			return;
+		}
+
+		if(nodes[grandParent].child1 == parent) {
+			nodes[grandParent].child1 = sibling;
+		}
+		else {
+			nodes[grandParent].child2 = sibling;
+		}
+		for(uint32_t index = grandParent; index != nullNode; index = nodes[index].parent) {
+			index = balance(index);
+			refit(index);
+		}
+	}
+
+	uint32_t DynamicBvh::balance(uint32_t indexA) {
+		Node& a = nodes[indexA];
+		if(a.isLeaf() || a.height < 2) {
+			return indexA;
+		}
+
+		uint32_t indexB = a.child1;
+		uint32_t indexC = a.child2;
+		int32_t difference = nodes[indexC].height - nodes[indexB].height;
+		if(difference >= -1 && difference <= 1) {
+			return indexA;
+		}
+
+		// The higher child takes a's place, a takes its lower grandchild's
+		bool rotateC = difference > 1;
+		uint32_t indexUp = rotateC ? indexC : indexB;
+		Node& up = nodes[indexUp];
+		uint32_t indexF = up.child1;
+		uint32_t indexG = up.child2;
+		uint32_t indexHigher = nodes[indexF].height > nodes[indexG].height ? indexF : indexG;
+		uint32_t indexLower = indexHigher == indexF ? indexG : indexF;
+
+		up.child1 = indexA;
+		up.child2 = indexHigher;
+		up.parent = a.parent;
+		a.parent = indexUp;
+		if(up.parent == nullNode) {
+			root = indexUp;
+		}
+		else if(nodes[up.parent].child1 == indexA) {
+			nodes[up.parent].child1 = indexUp;
+		}
+		else {
+			nodes[up.parent].child2 = indexUp;
+		}
+
+		if(rotateC) {
+			a.child2 = indexLower;
+		}
+		else {
+			a.child1 = indexLower;
+		}
+		nodes[indexLower].parent = indexA;
+		refit(indexA);
+		refit(indexUp);
+		return indexUp;
+	}
+
+	void DynamicBvh::refit(uint32_t index) {
+		Node& node = nodes[index];
+		const Node& child1 = nodes[node.child1];
+		const Node& child2 = nodes[node.child2];
+		node.bounds = ktw::Aabb::merge(child1.bounds, child2.bounds);
+		node.height = 1 + std::max(child1.height, child2.height);
+	}
+
+	bool DynamicBvh::intersectsRay(const ktw::Aabb& bounds, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+		// Slabs. An axis parallel ray has an infinite inverse, which compares
+		// correctly except from a slab plane, where 0 * inf is NaN: the origin is
+		// on the boundary then, inside that slab whatever t is.
+		glm::vec3 t1 = (bounds.min - origin) * inverseDirection;
+		glm::vec3 t2 = (bounds.max - origin) * inverseDirection;
+		float enter = 0.0f;
+		float exit = maxDistance;
+		for(int axis = 0; axis < 3; axis++) {
+			if(std::isnan(t1[axis]) || std::isnan(t2[axis])) {
+				continue;
+			}
+			enter = std::max(enter, std::min(t1[axis], t2[axis]));
+			exit = std::min(exit, std::max(t1[axis], t2[axis]));
+		}
+		return enter <= exit;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <limits>
+#include <vector>
+
+#include "FrustumCuller.hpp"
+
+namespace ktw {
+	struct Aabb {
+		glm::vec3 min;
+		glm::vec3 max;
+
+		bool contains(const ktw::Aabb& other) const;
+		bool overlaps(const ktw::Aabb& other) const;
+		float surfaceArea() const;
+		static ktw::Aabb merge(const ktw::Aabb& a, const ktw::Aabb& b);
+	};
+
+	// Dynamic bounding volume hierarchy over the scene's objects, for
+	// frustum, ray and neighborhood queries in logarithmic time. Leaves are
+	// inserted next to the sibling of least surface area cost and the tree
+	// is kept balanced by rotations. Leaves store their bounds enlarged by a
+	// margin, an object moving within them leaves the tree untouched. Each
+	// leaf carries a user value (an entity index, a culler index...) which
+	// is what queries report.
+	class DynamicBvh {
+	public:
+		static const uint32_t nullNode = std::numeric_limits<uint32_t>::max();
+
+		explicit DynamicBvh(float margin = 0.1f);
+		// Returns the leaf, valid until removed
+		uint32_t insert(const ktw::Aabb& bounds, uint32_t userData);
+		void remove(uint32_t leaf);
+		// displacement is the expected motion until the next move, the leaf's
+		// bounds are stretched along it. Returns whether the leaf was reinserted.
+		bool move(uint32_t leaf, const ktw::Aabb& bounds, const glm::vec3& displacement = glm::vec3(0.0f));
+		uint32_t getUserData(uint32_t leaf) const;
+		const ktw::Aabb& getFatBounds(uint32_t leaf) const;
+		uint32_t size() const;
+		uint32_t getHeight() const;
+		// Queries append the user values of the leaves whose fat bounds match,
+		// the caller refines with the exact bounds when it matters
+		void queryFrustum(const ktw::Frustum& frustum, std::vector<uint32_t>& userData) const;
+		void queryAabb(const ktw::Aabb& bounds, std::vector<uint32_t>& userData) const;
+		void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& userData) const;
+		// hit(userData, maxDistance) returns the distance along the ray at which the
+		// object is hit, or a negative value when it is missed. Subtrees beyond the
+		// closest hit so far are skipped. Returns that hit's user value, or nullNode.
+		template<typename F>
+		uint32_t rayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, F&& hit) const {
+			uint32_t closest = nullNode;
+			if(root == nullNode) {
+				return closest;
+			}
+			glm::vec3 inverseDirection = 1.0f / direction;
+			TraversalStack traversal(getHeight());
+			uint32_t* stack = traversal.entries;
+			uint32_t count = 0;
+			stack[count++] = root;
+			while(count > 0) {
+				const Node& node = nodes[stack[--count]];
+				if(!intersectsRay(node.bounds, origin, inverseDirection, maxDistance)) {
+					continue;
+				}
+				if(node.isLeaf()) {
+					float distance = hit(node.userData, maxDistance);
+					if(distance >= 0.0f && distance <= maxDistance) {
+						maxDistance = distance;
+						closest = node.userData;
+					}
+				}
+				else {
+					stack[count++] = node.child1;
+					stack[count++] = node.child2;
+				}
+			}
+			return closest;
+		}
+
+	private:
+		struct Node {
+			ktw::Aabb bounds;
+			// Next free node when free
+			uint32_t parent = nullNode;
+			uint32_t child1 = nullNode;
+			uint32_t child2 = nullNode;
+			// Leaves are 0, free nodes -1
+			int32_t height = -1;
+			uint32_t userData = 0;
+
+			bool isLeaf() const {
+				return child1 == nullNode;
+			}
+		};
+
+		// Depth first traversal holds at most height + 1 nodes. Rotations keep
+		// the height near log2(n), deeper trees fall back to the heap.
+		static const uint32_t stackSize = 64;
+
+		struct TraversalStack {
+			uint32_t local[stackSize];
+			std::vector<uint32_t> heap;
+			uint32_t* entries = local;
+
+			explicit TraversalStack(uint32_t height) {
+				if(height >= stackSize) {
+					heap.resize(height + 1);
+					entries = heap.data();
+				}
+			}
+		};
+
+		std::vector<Node> nodes;
+		uint32_t root = nullNode;
+		uint32_t freeList = nullNode;
+		uint32_t leafCount = 0;
+		float margin;
+
+		uint32_t allocateNode();
+		void freeNode(uint32_t index);
+		void insertLeaf(uint32_t leaf);
+		void removeLeaf(uint32_t leaf);
+		// Rotates the higher child of index up when the children's heights differ by more than one, returns the new subtree root
+		uint32_t balance(uint32_t index);
+		void refit(uint32_t index);
+		static bool intersectsRay(const ktw::Aabb& bounds, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance);
+	};
+}
@@ -2,11 +2,16 @@
 #include "FrameBuffer.hpp"
 
 namespace ktw {
-	FrameBuffer::FrameBuffer(ktw::Context& context, vk::ImageView imageView, vk::RenderPass renderPass) : width(context.getWidth()), height(context.getHeight()), renderPass(renderPass) {
+	FrameBuffer::FrameBuffer(ktw::Context& context, vk::ImageView imageView, vk::Format format, vk::RenderPass renderPass, ktw::DepthBuffer* depthBuffer) : width(context.getWidth()), height(context.getHeight()), renderPass(renderPass), imageView(imageView), format(format), finalLayout(vk::ImageLayout::eUndefined), depthBuffer(depthBuffer) {
+		std::vector<vk::ImageView> attachments = {imageView};
+		if(depthBuffer) {
+			attachments.push_back(depthBuffer->getImageView());
+		}
+
 		auto framebufferInfo = vk::FramebufferCreateInfo()
 			.setRenderPass(renderPass)
-			.setAttachmentCount(1)
-			.setPAttachments(&imageView)
+			.setAttachmentCount(static_cast<uint32_t>(attachments.size()))
+			.setPAttachments(attachments.data())
 			.setWidth(width)
 			.setHeight(height)
 			.setLayers(1);
@@ -16,6 +21,14 @@ namespace ktw {
 		LOG_TRACE("Framebuffer Created");
 	}
 
+	FrameBuffer::FrameBuffer(ktw::Context& context, vk::Image image, vk::ImageView imageView, vk::Format format, vk::ImageLayout finalLayout, ktw::DepthBuffer* depthBuffer) : width(context.getWidth()), height(context.getHeight()), image(image), imageView(imageView), format(format), finalLayout(finalLayout), depthBuffer(depthBuffer) {
+		if(!context.supportsDynamicRendering()) {
+			throw std::runtime_error("dynamic rendering (VK_KHR_dynamic_rendering) is not supported by this GPU");
+		}
+
+		LOG_TRACE("Framebuffer Created (dynamic rendering)");
+	}
+
 	uint32_t FrameBuffer::getWidth() {
 		return width;
 	}
@@ -25,7 +38,7 @@ namespace ktw {
 	}
 
 	vk::Framebuffer FrameBuffer::getHandle() {
-		return *frameBuffer;
+		return frameBuffer ? *frameBuffer : vk::Framebuffer();
 	}
 
 	ktw::FrameBuffer& FrameBuffer::getFrameBuffer() {
@@ -35,4 +48,28 @@ namespace ktw {
 	vk::RenderPass FrameBuffer::getRenderPass() {
 		return renderPass;
 	}
+
+	vk::Format FrameBuffer::getColorFormat() {
+		return format;
+	}
+
+	vk::Format FrameBuffer::getDepthFormat() {
+		return depthBuffer ? depthBuffer->getFormat() : vk::Format::eUndefined;
+	}
+
+	vk::Image FrameBuffer::getImage() {
+		return image;
+	}
+
+	vk::ImageView FrameBuffer::getImageView() {
+		return imageView;
+	}
+
+	vk::ImageLayout FrameBuffer::getFinalLayout() {
+		return finalLayout;
+	}
+
+	ktw::DepthBuffer* FrameBuffer::getDepthBuffer() {
+		return depthBuffer;
+	}
 }
\ No newline at end of file
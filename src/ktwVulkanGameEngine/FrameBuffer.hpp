@@ -2,20 +2,38 @@
 
 #include "Context.hpp"
 #include "RenderTarget.hpp"
+#include "DepthBuffer.hpp"
 
 namespace ktw {
 	class FrameBuffer : public RenderTarget {
 	public:
-		FrameBuffer(ktw::Context& context, vk::ImageView imageView, vk::RenderPass renderPass);
+		// The render pass has the depth attachment second when a depth buffer is given
+		FrameBuffer(ktw::Context& context, vk::ImageView imageView, vk::Format format, vk::RenderPass renderPass, ktw::DepthBuffer* depthBuffer = nullptr);
+		// Dynamic rendering target, no render pass nor vk::Framebuffer. The image is
+		// left in finalLayout at the end of each command buffer.
+		FrameBuffer(ktw::Context& context, vk::Image image, vk::ImageView imageView, vk::Format format, vk::ImageLayout finalLayout, ktw::DepthBuffer* depthBuffer = nullptr);
 		uint32_t getWidth();
 		uint32_t getHeight();
+		// Null for dynamic rendering targets
 		vk::Framebuffer getHandle();
 		ktw::FrameBuffer& getFrameBuffer();
+		// Null for dynamic rendering targets
 		vk::RenderPass getRenderPass();
+		vk::Format getColorFormat();
+		vk::Format getDepthFormat();
+		vk::Image getImage();
+		vk::ImageView getImageView();
+		vk::ImageLayout getFinalLayout();
+		ktw::DepthBuffer* getDepthBuffer();
 
 	private:
 		vk::UniqueFramebuffer frameBuffer;
 		vk::RenderPass renderPass;
+		vk::Image image;
+		vk::ImageView imageView;
+		vk::Format format;
+		vk::ImageLayout finalLayout;
+		ktw::DepthBuffer* depthBuffer;
 		uint32_t width;
 		uint32_t height;
 	};
@@ -0,0 +1,261 @@
+#include "pch.hpp"
+#include "FrustumCuller.hpp"
+
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define KTW_X86
+	#include <immintrin.h>
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+	#endif
+#endif
+
+// The build passes no instruction set flags, the AVX2 kernel is compiled for it
+// alone and only called once the CPU is known to support it
+#if defined(KTW_X86) && (defined(__GNUC__) || defined(__clang__))
+	#define KTW_TARGET_SSE __attribute__((target("sse2")))
+	#define KTW_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+	#define KTW_TARGET_SSE
+	#define KTW_TARGET_AVX2
+#endif
+
+namespace ktw {
+	namespace {
+		// Padding lanes are never visible, whatever the planes
+		const float paddingRadius = -std::numeric_limits<float>::infinity();
+		// Multiple of the widest kernel, so only the last batch ends on padding
+		const uint32_t batchSize = 16384;
+
+		uint32_t paddedCount(uint32_t count) {
+			return (count + 7) & ~7u;
+		}
+
+		uint32_t cullScalar(const ktw::Frustum& frustum, const float* x, const float* y, const float* z, const float* r, uint32_t begin, uint32_t end, uint32_t* visible) {
+			uint32_t visibleCount = 0;
+			for(uint32_t i = begin; i < end; i++) {
+				bool inside = true;
+				for(const auto& plane : frustum.planes) {
+					inside &= plane.x * x[i] + plane.y * y[i] + plane.z * z[i] + plane.w >= -r[i];
+				}
+				// Written unconditionally, only kept when inside
+				visible[visibleCount] = i;
+				visibleCount += inside;
+			}
+			return visibleCount;
+		}
+
+#ifdef KTW_X86
+		inline int countTrailingZeros(uint32_t bits) {
+#if defined(_MSC_VER) && !defined(__clang__)
+			unsigned long index;
+			_BitScanForward(&index, bits);
+			return static_cast<int>(index);
+#else
+			return __builtin_ctz(bits);
+#endif
+		}
+
+		KTW_TARGET_SSE uint32_t cullSSE(const ktw::Frustum& frustum, const float* x, const float* y, const float* z, const float* r, uint32_t begin, uint32_t end, uint32_t* visible) {
+			__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+			for(int p = 0; p < 6; p++) {
+				planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+				planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+				planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+				planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+			}
+			const __m128 signBit = _mm_set1_ps(-0.0f);
+
+			uint32_t visibleCount = 0;
+			for(uint32_t i = begin; i < end; i += 4) {
+				__m128 centerX = _mm_loadu_ps(x + i);
+				__m128 centerY = _mm_loadu_ps(y + i);
+				__m128 centerZ = _mm_loadu_ps(z + i);
+				__m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(r + i), signBit);
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for(int p = 0; p < 6; p++) {
+					__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], centerX), _mm_mul_ps(planeY[p], centerY)), _mm_add_ps(_mm_mul_ps(planeZ[p], centerZ), planeW[p]));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+				}
+				uint32_t bits = static_cast<uint32_t>(_mm_movemask_ps(inside));
+				while(bits) {
+					visible[visibleCount++] = i + countTrailingZeros(bits);
+					bits &= bits - 1;
+				}
+			}
+			return visibleCount;
+		}
+
+		KTW_TARGET_AVX2 uint32_t cullAVX2(const ktw::Frustum& frustum, const float* x, const float* y, const float* z, const float* r, uint32_t begin, uint32_t end, uint32_t* visible) {
+			__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+			for(int p = 0; p < 6; p++) {
+				planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+				planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+				planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+				planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+			}
+			const __m256 signBit = _mm256_set1_ps(-0.0f);
+
+			uint32_t visibleCount = 0;
+			for(uint32_t i = begin; i < end; i += 8) {
+				__m256 centerX = _mm256_loadu_ps(x + i);
+				__m256 centerY = _mm256_loadu_ps(y + i);
+				__m256 centerZ = _mm256_loadu_ps(z + i);
+				__m256 negativeRadius = _mm256_xor_ps(_mm256_loadu_ps(r + i), signBit);
+				__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for(int p = 0; p < 6; p++) {
+					__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], centerX), _mm256_mul_ps(planeY[p], centerY)), _mm256_add_ps(_mm256_mul_ps(planeZ[p], centerZ), planeW[p]));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+				}
+				uint32_t bits = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+				while(bits) {
+					visible[visibleCount++] = i + countTrailingZeros(bits);
+					bits &= bits - 1;
+				}
+			}
+			return visibleCount;
+		}
+
+		bool cpuSupportsAVX2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+			int info[4];
+			__cpuid(info, 1);
+			// The OS has to save the AVX registers too
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			if(!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+				return false;
+			}
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+#endif
+	}
+
+	Frustum::Frustum(const glm::mat4& matrix) {
+		glm::vec4 rows[4];
+		for(int i = 0; i < 4; i++) {
+			rows[i] = glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]);
+		}
+		// The near plane is w + z >= 0 so it also holds for 0..1 depth
+		planes[0] = rows[3] + rows[0];
+		planes[1] = rows[3] - rows[0];
+		planes[2] = rows[3] + rows[1];
+		planes[3] = rows[3] - rows[1];
+		planes[4] = rows[3] + rows[2];
+		planes[5] = rows[3] - rows[2];
+		for(auto& plane : planes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+	}
+
+	bool Frustum::intersects(const glm::vec3& center, float radius) const {
+		for(const auto& plane : planes) {
+			if(glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	uint32_t FrustumCuller::add(const glm::vec3& center, float radius) {
+		resize(count + 1);
+		set(count - 1, center, radius);
+		return count - 1;
+	}
+
+	void FrustumCuller::set(uint32_t index, const glm::vec3& center, float radius) {
+		centerX[index] = center.x;
+		centerY[index] = center.y;
+		centerZ[index] = center.z;
+		this->radius[index] = radius;
+	}
+
+	void FrustumCuller::resize(uint32_t count) {
+		uint32_t padded = paddedCount(count);
+		centerX.resize(padded, 0.0f);
+		centerY.resize(padded, 0.0f);
+		centerZ.resize(padded, 0.0f);
+		radius.resize(padded, paddingRadius);
+		// Objects dropped by a shrink become padding
+		std::fill(radius.begin() + count, radius.end(), paddingRadius);
+		this->count = count;
+	}
+
+	void FrustumCuller::clear() {
+		resize(0);
+	}
+
+	uint32_t FrustumCuller::size() const {
+		return count;
+	}
+
+	void FrustumCuller::cull(const ktw::Frustum& frustum, std::vector<uint32_t>& visible, ktw::JobSystem* jobSystem) {
+		if(count == 0) {
+			return;
+		}
+		uint32_t padded = paddedCount(count);
+		if(scratchSize < padded) {
+			scratch = std::make_unique<uint32_t[]>(padded);
+			scratchSize = padded;
+		}
+
+		if(!jobSystem || count <= batchSize) {
+			uint32_t visibleCount = cullRange(frustum, 0, padded, scratch.get());
+			visible.insert(visible.end(), scratch.get(), scratch.get() + visibleCount);
+			return;
+		}
+
+		// Each batch compacts into its own slice of the scratch buffer, the
+		// slices are then packed in order
+		uint32_t batchCount = (padded + batchSize - 1) / batchSize;
+		std::vector<uint32_t> visibleCounts(batchCount);
+		jobSystem->parallelFor(padded, batchSize, [&](uint32_t begin, uint32_t end) {
+			visibleCounts[begin / batchSize] = cullRange(frustum, begin, end, scratch.get() + begin);
+		});
+
+		uint32_t total = 0;
+		for(uint32_t visibleCount : visibleCounts) {
+			total += visibleCount;
+		}
+		visible.reserve(visible.size() + total);
+		for(uint32_t batch = 0; batch < batchCount; batch++) {
+			uint32_t* begin = scratch.get() + batch * batchSize;
+			visible.insert(visible.end(), begin, begin + visibleCounts[batch]);
+		}
+	}
+
+	void FrustumCuller::setInstructionSet(InstructionSet instructionSet) {
+		this->instructionSet = std::min(instructionSet, getSupportedInstructionSet());
+	}
+
+	FrustumCuller::InstructionSet FrustumCuller::getInstructionSet() const {
+		return instructionSet;
+	}
+
+	FrustumCuller::InstructionSet FrustumCuller::getSupportedInstructionSet() {
+#ifdef KTW_X86
+		static const InstructionSet supported = cpuSupportsAVX2() ? InstructionSet::eAVX2 : InstructionSet::eSSE;
+		return supported;
+#else
+		return InstructionSet::eScalar;
+#endif
+	}
+
+	uint32_t FrustumCuller::cullRange(const ktw::Frustum& frustum, uint32_t begin, uint32_t end, uint32_t* visible) const {
+		switch(instructionSet) {
+#ifdef KTW_X86
+		case InstructionSet::eAVX2:
+			return cullAVX2(frustum, centerX.data(), centerY.data(), centerZ.data(), radius.data(), begin, end, visible);
+		case InstructionSet::eSSE:
+			return cullSSE(frustum, centerX.data(), centerY.data(), centerZ.data(), radius.data(), begin, end, visible);
+#endif
+		default:
+			return cullScalar(frustum, centerX.data(), centerY.data(), centerZ.data(), radius.data(), begin, end, visible);
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "JobSystem.hpp"
+
+namespace ktw {
+	// Planes facing inwards, normalized, extracted from a view projection
+	// matrix (Gribb-Hartmann). Multiplied by a model matrix first, they are
+	// in that model's object space.
+	struct Frustum {
+		glm::vec4 planes[6];
+
+		Frustum() = default;
+		explicit Frustum(const glm::mat4& matrix);
+		bool intersects(const glm::vec3& center, float radius) const;
+	};
+
+	// Visibility of many objects at once. Bounding spheres are kept as
+	// structure of arrays (x, y, z, radius) so each plane is tested against
+	// 8 spheres per AVX2 instruction, 4 with SSE, with a scalar fallback on
+	// other CPUs. Objects are indexed densely by the caller; boxes go in as
+	// their bounding sphere.
+	class FrustumCuller {
+	public:
+		enum class InstructionSet {
+			eScalar,
+			eSSE,
+			eAVX2
+		};
+
+		uint32_t add(const glm::vec3& center, float radius);
+		void set(uint32_t index, const glm::vec3& center, float radius);
+		void resize(uint32_t count);
+		void clear();
+		uint32_t size() const;
+		// Appends the indices of the visible objects to visible, in increasing order.
+		// Large sets are split over the job system when one is given.
+		void cull(const ktw::Frustum& frustum, std::vector<uint32_t>& visible, ktw::JobSystem* jobSystem = nullptr);
+		// The best one the CPU supports is used by default, lower ones can be forced for comparison
+		void setInstructionSet(InstructionSet instructionSet);
+		InstructionSet getInstructionSet() const;
+		static InstructionSet getSupportedInstructionSet();
+
+	private:
+		// Padded to a multiple of 8, padding spheres have an infinitely negative radius and are never visible
+		std::vector<float> centerX;
+		std::vector<float> centerY;
+		std::vector<float> centerZ;
+		std::vector<float> radius;
+		uint32_t count = 0;
+		InstructionSet instructionSet = getSupportedInstructionSet();
+		// Visible indices of each batch before they are packed into the output
+		std::unique_ptr<uint32_t[]> scratch;
+		uint32_t scratchSize = 0;
+
+		uint32_t cullRange(const ktw::Frustum& frustum, uint32_t begin, uint32_t end, uint32_t* visible) const;
+	};
+}
@@ -0,0 +1,156 @@
+#include "pch.hpp"
+#include "GeometryArena.hpp"
+
+#include <cstring>
+#include <limits>
+
+namespace ktw {
+	namespace {
+		const uint32_t noRange = std::numeric_limits<uint32_t>::max();
+
+		bool sameLayout(const ktw::VertexBufferBinding& a, const ktw::VertexBufferBinding& b) {
+			// The binding number is the pipeline's business, only the vertex layout matters
+			return a.size == b.size && std::equal(a.attributeDescriptions.begin(), a.attributeDescriptions.end(), b.attributeDescriptions.begin(), b.attributeDescriptions.end(), [](const ktw::AttributeDescription& x, const ktw::AttributeDescription& y) {
+				return x.location == y.location && x.format == y.format && x.offset == y.offset;
+			});
+		}
+
+		// First fit, the lowest offsets are reused first so pools stay packed
+		uint32_t allocateRange(std::map<uint32_t, uint32_t>& freeRanges, uint32_t size) {
+			for(auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+				if(it->second >= size) {
+					uint32_t offset = it->first;
+					uint32_t remaining = it->second - size;
+					freeRanges.erase(it);
+					if(remaining > 0) {
+						freeRanges[offset + size] = remaining;
+					}
+					return offset;
+				}
+			}
+			return noRange;
+		}
+
+		void freeRange(std::map<uint32_t, uint32_t>& freeRanges, uint32_t offset, uint32_t size) {
+			auto next = freeRanges.lower_bound(offset);
+			if(next != freeRanges.end() && offset + size == next->first) {
+				size += next->second;
+				next = freeRanges.erase(next);
+			}
+			if(next != freeRanges.begin()) {
+				auto previous = std::prev(next);
+				if(previous->first + previous->second == offset) {
+					previous->second += size;
+					return;
+				}
+			}
+			freeRanges[offset] = size;
+		}
+	}
+
+	GeometryArena::GeometryArena(ktw::Context& context, vk::DeviceSize vertexPoolSize, uint32_t indexPoolCount) :
+		context(context),
+		vertexPoolSize(vertexPoolSize),
+		indexPoolCount(indexPoolCount)
+	{
+		LOG_TRACE("Geometry Arena Created");
+	}
+
+	ktw::GeometryAllocation GeometryArena::allocate(const ktw::VertexBufferBinding& vertexBufferBinding, uint32_t vertexCount, uint32_t indexCount) {
+		if(vertexBufferBinding.size == 0) {
+			throw std::runtime_error("geometry arena: vertex layout has no stride");
+		}
+		uint32_t indexSize = vertexCount <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for(auto& pool : pools) {
+			if(pool->indexBuffer->getItemSize() != indexSize || !sameLayout(pool->vertexBufferBinding, vertexBufferBinding)) {
+				continue;
+			}
+			uint32_t firstVertex = allocateRange(pool->freeVertices, vertexCount);
+			if(firstVertex == noRange) {
+				continue;
+			}
+			uint32_t firstIndex = allocateRange(pool->freeIndices, indexCount);
+			if(firstIndex == noRange) {
+				freeRange(pool->freeVertices, firstVertex, vertexCount);
+				continue;
+			}
+			return {pool->vertexBuffer.get(), pool->indexBuffer.get(), firstVertex, vertexCount, firstIndex, indexCount};
+		}
+
+		auto pool = std::make_unique<Pool>();
+		uint32_t poolVertexCount = std::max(static_cast<uint32_t>(std::min<vk::DeviceSize>(vertexPoolSize / vertexBufferBinding.size, std::numeric_limits<uint32_t>::max())), vertexCount);
+		uint32_t poolIndexCount = std::max(indexPoolCount, indexCount);
+		pool->vertexBufferBinding = vertexBufferBinding;
+		pool->vertexBuffer = std::make_unique<ktw::Buffer>(context, vertexBufferBinding.size, poolVertexCount, ktw::BufferUsage::eVertexBuffer, nullptr);
+		pool->indexBuffer = std::make_unique<ktw::Buffer>(context, indexSize, poolIndexCount, ktw::BufferUsage::eIndexBuffer, nullptr);
+		// Mapped here, under the lock, so concurrent writes never race to map it
+		pool->vertexBuffer->getMappedData();
+		pool->indexBuffer->getMappedData();
+		if(poolVertexCount > vertexCount) {
+			pool->freeVertices[vertexCount] = poolVertexCount - vertexCount;
+		}
+		if(poolIndexCount > indexCount) {
+			pool->freeIndices[indexCount] = poolIndexCount - indexCount;
+		}
+		pools.push_back(std::move(pool));
+
+		LOG_TRACE("Geometry Pool Created ({} vertices of {} bytes, {} {}-bit indices)", poolVertexCount, vertexBufferBinding.size, poolIndexCount, indexSize * 8);
+		return {pools.back()->vertexBuffer.get(), pools.back()->indexBuffer.get(), 0, vertexCount, 0, indexCount};
+	}
+
+	void GeometryArena::free(const ktw::GeometryAllocation& allocation) {
+		std::lock_guard<std::mutex> lock(mutex);
+		Pool* pool = findPool(allocation.vertexBuffer);
+		if(allocation.vertexCount > 0) {
+			freeRange(pool->freeVertices, allocation.firstVertex, allocation.vertexCount);
+		}
+		if(allocation.indexCount > 0) {
+			freeRange(pool->freeIndices, allocation.firstIndex, allocation.indexCount);
+		}
+	}
+
+	void GeometryArena::write(const ktw::GeometryAllocation& allocation, const void* vertices, const void* indices, uint32_t indexSize) {
+		// Ranges are disjoint, only the lookup needs the lock
+		Pool* pool;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pool = findPool(allocation.vertexBuffer);
+		}
+		uint32_t stride = pool->vertexBufferBinding.size;
+		if(allocation.vertexCount > 0) {
+			pool->vertexBuffer->setData(vertices, static_cast<vk::DeviceSize>(allocation.firstVertex) * stride, static_cast<vk::DeviceSize>(allocation.vertexCount) * stride);
+		}
+		if(allocation.indexCount == 0) {
+			return;
+		}
+
+		uint32_t poolIndexSize = pool->indexBuffer->getItemSize();
+		vk::DeviceSize offset = static_cast<vk::DeviceSize>(allocation.firstIndex) * poolIndexSize;
+		vk::DeviceSize size = static_cast<vk::DeviceSize>(allocation.indexCount) * poolIndexSize;
+		if(indexSize == poolIndexSize) {
+			pool->indexBuffer->setData(indices, offset, size);
+		}
+		else if(poolIndexSize == sizeof(uint16_t)) {
+			// Fits by construction: the pool was picked for at most 65536 vertices
+			const uint32_t* wide = static_cast<const uint32_t*>(indices);
+			std::vector<uint16_t> narrow(wide, wide + allocation.indexCount);
+			pool->indexBuffer->setData(narrow.data(), offset, size);
+		}
+		else {
+			const uint16_t* narrow = static_cast<const uint16_t*>(indices);
+			std::vector<uint32_t> wide(narrow, narrow + allocation.indexCount);
+			pool->indexBuffer->setData(wide.data(), offset, size);
+		}
+	}
+
+	GeometryArena::Pool* GeometryArena::findPool(ktw::Buffer* vertexBuffer) {
+		for(auto& pool : pools) {
+			if(pool->vertexBuffer.get() == vertexBuffer) {
+				return pool.get();
+			}
+		}
+		throw std::runtime_error("geometry arena: allocation does not belong to this arena");
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+
+#include "Context.hpp"
+#include "Buffer.hpp"
+#include "GraphicsPipeline.hpp"
+
+namespace ktw {
+	// Ranges of a pool's vertex and index buffers. Indices stay local to the
+	// allocation: draws pass firstIndex and firstVertex as vertexOffset.
+	struct GeometryAllocation {
+		ktw::Buffer* vertexBuffer = nullptr;
+		ktw::Buffer* indexBuffer = nullptr;
+		uint32_t firstVertex = 0;
+		uint32_t vertexCount = 0;
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+	};
+
+	// Shared vertex and index buffers meshes are sub-allocated from, so
+	// consecutive draws of meshes with the same vertex layout need no buffer
+	// binding in between. Each layout gets pools of large buffers, a pool that
+	// is full is never moved or grown, another one is added next to it.
+	// Allocations of at most 65536 vertices go to pools of 16-bit indices.
+	// Meshes may be allocated, written and freed from several jobs at once.
+	class GeometryArena {
+	public:
+		// Pool capacities, a larger allocation gets a pool of its own size
+		GeometryArena(ktw::Context& context, vk::DeviceSize vertexPoolSize = 64 << 20, uint32_t indexPoolCount = 8 << 20);
+		ktw::GeometryAllocation allocate(const ktw::VertexBufferBinding& vertexBufferBinding, uint32_t vertexCount, uint32_t indexCount);
+		// The caller makes sure no command in flight still draws from the ranges
+		void free(const ktw::GeometryAllocation& allocation);
+		// indexSize is the size of the given indices, they are converted to the pool's
+		void write(const ktw::GeometryAllocation& allocation, const void* vertices, const void* indices, uint32_t indexSize);
+
+	private:
+		struct Pool {
+			ktw::VertexBufferBinding vertexBufferBinding;
+			std::unique_ptr<ktw::Buffer> vertexBuffer;
+			std::unique_ptr<ktw::Buffer> indexBuffer;
+			// Offset to size, adjacent free ranges are merged
+			std::map<uint32_t, uint32_t> freeVertices;
+			std::map<uint32_t, uint32_t> freeIndices;
+		};
+
+		ktw::Context& context;
+		std::mutex mutex;
+		vk::DeviceSize vertexPoolSize;
+		uint32_t indexPoolCount;
+		std::vector<std::unique_ptr<Pool>> pools;
+
+		Pool* findPool(ktw::Buffer* vertexBuffer);
+	};
+}
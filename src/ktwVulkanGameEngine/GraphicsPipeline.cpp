@@ -1,20 +1,54 @@
 #include "pch.hpp"
 #include "GraphicsPipeline.hpp"
+#include "ShaderWatcher.hpp"
 
 namespace ktw {
-	GraphicsPipeline::GraphicsPipeline(ktw::Context& context, ktw::RenderTarget& renderTarget, const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const std::vector<ktw::VertexBufferBinding>& vertexBufferBindings, const std::vector<ktw::UniformDescriptor>& uniformDescriptors) {
-		ktw::Shader vertexShader(context, vertexShaderFile);
-		ktw::Shader fragmentShader(context, fragmentShaderFile);
+	GraphicsPipeline::GraphicsPipeline(ktw::Context& context, ktw::LayoutCache& layoutCache, ktw::RenderTarget& renderTarget, const ktw::ShaderSource& vertexShaderSource, const ktw::ShaderSource& fragmentShaderSource, const std::vector<ktw::VertexBufferBinding>& vertexBufferBindings, const std::vector<ktw::UniformDescriptor>& uniformDescriptors, const ktw::SpecializationConstants& specializationConstants, ktw::DepthMode depthMode, ktw::ShaderWatcher* shaderWatcher) :
+		context(context),
+		renderTarget(renderTarget),
+		shaderWatcher(shaderWatcher),
+		vertexBufferBindings(vertexBufferBindings),
+		specializationConstants(specializationConstants),
+		depthMode(depthMode)
+	{
+		vertexShader = std::make_unique<ktw::Shader>(context, vertexShaderSource);
+		fragmentShader = std::make_unique<ktw::Shader>(context, fragmentShaderSource);
+
+		createLayouts(layoutCache, uniformDescriptors);
+		createVertexBufferBindings();
+
+		pipeline = createPipeline(*vertexShader, *fragmentShader);
+		if(depthMode == ktw::DepthMode::ePrePass) {
+			depthPipeline = createPipeline(*vertexShader, *fragmentShader, true);
+		}
+		LOG_TRACE("Graphics Pipeline Created");
+
+		if(shaderWatcher) {
+			shaderWatcher->watch(this);
+		}
+	}
+
+	GraphicsPipeline::~GraphicsPipeline() {
+		if(shaderWatcher) {
+			shaderWatcher->unwatch(this);
+		}
+	}
+
+	vk::UniquePipeline GraphicsPipeline::createPipeline(ktw::Shader& vertex, ktw::Shader& fragment, bool depthOnly) {
+		vk::SpecializationInfo specializationInfo = specializationConstants.getInfo();
+		const vk::SpecializationInfo* pSpecializationInfo = specializationConstants.empty() ? nullptr : &specializationInfo;
 
 		auto vertShaderStageInfo = vk::PipelineShaderStageCreateInfo()
 			.setStage(vk::ShaderStageFlagBits::eVertex)
-			.setModule(*(vertexShader.getModule()))
-			.setPName("main");
+			.setModule(*(vertex.getModule()))
+			.setPName("main")
+			.setPSpecializationInfo(pSpecializationInfo);
 
 		auto fragShaderStageInfo = vk::PipelineShaderStageCreateInfo()
 			.setStage(vk::ShaderStageFlagBits::eFragment)
-			.setModule(*(fragmentShader.getModule()))
-			.setPName("main");
+			.setModule(*(fragment.getModule()))
+			.setPName("main")
+			.setPSpecializationInfo(pSpecializationInfo);
 
 		vk::PipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
@@ -50,22 +84,6 @@ namespace ktw {
 			.setTopology(vk::PrimitiveTopology::eTriangleList)
 			.setPrimitiveRestartEnable(false);
 
-		std::vector<vk::DescriptorSetLayoutBinding> uboLayoutBindings(uniformDescriptors.size());
-		for(size_t i = 0; i < uniformDescriptors.size(); i++) {
-			uboLayoutBindings[i]
-				.setBinding(uniformDescriptors[i].binding)
-				.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-				.setDescriptorCount(1)
-				.setStageFlags((vk::ShaderStageFlagBits) uniformDescriptors[i].stage)
-				.setPImmutableSamplers({}); // Optional
-		}
-
-		auto layoutInfo = vk::DescriptorSetLayoutCreateInfo()
-			.setBindingCount(static_cast<uint32_t>(uboLayoutBindings.size()))
-			.setPBindings(uboLayoutBindings.data());
-
-		descriptorSetLayout = context.getDevice().createDescriptorSetLayoutUnique(layoutInfo);
-
 		auto viewport = vk::Viewport()
 			.setX(0.0f)
 			.setY(0.0f)
@@ -104,8 +122,17 @@ namespace ktw {
 			.setAlphaToCoverageEnable(false) // Optional
 			.setAlphaToOneEnable(false); // Optional
 
+		// Ignored by render passes without a depth attachment. After a pre-pass the
+		// depth buffer already holds the nearest depth, only that fragment is shaded.
+		auto depthStencil = vk::PipelineDepthStencilStateCreateInfo()
+			.setDepthTestEnable(depthMode != ktw::DepthMode::eDisabled)
+			.setDepthWriteEnable(depthMode == ktw::DepthMode::eReadWrite || depthOnly)
+			.setDepthCompareOp(depthMode == ktw::DepthMode::eReadWrite || depthOnly ? vk::CompareOp::eLess : vk::CompareOp::eLessOrEqual)
+			.setDepthBoundsTestEnable(false)
+			.setStencilTestEnable(false);
+
 		auto colorBlendAttachment = vk::PipelineColorBlendAttachmentState()
-			.setColorWriteMask(
+			.setColorWriteMask(depthOnly ? vk::ColorComponentFlags() :
 				vk::ColorComponentFlagBits::eR |
 				vk::ColorComponentFlagBits::eG |
 				vk::ColorComponentFlagBits::eB |
@@ -128,43 +155,249 @@ namespace ktw {
 
 		vk::DynamicState dynamicStates[] = {
 			vk::DynamicState::eViewport,
-			vk::DynamicState::eLineWidth
+			vk::DynamicState::eScissor
 		};
 
 		auto dynamicState = vk::PipelineDynamicStateCreateInfo()
 			.setDynamicStateCount(2)
 			.setPDynamicStates(dynamicStates);
 
-		auto pipelineLayoutInfo = vk::PipelineLayoutCreateInfo()
-			.setSetLayoutCount(1)
-			.setPSetLayouts(&(*descriptorSetLayout))
-			.setPushConstantRangeCount(0) // Optional
-			.setPPushConstantRanges(nullptr); // Optional
-
-		pipelineLayout = context.getDevice().createPipelineLayoutUnique(pipelineLayoutInfo);
+		// Without a render pass the pipeline only depends on the attachment formats,
+		// the viewport is set by the command buffer so it fits targets of any size
+		vk::RenderPass renderPass = renderTarget.getRenderPass();
+		vk::Format colorFormat = renderTarget.getColorFormat();
+		auto renderingInfo = vk::PipelineRenderingCreateInfoKHR()
+			.setColorAttachmentCount(1)
+			.setPColorAttachmentFormats(&colorFormat)
+			.setDepthAttachmentFormat(renderTarget.getDepthFormat());
 
 		auto pipelineInfo = vk::GraphicsPipelineCreateInfo()
-			.setStageCount(2)
+			.setPNext(renderPass ? nullptr : &renderingInfo)
+			.setStageCount(depthOnly ? 1 : 2)
 			.setPStages(shaderStages)
 			.setPVertexInputState(&vertexInputInfo)
 			.setPInputAssemblyState(&inputAssembly)
 			.setPViewportState(&viewportState)
 			.setPRasterizationState(&rasterizer)
 			.setPMultisampleState(&multisampling)
-			.setPDepthStencilState(nullptr) // Optional
+			.setPDepthStencilState(&depthStencil)
 			.setPColorBlendState(&colorBlending)
-			.setPDynamicState(nullptr) // Optional
-			.setLayout(*pipelineLayout)
-			.setRenderPass(renderTarget.getRenderPass())
+			.setPDynamicState(renderPass ? nullptr : &dynamicState)
+			.setLayout(pipelineLayout)
+			.setRenderPass(renderPass)
 			.setSubpass(0)
 			.setBasePipelineHandle(nullptr) // Optional
 			.setBasePipelineIndex(-1); // Optional
 
-		pipeline = (context.getDevice().createGraphicsPipelineUnique(nullptr, pipelineInfo)).value;
-		LOG_TRACE("Graphics Pipeline Created");
+		return (context.getDevice().createGraphicsPipelineUnique(nullptr, pipelineInfo)).value;
+	}
+
+	std::vector<ktw::ReflectedDescriptorBinding> GraphicsPipeline::mergeDescriptorBindings(ktw::Shader& vertex, ktw::Shader& fragment) {
+		std::map<std::pair<uint32_t, uint32_t>, ktw::ReflectedDescriptorBinding> merged;
+		for(auto shader : {&vertex, &fragment}) {
+			for(auto& binding : shader->getReflection().getDescriptorBindings()) {
+				auto it = merged.find({binding.set, binding.binding});
+				if(it == merged.end()) {
+					merged[{binding.set, binding.binding}] = binding;
+				}
+				else if(it->second.type != binding.type || it->second.count != binding.count) {
+					throw std::runtime_error("shader stages disagree on descriptor set " + std::to_string(binding.set) + " binding " + std::to_string(binding.binding));
+				}
+			}
+		}
+
+		std::vector<ktw::ReflectedDescriptorBinding> bindings;
+		for(auto& [key, binding] : merged) {
+			bindings.push_back(binding);
+		}
+		return bindings;
+	}
+
+	void GraphicsPipeline::createLayouts(ktw::LayoutCache& layoutCache, const std::vector<ktw::UniformDescriptor>& uniformDescriptors) {
+		descriptorBindings = mergeDescriptorBindings(*vertexShader, *fragmentShader);
+		pushConstantSize = std::max(vertexShader->getReflection().getPushConstantSize(), fragmentShader->getReflection().getPushConstantSize());
+
+		// Hand-written descriptors are no longer needed, only check they still match the shaders
+		for(auto& uniformDescriptor : uniformDescriptors) {
+			auto it = std::find_if(descriptorBindings.begin(), descriptorBindings.end(), [&](const ktw::ReflectedDescriptorBinding& binding) {
+				return binding.set == 0 && binding.binding == uniformDescriptor.binding;
+			});
+			if(it == descriptorBindings.end() || it->type != uniformDescriptor.type) {
+				LOG_WARN("UniformDescriptor binding {} does not match any {} of the shaders", uniformDescriptor.binding, vk::to_string(uniformDescriptor.type));
+			}
+		}
+
+		vk::DescriptorSetLayout bindlessLayout = layoutCache.getBindlessLayout();
+
+		uint32_t setCount = descriptorBindings.empty() ? 0 : descriptorBindings.back().set + 1;
+		if(bindlessLayout) {
+			// Set 0 is always the bindless heap so it stays bound whatever the pipeline
+			setCount = std::max(setCount, 1u);
+		}
+
+		std::vector<std::vector<vk::DescriptorSetLayoutBinding>> sets(setCount);
+		for(auto& binding : descriptorBindings) {
+			if(bindlessLayout && binding.set == 0) {
+				auto& bindlessBindings = layoutCache.getBindlessBindings();
+				auto it = std::find_if(bindlessBindings.begin(), bindlessBindings.end(), [&](const vk::DescriptorSetLayoutBinding& bindlessBinding) {
+					return bindlessBinding.binding == binding.binding;
+				});
+				if(it == bindlessBindings.end() || it->descriptorType != binding.type) {
+					throw std::runtime_error("set 0 is reserved for the bindless heap, binding " + std::to_string(binding.binding) + " does not match it");
+				}
+				continue;
+			}
+			if(binding.count == 0) {
+				throw std::runtime_error("unsized descriptor arrays are not supported (set " + std::to_string(binding.set) + " binding " + std::to_string(binding.binding) + ")");
+			}
+			sets[binding.set].push_back(vk::DescriptorSetLayoutBinding(binding.binding, binding.type, binding.count, vk::ShaderStageFlagBits::eAllGraphics));
+		}
+
+		for(size_t i = 0; i < sets.size(); i++) {
+			descriptorSetLayouts.push_back(bindlessLayout && i == 0 ? bindlessLayout : layoutCache.getDescriptorSetLayout(sets[i]));
+		}
+
+		pipelineLayout = layoutCache.getPipelineLayout(descriptorSetLayouts, pushConstantSize);
+	}
+
+	void GraphicsPipeline::createVertexBufferBindings() {
+		auto& inputAttributes = vertexShader->getReflection().getInputAttributes();
+
+		if(!vertexBufferBindings.empty()) {
+			for(auto& input : inputAttributes) {
+				bool provided = false;
+				for(auto& binding : vertexBufferBindings) {
+					for(auto& attribute : binding.attributeDescriptions) {
+						provided = provided || attribute.location == input.location;
+					}
+				}
+				if(!provided) {
+					LOG_WARN("Vertex input location {} is not provided by any VertexBufferBinding", input.location);
+				}
+			}
+
+			// Most compact formats are optional for vertex input, fail here rather than in the driver
+			for(auto& binding : vertexBufferBindings) {
+				for(auto& attribute : binding.attributeDescriptions) {
+					vk::FormatProperties properties = context.getPhysicalDevice().getFormatProperties(static_cast<vk::Format>(attribute.format));
+					if(!(properties.bufferFeatures & vk::FormatFeatureFlagBits::eVertexBuffer)) {
+						throw std::runtime_error("vertex format " + vk::to_string(static_cast<vk::Format>(attribute.format)) + " (location " + std::to_string(attribute.location) + ") is not supported by this GPU");
+					}
+				}
+			}
+			return;
+		}
+
+		if(inputAttributes.empty()) {
+			return;
+		}
+
+		// No layout given: one binding with the attributes tightly packed in location order
+		ktw::VertexBufferBinding binding = {0, 0, {}};
+		for(auto& input : inputAttributes) {
+			ktw::Format format;
+			switch(input.format) {
+				case vk::Format::eR32G32B32A32Sfloat: format = ktw::Format::eFloat4; break;
+				case vk::Format::eR32G32B32Sfloat: format = ktw::Format::eFloat3; break;
+				case vk::Format::eR32G32Sfloat: format = ktw::Format::eFloat2; break;
+				case vk::Format::eR32Sfloat: format = ktw::Format::eFloat; break;
+				case vk::Format::eR32Sint: format = ktw::Format::eInt; break;
+				case vk::Format::eR32Uint: format = ktw::Format::eUInt; break;
+				default: throw std::runtime_error("cannot derive a vertex layout for input location " + std::to_string(input.location));
+			}
+			binding.attributeDescriptions.push_back({input.location, format, binding.size});
+			binding.size += input.size;
+		}
+		vertexBufferBindings.push_back(binding);
+	}
+
+	vk::PipelineLayout GraphicsPipeline::getPipelineLayout() {
+		return pipelineLayout;
+	}
+
+	uint32_t GraphicsPipeline::getPushConstantSize() {
+		return pushConstantSize;
+	}
+
+	const std::vector<vk::DescriptorSetLayout>& GraphicsPipeline::getDescriptorSetLayouts() {
+		return descriptorSetLayouts;
+	}
+
+	ktw::Shader& GraphicsPipeline::getShader(ktw::ShaderStage stage) {
+		// Latest version of the stage, including a rebuild not swapped in yet
+		if(stage == ktw::ShaderStage::eVertex) {
+			return pendingVertexShader ? *pendingVertexShader : *vertexShader;
+		}
+		return pendingFragmentShader ? *pendingFragmentShader : *fragmentShader;
+	}
+
+	void GraphicsPipeline::reload(const std::set<ktw::ShaderStage>& stages) {
+		// Only the stages that changed are recompiled, the others are reused as is
+		std::unique_ptr<ktw::Shader> vertex;
+		std::unique_ptr<ktw::Shader> fragment;
+		if(stages.count(ktw::ShaderStage::eVertex)) {
+			vertex = std::make_unique<ktw::Shader>(context, vertexShader->getFilename());
+		}
+		if(stages.count(ktw::ShaderStage::eFragment)) {
+			fragment = std::make_unique<ktw::Shader>(context, fragmentShader->getFilename());
+		}
+
+		ktw::Shader& newVertex = vertex ? *vertex : getShader(ktw::ShaderStage::eVertex);
+		ktw::Shader& newFragment = fragment ? *fragment : getShader(ktw::ShaderStage::eFragment);
+
+		// The layouts are shared with other pipelines, a reload cannot change them
+		auto newBindings = mergeDescriptorBindings(newVertex, newFragment);
+		bool sameBindings = std::equal(newBindings.begin(), newBindings.end(), descriptorBindings.begin(), descriptorBindings.end(), [](const ktw::ReflectedDescriptorBinding& a, const ktw::ReflectedDescriptorBinding& b) {
+			return a.set == b.set && a.binding == b.binding && a.type == b.type && a.count == b.count;
+		});
+		uint32_t newPushConstantSize = std::max(newVertex.getReflection().getPushConstantSize(), newFragment.getReflection().getPushConstantSize());
+		if(!sameBindings || newPushConstantSize != pushConstantSize) {
+			throw std::runtime_error("descriptor or push constant interface changed, restart to apply");
+		}
+
+		pendingPipeline = createPipeline(newVertex, newFragment);
+		if(depthMode == ktw::DepthMode::ePrePass) {
+			pendingDepthPipeline = createPipeline(newVertex, newFragment, true);
+		}
+		if(vertex) {
+			pendingVertexShader = std::move(vertex);
+		}
+		if(fragment) {
+			pendingFragmentShader = std::move(fragment);
+		}
+		LOG_TRACE("Graphics Pipeline Rebuilt");
+	}
+
+	bool GraphicsPipeline::swapPendingPipeline() {
+		if(!pendingPipeline) {
+			return false;
+		}
+
+		pipeline = std::move(pendingPipeline);
+		if(pendingDepthPipeline) {
+			depthPipeline = std::move(pendingDepthPipeline);
+		}
+		if(pendingVertexShader) {
+			vertexShader = std::move(pendingVertexShader);
+		}
+		if(pendingFragmentShader) {
+			fragmentShader = std::move(pendingFragmentShader);
+		}
+		return true;
 	}
 
 	vk::Pipeline& GraphicsPipeline::getPipeline() {
 		return *pipeline;
 	}
+
+	vk::Pipeline GraphicsPipeline::getDepthPipeline() {
+		if(!depthPipeline) {
+			throw std::runtime_error("pipeline has no depth pre-pass, create it with DepthMode::ePrePass");
+		}
+		return *depthPipeline;
+	}
+
+	ktw::DepthMode GraphicsPipeline::getDepthMode() {
+		return depthMode;
+	}
 }
\ No newline at end of file
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <string>
+#include <set>
 
 #include "RenderTarget.hpp"
 #include "Shader.hpp"
+#include "LayoutCache.hpp"
+#include "SpecializationConstants.hpp"
 #include "UniformBuffer.hpp"
 #include "Context.hpp"
 
@@ -14,7 +17,18 @@ namespace ktw {
 		eFloat2 = vk::Format::eR32G32Sfloat,
 		eFloat = vk::Format::eR32Sfloat,
 		eInt = vk::Format::eR32Sint,
-		eUInt = vk::Format::eR32Uint
+		eUInt = vk::Format::eR32Uint,
+		// Compact formats, read as floats by the shader (see Quantization.hpp for packing)
+		eHalf4 = vk::Format::eR16G16B16A16Sfloat,
+		eHalf2 = vk::Format::eR16G16Sfloat,
+		eUShort4Norm = vk::Format::eR16G16B16A16Unorm,
+		eShort4Norm = vk::Format::eR16G16B16A16Snorm,
+		eUShort2Norm = vk::Format::eR16G16Unorm,
+		eShort2Norm = vk::Format::eR16G16Snorm,
+		eUByte4Norm = vk::Format::eR8G8B8A8Unorm,
+		eByte4Norm = vk::Format::eR8G8B8A8Snorm,
+		eUInt1010102Norm = vk::Format::eA2B10G10R10UnormPack32,
+		eInt1010102Norm = vk::Format::eA2B10G10R10SnormPack32
 	};
 
 	struct AttributeDescription {
@@ -37,19 +51,67 @@ namespace ktw {
 	struct UniformDescriptor {
 		uint32_t binding;
 		ktw::ShaderStage stage;
+		vk::DescriptorType type = vk::DescriptorType::eUniformBuffer;
 		//ktw::UniformBuffer& buffer;
 	};
 
+	// How a pipeline uses the render target's depth buffer
+	enum class DepthMode {
+		// Neither tested nor written, for overlays and fullscreen passes
+		eDisabled,
+		// Nearest fragment wins, for opaque geometry
+		eReadWrite,
+		// Tested but not written, for transparent geometry drawn after the opaque one
+		eReadOnly,
+		// Opaque geometry drawn twice: depth only first, then shaded where it
+		// matches the nearest depth, so each pixel runs the fragment shader once
+		ePrePass
+	};
+
+	class ShaderWatcher;
+
 	class GraphicsPipeline {
 	public:
-		GraphicsPipeline(ktw::Context& context, ktw::RenderTarget& renderTarget, const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const std::vector<ktw::VertexBufferBinding>& vertexBufferBindings, const std::vector<ktw::UniformDescriptor>& uniformDescriptors);
+		GraphicsPipeline(ktw::Context& context, ktw::LayoutCache& layoutCache, ktw::RenderTarget& renderTarget, const ktw::ShaderSource& vertexShaderSource, const ktw::ShaderSource& fragmentShaderSource, const std::vector<ktw::VertexBufferBinding>& vertexBufferBindings, const std::vector<ktw::UniformDescriptor>& uniformDescriptors, const ktw::SpecializationConstants& specializationConstants = ktw::SpecializationConstants(), ktw::DepthMode depthMode = ktw::DepthMode::eReadWrite, ktw::ShaderWatcher* shaderWatcher = nullptr);
+		~GraphicsPipeline();
 		vk::Pipeline& getPipeline();
+		// Vertex stage only and no color writes, the pre-pass of ePrePass pipelines
+		vk::Pipeline getDepthPipeline();
+		ktw::DepthMode getDepthMode();
+		vk::PipelineLayout getPipelineLayout();
+		uint32_t getPushConstantSize();
+		const std::vector<vk::DescriptorSetLayout>& getDescriptorSetLayouts();
+		ktw::Shader& getShader(ktw::ShaderStage stage);
+		void reload(const std::set<ktw::ShaderStage>& stages);
+		bool swapPendingPipeline();
 
 	private:
-		vk::UniqueDescriptorSetLayout descriptorSetLayout;
-		vk::UniquePipelineLayout pipelineLayout;
+		ktw::Context& context;
+		ktw::RenderTarget& renderTarget;
+		ktw::ShaderWatcher* shaderWatcher;
+		std::vector<ktw::VertexBufferBinding> vertexBufferBindings;
+		ktw::SpecializationConstants specializationConstants;
+		ktw::DepthMode depthMode;
+		std::unique_ptr<ktw::Shader> vertexShader;
+		std::unique_ptr<ktw::Shader> fragmentShader;
+		std::vector<ktw::ReflectedDescriptorBinding> descriptorBindings;
+		uint32_t pushConstantSize;
+		// Owned by the LayoutCache, shared with compatible pipelines
+		std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
+		vk::PipelineLayout pipelineLayout;
 		vk::UniquePipeline pipeline;
+		vk::UniquePipeline depthPipeline;
+		// Built by reload() off the render thread, swapped in at a frame boundary
+		std::unique_ptr<ktw::Shader> pendingVertexShader;
+		std::unique_ptr<ktw::Shader> pendingFragmentShader;
+		vk::UniquePipeline pendingPipeline;
+		vk::UniquePipeline pendingDepthPipeline;
 		//std::vector<ktw::UniformBuffer*> uniformBuffers;
 		//std::vector<vk::DescriptorSet> descriptorSets;
+
+		vk::UniquePipeline createPipeline(ktw::Shader& vertex, ktw::Shader& fragment, bool depthOnly = false);
+		std::vector<ktw::ReflectedDescriptorBinding> mergeDescriptorBindings(ktw::Shader& vertex, ktw::Shader& fragment);
+		void createLayouts(ktw::LayoutCache& layoutCache, const std::vector<ktw::UniformDescriptor>& uniformDescriptors);
+		void createVertexBufferBindings();
 	};
 }
@@ -0,0 +1,203 @@
+#include "pch.hpp"
+#include "JobSystem.hpp"
+
+namespace ktw {
+	namespace {
+		// Lets a job push to, and wait from, the queue of the worker running it
+		thread_local ktw::JobSystem* currentJobSystem = nullptr;
+		thread_local uint32_t currentQueueIndex = 0;
+	}
+
+	bool JobCounter::isDone() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return pending == 0;
+	}
+
+	JobSystem::JobSystem(uint32_t workerCount) : running(true), queuedTasks(0) {
+		workerCount = std::max(workerCount, 1u);
+		for(uint32_t i = 0; i <= workerCount; i++) {
+			queues.push_back(std::make_unique<Queue>());
+		}
+		for(uint32_t i = 1; i <= workerCount; i++) {
+			workers.emplace_back(&JobSystem::workerLoop, this, i);
+		}
+
+		LOG_TRACE("Job System Created ({} workers)", workerCount);
+	}
+
+	JobSystem::~JobSystem() {
+		// Workers drain the queues before leaving
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			running = false;
+		}
+		wakeUp.notify_all();
+		for(auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	void JobSystem::run(std::function<void()> job, ktw::JobCounter* counter) {
+		if(counter) {
+			std::lock_guard<std::mutex> lock(counter->mutex);
+			counter->pending++;
+		}
+		push({std::move(job), counter});
+	}
+
+	void JobSystem::runAfter(ktw::JobCounter& dependency, std::function<void()> job, ktw::JobCounter* counter) {
+		if(counter) {
+			std::lock_guard<std::mutex> lock(counter->mutex);
+			counter->pending++;
+		}
+		{
+			std::lock_guard<std::mutex> lock(dependency.mutex);
+			if(dependency.pending > 0) {
+				dependency.continuations.push_back({std::move(job), counter});
+				return;
+			}
+		}
+		push({std::move(job), counter});
+	}
+
+	void JobSystem::wait(ktw::JobCounter& counter) {
+		uint32_t queueIndex = getCurrentQueue();
+		while(!counter.isDone()) {
+			Task task;
+			if(pop(queueIndex, task)) {
+				execute(task);
+			}
+			else {
+				// What is left runs on other threads
+				std::this_thread::yield();
+			}
+		}
+
+		std::exception_ptr exception;
+		{
+			std::lock_guard<std::mutex> lock(counter.mutex);
+			std::swap(exception, counter.exception);
+		}
+		if(exception) {
+			std::rethrow_exception(exception);
+		}
+	}
+
+	uint32_t JobSystem::getWorkerCount() {
+		return static_cast<uint32_t>(workers.size());
+	}
+
+	uint32_t JobSystem::defaultWorkerCount() {
+		uint32_t cores = std::thread::hardware_concurrency();
+		return cores > 1 ? cores - 1 : 1;
+	}
+
+	void JobSystem::push(Task task) {
+		// Counted first, so a thief never decrements below zero
+		queuedTasks++;
+		auto& queue = *queues[getCurrentQueue()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back(std::move(task));
+		}
+		// Taking the lock orders this with a worker checking queuedTasks before it sleeps
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		wakeUp.notify_one();
+	}
+
+	bool JobSystem::pop(uint32_t queueIndex, Task& task) {
+		{
+			auto& queue = *queues[queueIndex];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if(!queue.tasks.empty()) {
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+				queuedTasks--;
+				return true;
+			}
+		}
+
+		for(size_t offset = 1; offset < queues.size(); offset++) {
+			auto& victim = *queues[(queueIndex + offset) % queues.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if(!victim.tasks.empty()) {
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				queuedTasks--;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void JobSystem::execute(Task& task) {
+		try {
+			task.job();
+		}
+		catch(...) {
+			if(task.counter) {
+				std::lock_guard<std::mutex> lock(task.counter->mutex);
+				if(!task.counter->exception) {
+					task.counter->exception = std::current_exception();
+				}
+			}
+			else {
+				try {
+					throw;
+				}
+				catch(const std::exception& e) {
+					LOG_ERROR("Job failed: {}", e.what());
+				}
+				catch(...) {
+					LOG_ERROR("Job failed");
+				}
+			}
+		}
+		finish(task.counter);
+	}
+
+	void JobSystem::finish(ktw::JobCounter* counter) {
+		if(!counter) {
+			return;
+		}
+
+		// The waiter may destroy the counter as soon as it is released, it is not touched afterwards
+		std::vector<ktw::JobCounter::Continuation> continuations;
+		{
+			std::lock_guard<std::mutex> lock(counter->mutex);
+			if(--counter->pending == 0) {
+				std::swap(continuations, counter->continuations);
+			}
+		}
+		for(auto& continuation : continuations) {
+			push({std::move(continuation.job), continuation.counter});
+		}
+	}
+
+	void JobSystem::workerLoop(uint32_t queueIndex) {
+		currentJobSystem = this;
+		currentQueueIndex = queueIndex;
+
+		while(true) {
+			Task task;
+			if(pop(queueIndex, task)) {
+				execute(task);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			if(!running && queuedTasks == 0) {
+				break;
+			}
+			wakeUp.wait(lock, [this]() {
+				return queuedTasks > 0 || !running;
+			});
+		}
+	}
+
+	uint32_t JobSystem::getCurrentQueue() {
+		return currentJobSystem == this ? currentQueueIndex : 0;
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ktw {
+	class JobSystem;
+
+	// Jobs left in a group. Waiting on it runs other jobs meanwhile, and jobs
+	// can be chained to start once it reaches zero. It can be reused once done.
+	class JobCounter {
+	public:
+		JobCounter() = default;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+		bool isDone();
+
+	private:
+		friend class JobSystem;
+
+		struct Continuation {
+			std::function<void()> job;
+			ktw::JobCounter* counter;
+		};
+
+		std::mutex mutex;
+		uint32_t pending = 0;
+		std::vector<Continuation> continuations;
+		// First exception thrown by a counted job, rethrown by JobSystem::wait
+		std::exception_ptr exception;
+	};
+
+	// Work stealing scheduler shared by the engine and the application. Each
+	// worker pushes and pops its own jobs at the back of its queue (most recent
+	// first, still hot in cache) and steals the oldest jobs of the others when
+	// it runs out. Threads that are not workers share one more queue.
+	class JobSystem {
+	public:
+		explicit JobSystem(uint32_t workerCount = defaultWorkerCount());
+		~JobSystem();
+		void run(std::function<void()> job, ktw::JobCounter* counter = nullptr);
+		// Starts job once every job counted by dependency has finished
+		void runAfter(ktw::JobCounter& dependency, std::function<void()> job, ktw::JobCounter* counter = nullptr);
+		// Runs queued jobs until the counter reaches zero, so jobs may wait too
+		void wait(ktw::JobCounter& counter);
+		// function(begin, end) over batches of at most batchSize indices, returns when all are done
+		template<typename F>
+		void parallelFor(uint32_t count, uint32_t batchSize, F&& function) {
+			batchSize = std::max(batchSize, 1u);
+			if(count <= batchSize) {
+				if(count > 0) {
+					function(0u, count);
+				}
+				return;
+			}
+
+			ktw::JobCounter counter;
+			for(uint32_t begin = batchSize; begin < count; begin += batchSize) {
+				uint32_t end = std::min(count, begin + batchSize);
+				run([&function, begin, end]() {
+					function(begin, end);
+				}, &counter);
+			}
+			// The first batch runs here instead of waiting idle. The other batches
+			// reference function and counter, they have to finish even if it throws.
+			std::exception_ptr exception;
+			try {
+				function(0u, batchSize);
+			}
+			catch(...) {
+				exception = std::current_exception();
+			}
+			wait(counter);
+			if(exception) {
+				std::rethrow_exception(exception);
+			}
+		}
+		uint32_t getWorkerCount();
+		// One worker per core, the thread driving the frame being the last one
+		static uint32_t defaultWorkerCount();
+
+	private:
+		struct Task {
+			std::function<void()> job;
+			ktw::JobCounter* counter;
+		};
+
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		// Queue 0 is for threads that are not workers
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> workers;
+		std::atomic<bool> running;
+		std::atomic<uint32_t> queuedTasks;
+		std::mutex sleepMutex;
+		std::condition_variable wakeUp;
+
+		void push(Task task);
+		bool pop(uint32_t queueIndex, Task& task);
+		void execute(Task& task);
+		void finish(ktw::JobCounter* counter);
+		void workerLoop(uint32_t queueIndex);
+		uint32_t getCurrentQueue();
+	};
+}
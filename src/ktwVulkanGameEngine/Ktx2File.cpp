@@ -0,0 +1,84 @@
+#include "pch.hpp"
+#include "Ktx2File.hpp"
+
+#include <cstring>
+
+namespace ktw {
+	namespace {
+		const uint8_t ktx2Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+		const size_t headerSize = 80;
+		const size_t levelIndexEntrySize = 24;
+
+		// The file is only byte aligned as far as we know, read fields through memcpy
+		template<typename T>
+		T read(const uint8_t* data, size_t offset) {
+			T value;
+			memcpy(&value, data + offset, sizeof(T));
+			return value;
+		}
+	}
+
+	Ktx2File::Ktx2File(const std::string& filename) : file(filename) {
+		const uint8_t* data = file.getData();
+		size_t size = file.getSize();
+
+		if(size < headerSize || memcmp(data, ktx2Identifier, sizeof(ktx2Identifier)) != 0) {
+			throw std::runtime_error(filename + " is not a KTX2 file");
+		}
+
+		format = static_cast<vk::Format>(read<uint32_t>(data, 12));
+		width = read<uint32_t>(data, 20);
+		height = read<uint32_t>(data, 24);
+		uint32_t depth = read<uint32_t>(data, 28);
+		uint32_t layerCount = read<uint32_t>(data, 32);
+		uint32_t faceCount = read<uint32_t>(data, 36);
+		uint32_t levelCount = std::max(read<uint32_t>(data, 40), 1u);
+		uint32_t supercompressionScheme = read<uint32_t>(data, 44);
+
+		if(format == vk::Format::eUndefined) {
+			throw std::runtime_error(filename + ": Basis Universal textures need transcoding, transcode them offline to BC, ETC2 or ASTC");
+		}
+		if(supercompressionScheme != 0) {
+			throw std::runtime_error(filename + ": supercompressed KTX2 files are not supported");
+		}
+		if(width == 0 || height == 0 || depth > 1 || layerCount > 1 || faceCount != 1) {
+			throw std::runtime_error(filename + ": only single 2D textures are supported");
+		}
+		if(size < headerSize + levelCount * levelIndexEntrySize) {
+			throw std::runtime_error(filename + ": truncated level index");
+		}
+
+		// The index is ordered from the base level down, while the data is stored smallest first
+		for(uint32_t level = 0; level < levelCount; level++) {
+			size_t entry = headerSize + level * levelIndexEntrySize;
+			uint64_t byteOffset = read<uint64_t>(data, entry);
+			uint64_t byteLength = read<uint64_t>(data, entry + 8);
+			if(byteLength == 0 || byteOffset > size || byteLength > size - byteOffset) {
+				throw std::runtime_error(filename + ": level " + std::to_string(level) + " is out of the file");
+			}
+			levels.push_back({data + byteOffset, static_cast<size_t>(byteLength)});
+		}
+
+		LOG_TRACE("KTX2 File Mapped: {} ({}x{}, {}, {} levels)", filename, width, height, vk::to_string(format), levelCount);
+	}
+
+	const std::string& Ktx2File::getFilename() {
+		return file.getFilename();
+	}
+
+	vk::Format Ktx2File::getFormat() {
+		return format;
+	}
+
+	uint32_t Ktx2File::getWidth() {
+		return width;
+	}
+
+	uint32_t Ktx2File::getHeight() {
+		return height;
+	}
+
+	const std::vector<ktw::TextureLevel>& Ktx2File::getLevels() {
+		return levels;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include "MappedFile.hpp"
+#include "Texture.hpp"
+
+namespace ktw {
+	// KTX2 container read in place from a memory mapping. Only 2D textures
+	// stored in a GPU format without supercompression are accepted, so the
+	// levels go to the staging buffer as they are, with no decoding.
+	class Ktx2File {
+	public:
+		Ktx2File(const std::string& filename);
+
+		const std::string& getFilename();
+		vk::Format getFormat();
+		uint32_t getWidth();
+		uint32_t getHeight();
+		// Largest first, pointing into the mapping, valid as long as this object
+		const std::vector<ktw::TextureLevel>& getLevels();
+
+	private:
+		ktw::MappedFile file;
+		vk::Format format;
+		uint32_t width;
+		uint32_t height;
+		std::vector<ktw::TextureLevel> levels;
+	};
+}
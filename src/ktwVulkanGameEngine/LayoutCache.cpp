@@ -0,0 +1,76 @@
+#include "pch.hpp"
+#include "LayoutCache.hpp"
+
+namespace ktw {
+	// Every device supports at least 128 bytes of push constants
+	const uint32_t minPushConstantSize = 128;
+
+	LayoutCache::LayoutCache(ktw::Context& context) : context(context) {}
+
+	vk::DescriptorSetLayout LayoutCache::getDescriptorSetLayout(std::vector<vk::DescriptorSetLayoutBinding> bindings, vk::ShaderStageFlags stages) {
+		std::sort(bindings.begin(), bindings.end(), [](const vk::DescriptorSetLayoutBinding& a, const vk::DescriptorSetLayoutBinding& b) {
+			return a.binding < b.binding;
+		});
+
+		std::pair<std::vector<std::array<uint32_t, 3>>, VkShaderStageFlags> key;
+		key.first.reserve(bindings.size());
+		key.second = static_cast<VkShaderStageFlags>(stages);
+		for(auto& binding : bindings) {
+			binding.setStageFlags(stages);
+			key.first.push_back({binding.binding, static_cast<uint32_t>(binding.descriptorType), binding.descriptorCount});
+		}
+
+		auto it = descriptorSetLayouts.find(key);
+		if(it != descriptorSetLayouts.end()) {
+			return *(it->second);
+		}
+
+		auto layoutInfo = vk::DescriptorSetLayoutCreateInfo()
+			.setBindingCount(static_cast<uint32_t>(bindings.size()))
+			.setPBindings(bindings.data());
+
+		vk::DescriptorSetLayout layout = *(descriptorSetLayouts[key] = context.getDevice().createDescriptorSetLayoutUnique(layoutInfo));
+		LOG_TRACE("Descriptor Set Layout Created");
+		return layout;
+	}
+
+	vk::PipelineLayout LayoutCache::getPipelineLayout(const std::vector<vk::DescriptorSetLayout>& setLayouts, uint32_t pushConstantSize, vk::ShaderStageFlags stages) {
+		pushConstantSize = std::max(minPushConstantSize, (pushConstantSize + 3) & ~3u);
+
+		std::vector<VkDescriptorSetLayout> handles(setLayouts.begin(), setLayouts.end());
+		auto key = std::make_tuple(handles, pushConstantSize, static_cast<VkShaderStageFlags>(stages));
+
+		auto it = pipelineLayouts.find(key);
+		if(it != pipelineLayouts.end()) {
+			return *(it->second);
+		}
+
+		auto pushConstantRange = vk::PushConstantRange()
+			.setStageFlags(stages)
+			.setOffset(0)
+			.setSize(pushConstantSize);
+
+		auto pipelineLayoutInfo = vk::PipelineLayoutCreateInfo()
+			.setSetLayoutCount(static_cast<uint32_t>(setLayouts.size()))
+			.setPSetLayouts(setLayouts.data())
+			.setPushConstantRangeCount(1)
+			.setPPushConstantRanges(&pushConstantRange);
+
+		vk::PipelineLayout layout = *(pipelineLayouts[key] = context.getDevice().createPipelineLayoutUnique(pipelineLayoutInfo));
+		LOG_TRACE("Pipeline Layout Created");
+		return layout;
+	}
+
+	void LayoutCache::setBindlessLayout(vk::DescriptorSetLayout layout, const std::vector<vk::DescriptorSetLayoutBinding>& bindings) {
+		bindlessLayout = layout;
+		bindlessBindings = bindings;
+	}
+
+	vk::DescriptorSetLayout LayoutCache::getBindlessLayout() {
+		return bindlessLayout;
+	}
+
+	const std::vector<vk::DescriptorSetLayoutBinding>& LayoutCache::getBindlessBindings() {
+		return bindlessBindings;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Context.hpp"
+
+#include <array>
+#include <map>
+#include <tuple>
+
+namespace ktw {
+	// Owns descriptor set layouts and pipeline layouts, deduplicated by content.
+	// Bindings are canonicalized (sorted, visible to all graphics stages) and every
+	// pipeline layout declares the same push constant range, so pipelines using the
+	// same resources get identical layouts and descriptor sets stay bound across
+	// pipeline switches. Compute pipelines get their own layouts, visible to
+	// the compute stage only.
+	class LayoutCache {
+	public:
+		LayoutCache(ktw::Context& context);
+		vk::DescriptorSetLayout getDescriptorSetLayout(std::vector<vk::DescriptorSetLayoutBinding> bindings, vk::ShaderStageFlags stages = vk::ShaderStageFlagBits::eAllGraphics);
+		vk::PipelineLayout getPipelineLayout(const std::vector<vk::DescriptorSetLayout>& setLayouts, uint32_t pushConstantSize, vk::ShaderStageFlags stages = vk::ShaderStageFlagBits::eAllGraphics);
+		// In bindless mode set 0 of every pipeline is the BindlessHeap layout
+		void setBindlessLayout(vk::DescriptorSetLayout layout, const std::vector<vk::DescriptorSetLayoutBinding>& bindings);
+		vk::DescriptorSetLayout getBindlessLayout();
+		const std::vector<vk::DescriptorSetLayoutBinding>& getBindlessBindings();
+
+	private:
+		ktw::Context& context;
+		std::map<std::pair<std::vector<std::array<uint32_t, 3>>, VkShaderStageFlags>, vk::UniqueDescriptorSetLayout> descriptorSetLayouts;
+		std::map<std::tuple<std::vector<VkDescriptorSetLayout>, uint32_t, VkShaderStageFlags>, vk::UniquePipelineLayout> pipelineLayouts;
+		vk::DescriptorSetLayout bindlessLayout;
+		std::vector<vk::DescriptorSetLayoutBinding> bindlessBindings;
+	};
+}
@@ -0,0 +1,37 @@
+#include "pch.hpp"
+#include "LodSelector.hpp"
+
+namespace ktw {
+	namespace {
+		// Keeps the error finite when the camera is inside the bounds
+		const float minDistance = 1e-3f;
+	}
+
+	LodSelector::LodSelector(float pixelThreshold) : pixelThreshold(pixelThreshold) {}
+
+	void LodSelector::setView(const glm::mat4& projection, uint32_t viewportHeight, const glm::vec3& cameraPosition) {
+		// projection[1][1] is 1 / tan(fovY / 2) for perspective, 2 / height for orthographic (negated with a Y flip)
+		pixelsPerUnit = std::abs(projection[1][1]) * viewportHeight * 0.5f;
+		orthographic = projection[2][3] == 0.0f;
+		this->cameraPosition = cameraPosition;
+	}
+
+	void LodSelector::setPixelThreshold(float pixelThreshold) {
+		this->pixelThreshold = pixelThreshold;
+	}
+
+	uint32_t LodSelector::select(const std::vector<ktw::MeshLod>& lods, const glm::vec3& center, float radius, float scale) const {
+		float distance = orthographic ? 1.0f : std::max(glm::length(center - cameraPosition) - radius, minDistance);
+		float pixelsPerError = pixelsPerUnit * scale / distance;
+
+		// Errors grow along the chain, so the first level over the threshold ends the search
+		uint32_t level = 0;
+		for(uint32_t i = 1; i < lods.size(); i++) {
+			if(lods[i].error * pixelsPerError > pixelThreshold) {
+				break;
+			}
+			level = i;
+		}
+		return level;
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+
+namespace ktw {
+	// Picks levels of detail from their projected screen error: the coarsest
+	// level whose error, seen at the closest point of the object's bounding
+	// sphere, covers at most pixelThreshold pixels.
+	class LodSelector {
+	public:
+		LodSelector(float pixelThreshold = 1.0f);
+		// Once per frame, before selecting
+		void setView(const glm::mat4& projection, uint32_t viewportHeight, const glm::vec3& cameraPosition);
+		void setPixelThreshold(float pixelThreshold);
+		// Bounds in world space, scale is the largest scale of the object's transform
+		uint32_t select(const std::vector<ktw::MeshLod>& lods, const glm::vec3& center, float radius, float scale = 1.0f) const;
+
+	private:
+		float pixelThreshold;
+		// Pixels covered by one world unit at distance 1 (at any distance when orthographic)
+		float pixelsPerUnit = 1.0f;
+		bool orthographic = false;
+		glm::vec3 cameraPosition = glm::vec3(0.0f);
+	};
+}
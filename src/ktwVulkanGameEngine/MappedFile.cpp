@@ -0,0 +1,98 @@
+#include "pch.hpp"
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace ktw {
+	MappedFile::MappedFile(const std::string& filename) : filename(filename) {
+#ifdef _WIN32
+		fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if(fileHandle == INVALID_HANDLE_VALUE) {
+			fileHandle = nullptr;
+			throw std::runtime_error("failed to open file: " + filename);
+		}
+
+		LARGE_INTEGER fileSize;
+		GetFileSizeEx(fileHandle, &fileSize);
+		size = static_cast<size_t>(fileSize.QuadPart);
+		if(size == 0) {
+			return;
+		}
+
+		mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(!mappingHandle) {
+			CloseHandle(fileHandle);
+			throw std::runtime_error("failed to map file: " + filename);
+		}
+		data = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if(!data) {
+			CloseHandle(mappingHandle);
+			CloseHandle(fileHandle);
+			throw std::runtime_error("failed to map file: " + filename);
+		}
+#else
+		int fd = open(filename.c_str(), O_RDONLY);
+		if(fd < 0) {
+			throw std::runtime_error("failed to open file: " + filename);
+		}
+
+		struct stat status;
+		if(fstat(fd, &status) != 0) {
+			close(fd);
+			throw std::runtime_error("failed to stat file: " + filename);
+		}
+		size = static_cast<size_t>(status.st_size);
+		if(size == 0) {
+			close(fd);
+			return;
+		}
+
+		// The mapping keeps its own reference to the file
+		void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if(mapping == MAP_FAILED) {
+			throw std::runtime_error("failed to map file: " + filename);
+		}
+		data = static_cast<const uint8_t*>(mapping);
+#endif
+	}
+
+	MappedFile::~MappedFile() {
+#ifdef _WIN32
+		if(data) {
+			UnmapViewOfFile(data);
+		}
+		if(mappingHandle) {
+			CloseHandle(mappingHandle);
+		}
+		if(fileHandle) {
+			CloseHandle(fileHandle);
+		}
+#else
+		if(data) {
+			munmap(const_cast<uint8_t*>(data), size);
+		}
+#endif
+	}
+
+	const uint8_t* MappedFile::getData() const {
+		return data;
+	}
+
+	size_t MappedFile::getSize() const {
+		return size;
+	}
+
+	const std::string& MappedFile::getFilename() const {
+		return filename;
+	}
+}
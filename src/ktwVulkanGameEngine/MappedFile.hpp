@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ktw {
+	// Read-only view of a whole file through the OS page cache, nothing is
+	// copied until the bytes are actually touched.
+	class MappedFile {
+	public:
+		MappedFile(const std::string& filename);
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const uint8_t* getData() const;
+		size_t getSize() const;
+		const std::string& getFilename() const;
+
+	private:
+		std::string filename;
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#endif
+	};
+}
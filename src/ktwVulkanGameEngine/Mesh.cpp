@@ -0,0 +1,201 @@
+#include "pch.hpp"
+#include "Mesh.hpp"
+#include "MappedFile.hpp"
+
+#include <cstring>
+#include <limits>
+
+namespace ktw {
+	Mesh::Mesh(ktw::Context& context, const std::string& filename, ktw::GeometryArena* arena) : arena(arena) {
+		ktw::MappedFile file(filename);
+		const uint8_t* data = file.getData();
+		size_t size = file.getSize();
+
+		ktw::MeshFileHeader header;
+		if(size < sizeof(header)) {
+			throw std::runtime_error(filename + " is not a mesh file");
+		}
+		memcpy(&header, data, sizeof(header));
+		if(memcmp(header.magic, ktw::meshFileMagic, sizeof(header.magic)) != 0) {
+			throw std::runtime_error(filename + " is not a mesh file");
+		}
+		if(header.version != ktw::meshFileVersion) {
+			throw std::runtime_error(filename + ": mesh file version " + std::to_string(header.version) + " is not supported, convert it again");
+		}
+		if(header.indexSize != sizeof(uint16_t) && header.indexSize != sizeof(uint32_t)) {
+			throw std::runtime_error(filename + ": invalid index size " + std::to_string(header.indexSize));
+		}
+
+		uint64_t attributesOffset = sizeof(header);
+		uint64_t submeshesOffset = attributesOffset + header.attributeCount * sizeof(ktw::MeshFileAttribute);
+		uint64_t vertexDataSize = static_cast<uint64_t>(header.vertexCount) * header.vertexStride;
+		uint64_t indexDataSize = static_cast<uint64_t>(header.indexCount) * header.indexSize;
+		uint64_t meshletDataSize = static_cast<uint64_t>(header.meshletCount) * sizeof(ktw::MeshFileMeshlet);
+		uint64_t lodDataSize = static_cast<uint64_t>(header.lodCount) * sizeof(ktw::MeshFileLod);
+		uint64_t submeshDataSize = static_cast<uint64_t>(header.submeshCount) * sizeof(ktw::MeshFileSubmesh);
+		// Offsets come from the file, written so that a huge one cannot wrap the sum
+		auto outside = [size](uint64_t offset, uint64_t length) {
+			return offset > size || size - offset < length;
+		};
+		if(outside(submeshesOffset, submeshDataSize) || outside(header.vertexDataOffset, vertexDataSize) || outside(header.indexDataOffset, indexDataSize) || outside(header.meshletDataOffset, meshletDataSize) || outside(header.lodDataOffset, lodDataSize)) {
+			throw std::runtime_error(filename + ": truncated mesh file");
+		}
+
+		vertexBufferBinding = {0, header.vertexStride, {}};
+		for(uint32_t i = 0; i < header.attributeCount; i++) {
+			ktw::MeshFileAttribute attribute;
+			memcpy(&attribute, data + attributesOffset + i * sizeof(attribute), sizeof(attribute));
+			vertexBufferBinding.attributeDescriptions.push_back({attribute.location, static_cast<ktw::Format>(attribute.format), attribute.offset});
+		}
+
+		for(uint32_t i = 0; i < header.submeshCount; i++) {
+			ktw::MeshFileSubmesh submesh;
+			memcpy(&submesh, data + submeshesOffset + i * sizeof(submesh), sizeof(submesh));
+			if(static_cast<uint64_t>(submesh.firstIndex) + submesh.indexCount > header.indexCount) {
+				throw std::runtime_error(filename + ": invalid submesh " + std::to_string(i));
+			}
+			submeshes.push_back({submesh.firstIndex, submesh.indexCount, submesh.vertexOffset, submesh.materialIndex, {{submesh.firstIndex, submesh.indexCount, 0.0f}}});
+		}
+
+		for(uint32_t i = 0; i < header.lodCount; i++) {
+			ktw::MeshFileLod lod;
+			memcpy(&lod, data + header.lodDataOffset + i * sizeof(lod), sizeof(lod));
+			if(lod.submeshIndex >= submeshes.size() || static_cast<uint64_t>(lod.firstIndex) + lod.indexCount > header.indexCount) {
+				throw std::runtime_error(filename + ": invalid level of detail " + std::to_string(i));
+			}
+			submeshes[lod.submeshIndex].lods.push_back({lod.firstIndex, lod.indexCount, lod.error});
+		}
+
+		// Blobs are copied from the mapping straight into the mapped buffers, the index width is the file's
+		if(arena) {
+			allocateInArena(data + header.vertexDataOffset, header.vertexCount, data + header.indexDataOffset, header.indexCount, header.indexSize);
+		}
+		else {
+			vertexBuffer = std::make_unique<ktw::Buffer>(context, header.vertexStride, header.vertexCount, ktw::BufferUsage::eVertexBuffer, const_cast<uint8_t*>(data + header.vertexDataOffset));
+			indexBuffer = std::make_unique<ktw::Buffer>(context, header.indexSize, header.indexCount, ktw::BufferUsage::eIndexBuffer, const_cast<uint8_t*>(data + header.indexDataOffset));
+		}
+
+		// Meshlets have the layout the culling shader reads, the draw commands are filled by it
+		meshletCount = header.meshletCount;
+		if(meshletCount > 0) {
+			std::vector<ktw::MeshFileMeshlet> meshlets(meshletCount);
+			memcpy(meshlets.data(), data + header.meshletDataOffset, meshletCount * sizeof(ktw::MeshFileMeshlet));
+			for(auto& meshlet : meshlets) {
+				meshlet.firstIndex += allocation.firstIndex;
+				meshlet.vertexOffset += static_cast<int32_t>(allocation.firstVertex);
+			}
+			meshletBuffer = std::make_unique<ktw::Buffer>(context, static_cast<uint32_t>(sizeof(ktw::MeshFileMeshlet)), meshletCount, ktw::BufferUsage::eStorageBuffer, meshlets.data());
+			drawCommandBuffer = std::make_unique<ktw::Buffer>(context, static_cast<uint32_t>(sizeof(vk::DrawIndexedIndirectCommand)), meshletCount, static_cast<ktw::BufferUsage>(ktw::BufferUsage::eStorageBuffer | ktw::BufferUsage::eIndirectBuffer), nullptr);
+		}
+
+		boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+		boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+		LOG_TRACE("Mesh Loaded: {} ({} vertices, {} indices, {} submeshes, {} meshlets, {} levels of detail)", filename, header.vertexCount, header.indexCount, submeshes.size(), meshletCount, header.lodCount);
+	}
+
+	Mesh::Mesh(ktw::Context& context, const ktw::VertexBufferBinding& vertexBufferBinding, const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const std::vector<ktw::Submesh>& submeshes, ktw::GeometryArena* arena) :
+		vertexBufferBinding(vertexBufferBinding),
+		arena(arena),
+		submeshes(submeshes),
+		boundsMin(0.0f),
+		boundsMax(0.0f)
+	{
+		if(this->submeshes.empty()) {
+			this->submeshes.push_back({0, indexCount, 0, 0});
+		}
+		for(auto& submesh : this->submeshes) {
+			if(submesh.lods.empty()) {
+				submesh.lods.push_back({submesh.firstIndex, submesh.indexCount, 0.0f});
+			}
+		}
+
+		if(arena) {
+			allocateInArena(vertices, vertexCount, indices, indexCount, sizeof(uint32_t));
+		}
+		else {
+			vertexBuffer = std::make_unique<ktw::Buffer>(context, vertexBufferBinding.size, vertexCount, ktw::BufferUsage::eVertexBuffer, const_cast<void*>(vertices));
+			indexBuffer = std::make_unique<ktw::Buffer>(context, indices, indexCount);
+		}
+
+		// Bounds come from the position, by convention the float attribute at location 0
+		auto position = std::find_if(vertexBufferBinding.attributeDescriptions.begin(), vertexBufferBinding.attributeDescriptions.end(), [](const ktw::AttributeDescription& attribute) {
+			return attribute.location == 0;
+		});
+		if(position != vertexBufferBinding.attributeDescriptions.end() && vertexCount > 0) {
+			uint32_t components = position->format == ktw::Format::eFloat2 ? 2 : position->format == ktw::Format::eFloat3 || position->format == ktw::Format::eFloat4 ? 3 : 0;
+			if(components > 0) {
+				boundsMin = glm::vec3(std::numeric_limits<float>::max());
+				boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+				if(components == 2) {
+					boundsMin.z = boundsMax.z = 0.0f;
+				}
+				const uint8_t* vertex = static_cast<const uint8_t*>(vertices) + position->offset;
+				for(uint32_t i = 0; i < vertexCount; i++, vertex += vertexBufferBinding.size) {
+					float value[3];
+					memcpy(value, vertex, components * sizeof(float));
+					for(uint32_t c = 0; c < components; c++) {
+						boundsMin[c] = std::min(boundsMin[c], value[c]);
+						boundsMax[c] = std::max(boundsMax[c], value[c]);
+					}
+				}
+			}
+		}
+	}
+
+	Mesh::~Mesh() {
+		if(arena) {
+			arena->free(allocation);
+		}
+	}
+
+	void Mesh::allocateInArena(const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, uint32_t indexSize) {
+		allocation = arena->allocate(vertexBufferBinding, vertexCount, indexCount);
+		arena->write(allocation, vertices, indices, indexSize);
+
+		// Indices stay local, only the ranges move
+		for(auto& submesh : submeshes) {
+			submesh.firstIndex += allocation.firstIndex;
+			submesh.vertexOffset += static_cast<int32_t>(allocation.firstVertex);
+			for(auto& lod : submesh.lods) {
+				lod.firstIndex += allocation.firstIndex;
+			}
+		}
+	}
+
+	ktw::Buffer* Mesh::getVertexBuffer() {
+		return arena ? allocation.vertexBuffer : vertexBuffer.get();
+	}
+
+	ktw::Buffer* Mesh::getIndexBuffer() {
+		return arena ? allocation.indexBuffer : indexBuffer.get();
+	}
+
+	const ktw::VertexBufferBinding& Mesh::getVertexBufferBinding() {
+		return vertexBufferBinding;
+	}
+
+	const std::vector<ktw::Submesh>& Mesh::getSubmeshes() {
+		return submeshes;
+	}
+
+	const glm::vec3& Mesh::getBoundsMin() {
+		return boundsMin;
+	}
+
+	const glm::vec3& Mesh::getBoundsMax() {
+		return boundsMax;
+	}
+
+	uint32_t Mesh::getMeshletCount() {
+		return meshletCount;
+	}
+
+	ktw::Buffer* Mesh::getMeshletBuffer() {
+		return meshletBuffer.get();
+	}
+
+	ktw::Buffer* Mesh::getDrawCommandBuffer() {
+		return drawCommandBuffer.get();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Context.hpp"
+#include "Buffer.hpp"
+#include "GeometryArena.hpp"
+#include "GraphicsPipeline.hpp"
+#include "MeshFormat.hpp"
+
+namespace ktw {
+	// A level of detail of a submesh, error is its object space distance to level 0
+	struct MeshLod {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		float error;
+	};
+
+	struct Submesh {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		int32_t vertexOffset;
+		uint32_t materialIndex;
+		// Finest first, lods[0] is the submesh itself (filled by Mesh)
+		std::vector<ktw::MeshLod> lods;
+	};
+
+	// Vertex and index buffers with the layout and the submeshes drawing
+	// ranges of them. Meshes loaded from a .ktwmesh file are copied from the
+	// mapping to the buffers without any parsing of the vertex data, and come
+	// with the meshlets MeshletCuller culls (procedural meshes have none).
+	// Given an arena, the mesh is sub-allocated from its shared buffers
+	// instead, and every range it exposes is rebased onto them.
+	class Mesh {
+	public:
+		Mesh(ktw::Context& context, const std::string& filename, ktw::GeometryArena* arena = nullptr);
+		Mesh(ktw::Context& context, const ktw::VertexBufferBinding& vertexBufferBinding, const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const std::vector<ktw::Submesh>& submeshes = {}, ktw::GeometryArena* arena = nullptr);
+		~Mesh();
+
+		ktw::Buffer* getVertexBuffer();
+		ktw::Buffer* getIndexBuffer();
+		const ktw::VertexBufferBinding& getVertexBufferBinding();
+		const std::vector<ktw::Submesh>& getSubmeshes();
+		const glm::vec3& getBoundsMin();
+		const glm::vec3& getBoundsMax();
+		uint32_t getMeshletCount();
+		ktw::Buffer* getMeshletBuffer();
+		// One VkDrawIndexedIndirectCommand per meshlet, written by MeshletCuller
+		ktw::Buffer* getDrawCommandBuffer();
+
+	private:
+		ktw::VertexBufferBinding vertexBufferBinding;
+		std::unique_ptr<ktw::Buffer> vertexBuffer;
+		std::unique_ptr<ktw::Buffer> indexBuffer;
+		ktw::GeometryArena* arena;
+		ktw::GeometryAllocation allocation;
+		std::vector<ktw::Submesh> submeshes;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		uint32_t meshletCount = 0;
+		std::unique_ptr<ktw::Buffer> meshletBuffer;
+		std::unique_ptr<ktw::Buffer> drawCommandBuffer;
+
+		void allocateInArena(const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, uint32_t indexSize);
+	};
+}
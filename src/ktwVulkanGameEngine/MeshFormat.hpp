@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+
+// On-disk layout of .ktwmesh files, shared by the engine and the offline
+// MeshConverter. Everything is little-endian and laid out so the vertex and
+// index blobs can be copied to GPU buffers straight from a memory mapping:
+//
+//   MeshFileHeader
+//   MeshFileAttribute[attributeCount]
+//   MeshFileSubmesh[submeshCount]
+//   vertex blob (vertexCount * vertexStride bytes, meshFileAlignment aligned)
+//   index blob  (indexCount * indexSize bytes, 2 or 4, meshFileAlignment aligned)
+//   MeshFileMeshlet[meshletCount] (meshFileAlignment aligned)
+//   MeshFileLod[lodCount] (meshFileAlignment aligned)
+//
+// Simplified levels of detail are extra index ranges of the same index blob,
+// over the same vertices. Level 0 of a submesh is the submesh itself.
+namespace ktw {
+	const char meshFileMagic[4] = {'K', 'T', 'W', 'M'};
+	const uint32_t meshFileVersion = 3;
+	const uint32_t meshFileAlignment = 16;
+
+	struct MeshFileHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t vertexStride;
+		uint32_t vertexCount;
+		uint32_t indexSize;
+		uint32_t indexCount;
+		uint32_t attributeCount;
+		uint32_t submeshCount;
+		uint64_t vertexDataOffset;
+		uint64_t indexDataOffset;
+		float boundsMin[3];
+		float boundsMax[3];
+		uint32_t meshletCount;
+		uint32_t lodCount;
+		uint64_t meshletDataOffset;
+		uint64_t lodDataOffset;
+	};
+
+	// Same meaning as ktw::AttributeDescription, format is a VkFormat
+	struct MeshFileAttribute {
+		uint32_t location;
+		uint32_t format;
+		uint32_t offset;
+	};
+
+	struct MeshFileSubmesh {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		int32_t vertexOffset;
+		uint32_t materialIndex;
+	};
+
+	// Same meaning and layout as ktw::Meshlet, index ranges are absolute and
+	// never straddle two submeshes
+	struct MeshFileMeshlet {
+		float center[3];
+		float radius;
+		float coneAxis[3];
+		float coneCutoff;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		int32_t vertexOffset;
+		uint32_t padding;
+	};
+
+	// Levels 1 and up of a submesh, in order. error is the object space
+	// distance to the full detail surface.
+	struct MeshFileLod {
+		uint32_t submeshIndex;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		float error;
+	};
+
+	static_assert(sizeof(MeshFileHeader) == 96, "MeshFileHeader must not be padded");
+	static_assert(sizeof(MeshFileAttribute) == 12, "MeshFileAttribute must not be padded");
+	static_assert(sizeof(MeshFileSubmesh) == 16, "MeshFileSubmesh must not be padded");
+	static_assert(sizeof(MeshFileMeshlet) == 48, "MeshFileMeshlet must not be padded");
+	static_assert(sizeof(MeshFileLod) == 16, "MeshFileLod must not be padded");
+
+	inline uint64_t alignMeshFileOffset(uint64_t offset) {
+		return (offset + meshFileAlignment - 1) & ~static_cast<uint64_t>(meshFileAlignment - 1);
+	}
+}
@@ -0,0 +1,291 @@
+#include "pch.hpp"
+#include "MeshOptimizer.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace ktw {
+	namespace {
+		// Scoring constants from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+		const uint32_t forsythCacheSize = 32;
+		const float cacheDecayPower = 1.5f;
+		const float lastTriangleScore = 0.75f;
+		const float valenceBoostScale = 2.0f;
+		const float valenceBoostPower = 0.5f;
+
+		float vertexScore(int cachePosition, uint32_t remainingTriangles) {
+			if(remainingTriangles == 0) {
+				return -1.0f;
+			}
+
+			float score = 0.0f;
+			if(cachePosition >= 0) {
+				if(cachePosition < 3) {
+					// The triangle just emitted, its vertices are no better than the next ones
+					score = lastTriangleScore;
+				}
+				else {
+					score = std::pow(1.0f - static_cast<float>(cachePosition - 3) / (forsythCacheSize - 3), cacheDecayPower);
+				}
+			}
+
+			// Vertices with few triangles left are finished first, so they leave the cache
+			return score + valenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -valenceBoostPower);
+		}
+
+		void readPosition(const void* vertices, size_t vertexSize, size_t positionOffset, uint32_t positionComponents, uint32_t index, float position[3]) {
+			position[2] = 0.0f;
+			memcpy(position, static_cast<const uint8_t*>(vertices) + index * vertexSize + positionOffset, positionComponents * sizeof(float));
+		}
+	}
+
+	void MeshOptimizer::optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+		size_t triangleCount = indexCount / 3;
+		if(triangleCount == 0) {
+			return;
+		}
+
+		// Triangles around each vertex, the first remaining[v] of them are not emitted yet
+		std::vector<uint32_t> remaining(vertexCount, 0);
+		for(size_t i = 0; i < indexCount; i++) {
+			remaining[indices[i]]++;
+		}
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for(size_t v = 0; v < vertexCount; v++) {
+			offsets[v + 1] = offsets[v] + remaining[v];
+		}
+		std::vector<uint32_t> adjacency(indexCount);
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for(size_t i = 0; i < indexCount; i++) {
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::vector<int> cachePositions(vertexCount, -1);
+		std::vector<float> vertexScores(vertexCount);
+		for(size_t v = 0; v < vertexCount; v++) {
+			vertexScores[v] = vertexScore(-1, remaining[v]);
+		}
+
+		std::vector<float> triangleScores(triangleCount);
+		for(size_t t = 0; t < triangleCount; t++) {
+			triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		}
+
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> cache;
+		std::vector<uint32_t> nextCache;
+		std::vector<uint32_t> result;
+		result.reserve(triangleCount * 3);
+
+		size_t scanCursor = 0;
+		int64_t best = -1;
+		while(result.size() < triangleCount * 3) {
+			if(best < 0) {
+				// Nothing left around the cache, restart from the next triangle in input order
+				while(emitted[scanCursor]) {
+					scanCursor++;
+				}
+				best = static_cast<int64_t>(scanCursor);
+			}
+
+			uint32_t triangle[3] = {indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2]};
+			emitted[best] = true;
+			result.insert(result.end(), triangle, triangle + 3);
+
+			for(uint32_t v : triangle) {
+				uint32_t* begin = &adjacency[offsets[v]];
+				uint32_t* it = std::find(begin, begin + remaining[v], static_cast<uint32_t>(best));
+				std::swap(*it, begin[remaining[v] - 1]);
+				remaining[v]--;
+			}
+
+			// The emitted vertices move to the front, the rest is pushed back
+			nextCache.clear();
+			for(uint32_t v : triangle) {
+				if(std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end()) {
+					nextCache.push_back(v);
+				}
+			}
+			for(uint32_t v : cache) {
+				if(v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+					nextCache.push_back(v);
+				}
+			}
+
+			for(size_t i = 0; i < nextCache.size(); i++) {
+				uint32_t v = nextCache[i];
+				cachePositions[v] = i < forsythCacheSize ? static_cast<int>(i) : -1;
+				vertexScores[v] = vertexScore(cachePositions[v], remaining[v]);
+			}
+
+			best = -1;
+			float bestScore = -1.0f;
+			for(uint32_t v : nextCache) {
+				for(uint32_t i = 0; i < remaining[v]; i++) {
+					uint32_t t = adjacency[offsets[v] + i];
+					triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+					if(triangleScores[t] > bestScore) {
+						bestScore = triangleScores[t];
+						best = t;
+					}
+				}
+			}
+
+			if(nextCache.size() > forsythCacheSize) {
+				nextCache.resize(forsythCacheSize);
+			}
+			std::swap(cache, nextCache);
+		}
+
+		std::copy(result.begin(), result.end(), indices);
+	}
+
+	ktw::VertexCacheStatistics MeshOptimizer::analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+		ktw::VertexCacheStatistics statistics;
+		// Both ratios are zero without a whole triangle
+		if(indexCount < 3) {
+			return statistics;
+		}
+
+		// FIFO cache: a vertex is a hit while fewer than cacheSize misses happened since it was loaded
+		std::vector<uint64_t> timestamps(vertexCount, 0);
+		uint64_t time = cacheSize + 1;
+		size_t misses = 0;
+		size_t usedVertices = 0;
+		for(size_t i = 0; i < indexCount; i++) {
+			uint32_t v = indices[i];
+			if(timestamps[v] == 0) {
+				usedVertices++;
+			}
+			if(time - timestamps[v] > cacheSize) {
+				timestamps[v] = time++;
+				misses++;
+			}
+		}
+
+		statistics.acmr = static_cast<float>(misses) / (indexCount / 3);
+		statistics.atvr = static_cast<float>(misses) / usedVertices;
+		return statistics;
+	}
+
+	void MeshOptimizer::optimizeOverdraw(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize, size_t positionOffset, uint32_t positionComponents, float threshold) {
+		size_t triangleCount = indexCount / 3;
+		if(triangleCount < 2) {
+			return;
+		}
+
+		// Clusters start where all three vertices miss the cache, moving them around costs almost nothing
+		std::vector<size_t> clusterStarts;
+		std::vector<uint64_t> timestamps(vertexCount, 0);
+		uint64_t time = defaultCacheSize + 1;
+		for(size_t t = 0; t < triangleCount; t++) {
+			int misses = 0;
+			for(int k = 0; k < 3; k++) {
+				uint32_t v = indices[t * 3 + k];
+				if(time - timestamps[v] > defaultCacheSize) {
+					timestamps[v] = time++;
+					misses++;
+				}
+			}
+			if(t == 0 || misses == 3) {
+				clusterStarts.push_back(t);
+			}
+		}
+		clusterStarts.push_back(triangleCount);
+
+		float meshCentroid[3] = {0.0f, 0.0f, 0.0f};
+		for(size_t v = 0; v < vertexCount; v++) {
+			float p[3];
+			readPosition(vertices, vertexSize, positionOffset, positionComponents, static_cast<uint32_t>(v), p);
+			for(int c = 0; c < 3; c++) {
+				meshCentroid[c] += p[c] / vertexCount;
+			}
+		}
+
+		// Clusters facing away from the mesh center are the likely occluders, drawn first
+		size_t clusterCount = clusterStarts.size() - 1;
+		std::vector<float> sortKeys(clusterCount);
+		for(size_t c = 0; c < clusterCount; c++) {
+			float centroid[3] = {0.0f, 0.0f, 0.0f};
+			float normal[3] = {0.0f, 0.0f, 0.0f};
+			float area = 0.0f;
+			for(size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+				float p[3][3];
+				for(int k = 0; k < 3; k++) {
+					readPosition(vertices, vertexSize, positionOffset, positionComponents, indices[t * 3 + k], p[k]);
+				}
+				float e1[3] = {p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]};
+				float e2[3] = {p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]};
+				float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+				float triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				for(int i = 0; i < 3; i++) {
+					centroid[i] += (p[0][i] + p[1][i] + p[2][i]) / 3.0f * triangleArea;
+					normal[i] += n[i];
+				}
+				area += triangleArea;
+			}
+			float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			float key = 0.0f;
+			if(area > 0.0f && length > 0.0f) {
+				for(int i = 0; i < 3; i++) {
+					key += (centroid[i] / area - meshCentroid[i]) * normal[i] / length;
+				}
+			}
+			sortKeys[c] = key;
+		}
+
+		std::vector<size_t> order(clusterCount);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			return sortKeys[a] > sortKeys[b];
+		});
+
+		std::vector<uint32_t> result;
+		result.reserve(indexCount);
+		for(size_t c : order) {
+			result.insert(result.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+		}
+
+		float before = analyzeVertexCache(indices, indexCount, vertexCount).acmr;
+		float after = analyzeVertexCache(result.data(), result.size(), vertexCount).acmr;
+		if(after <= before * threshold) {
+			std::copy(result.begin(), result.end(), indices);
+		}
+	}
+
+	size_t MeshOptimizer::optimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexSize, uint32_t* indices, size_t indexCount) {
+		const uint32_t unused = ~0u;
+		std::vector<uint32_t> remap(vertexCount, unused);
+		uint32_t next = 0;
+		for(size_t i = 0; i < indexCount; i++) {
+			uint32_t& target = remap[indices[i]];
+			if(target == unused) {
+				target = next++;
+			}
+			indices[i] = target;
+		}
+
+		std::vector<uint8_t> original(static_cast<uint8_t*>(vertices), static_cast<uint8_t*>(vertices) + vertexCount * vertexSize);
+		for(size_t v = 0; v < vertexCount; v++) {
+			if(remap[v] != unused) {
+				memcpy(static_cast<uint8_t*>(vertices) + remap[v] * vertexSize, original.data() + v * vertexSize, vertexSize);
+			}
+		}
+		return next;
+	}
+
+	ktw::MeshOptimizationReport MeshOptimizer::optimize(std::vector<uint32_t>& indices, void* vertices, size_t& vertexCount, size_t vertexSize, size_t positionOffset, uint32_t positionComponents) {
+		ktw::MeshOptimizationReport report;
+		report.vertexCountBefore = vertexCount;
+		report.before = analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+		optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+		optimizeOverdraw(indices.data(), indices.size(), vertices, vertexCount, vertexSize, positionOffset, positionComponents);
+		vertexCount = optimizeVertexFetch(vertices, vertexCount, vertexSize, indices.data(), indices.size());
+
+		report.vertexCountAfter = vertexCount;
+		report.after = analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+		return report;
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ktw {
+	// ACMR: post-transform cache misses per triangle (0.5 is the ideal for a
+	// regular grid, 3 the worst). ATVR: misses per vertex used (1 is ideal).
+	struct VertexCacheStatistics {
+		float acmr = 0.0f;
+		float atvr = 0.0f;
+	};
+
+	struct MeshOptimizationReport {
+		ktw::VertexCacheStatistics before;
+		ktw::VertexCacheStatistics after;
+		size_t vertexCountBefore = 0;
+		size_t vertexCountAfter = 0;
+	};
+
+	// Index and vertex reordering for triangle lists, meant to run once when
+	// a mesh is imported or baked. optimize() runs the usual sequence:
+	// vertex cache, then overdraw (bounded by the cache loss it may cause),
+	// then vertex fetch.
+	class MeshOptimizer {
+	public:
+		static const uint32_t defaultCacheSize = 16;
+
+		// Tom Forsyth's linear-speed vertex cache optimisation
+		static void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+		// Sorts cache-friendly triangle clusters outside-in (Sander et al.), reverted if ACMR grows by more than threshold
+		static void optimizeOverdraw(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize, size_t positionOffset, uint32_t positionComponents = 3, float threshold = 1.05f);
+		// Orders vertices by first use and drops unreferenced ones, returns the new vertex count
+		static size_t optimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexSize, uint32_t* indices, size_t indexCount);
+		static ktw::VertexCacheStatistics analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = defaultCacheSize);
+		static ktw::MeshOptimizationReport optimize(std::vector<uint32_t>& indices, void* vertices, size_t& vertexCount, size_t vertexSize, size_t positionOffset, uint32_t positionComponents = 3);
+	};
+}
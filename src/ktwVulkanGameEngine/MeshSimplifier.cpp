@@ -0,0 +1,281 @@
+#include "pch.hpp"
+#include "MeshSimplifier.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+namespace ktw {
+	namespace {
+		// Levels smaller than this are not worth a draw of their own
+		const size_t minLodIndexCount = 3 * 8;
+		// Cosine of the largest rotation a collapse may give a remaining triangle
+		const double maxNormalRotation = 0.25;
+
+		struct Vector {
+			double x, y, z;
+		};
+
+		Vector subtract(const Vector& a, const Vector& b) {
+			return {a.x - b.x, a.y - b.y, a.z - b.z};
+		}
+
+		Vector cross(const Vector& a, const Vector& b) {
+			return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+		}
+
+		double dot(const Vector& a, const Vector& b) {
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+		// Symmetric 4x4 matrix of the summed plane equations, and the area they were weighted by
+		struct Quadric {
+			double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+			double weight = 0;
+
+			void addPlane(const Vector& normal, double d, double w) {
+				a2 += w * normal.x * normal.x; ab += w * normal.x * normal.y; ac += w * normal.x * normal.z; ad += w * normal.x * d;
+				b2 += w * normal.y * normal.y; bc += w * normal.y * normal.z; bd += w * normal.y * d;
+				c2 += w * normal.z * normal.z; cd += w * normal.z * d;
+				d2 += w * d * d;
+				weight += w;
+			}
+
+			void add(const Quadric& other) {
+				a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+				b2 += other.b2; bc += other.bc; bd += other.bd;
+				c2 += other.c2; cd += other.cd;
+				d2 += other.d2;
+				weight += other.weight;
+			}
+
+			// Mean squared distance of p to the planes
+			double evaluate(const Vector& p) const {
+				double error =
+					a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x +
+					b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y +
+					c2 * p.z * p.z + 2 * cd * p.z +
+					d2;
+				return weight > 0 ? std::max(error, 0.0) / weight : 0.0;
+			}
+		};
+
+		struct Collapse {
+			uint32_t from;
+			uint32_t to;
+			double cost;
+		};
+
+		uint64_t edgeKey(uint32_t a, uint32_t b) {
+			return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+		}
+	}
+
+	std::vector<uint32_t> MeshSimplifier::simplify(const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize, size_t positionOffset, size_t targetIndexCount, float maxError, float* error, uint32_t positionComponents) {
+		std::vector<uint32_t> result(indices, indices + indexCount);
+		double resultError = 0.0;
+
+		std::vector<Vector> positions(vertexCount);
+		for(size_t v = 0; v < vertexCount; v++) {
+			float position[3] = {0.0f, 0.0f, 0.0f};
+			memcpy(position, static_cast<const uint8_t*>(vertices) + v * vertexSize + positionOffset, positionComponents * sizeof(float));
+			positions[v] = {position[0], position[1], position[2]};
+		}
+
+		// Vertices at the same position are one vertex of the surface, with several attribute variants
+		std::vector<uint32_t> canonical(vertexCount);
+		std::vector<uint32_t> variantCount(vertexCount, 0);
+		{
+			std::map<std::tuple<double, double, double>, uint32_t> byPosition;
+			for(uint32_t v = 0; v < vertexCount; v++) {
+				auto it = byPosition.emplace(std::make_tuple(positions[v].x, positions[v].y, positions[v].z), v).first;
+				canonical[v] = it->second;
+				variantCount[it->second]++;
+			}
+		}
+
+		std::vector<Quadric> quadrics(vertexCount);
+		std::vector<bool> locked(vertexCount, false);
+		{
+			std::unordered_map<uint64_t, uint32_t> edgeUses;
+			for(size_t i = 0; i + 2 < result.size(); i += 3) {
+				uint32_t corners[3] = {canonical[result[i]], canonical[result[i + 1]], canonical[result[i + 2]]};
+				Vector normal = cross(subtract(positions[corners[1]], positions[corners[0]]), subtract(positions[corners[2]], positions[corners[0]]));
+				double length = std::sqrt(dot(normal, normal));
+				if(length > 0.0) {
+					Vector unit = {normal.x / length, normal.y / length, normal.z / length};
+					double d = -dot(unit, positions[corners[0]]);
+					for(uint32_t corner : corners) {
+						quadrics[corner].addPlane(unit, d, length * 0.5);
+					}
+				}
+				for(int c = 0; c < 3; c++) {
+					edgeUses[edgeKey(corners[c], corners[(c + 1) % 3])]++;
+				}
+			}
+			for(auto& [key, uses] : edgeUses) {
+				if(uses == 1) {
+					locked[key >> 32] = true;
+					locked[key & 0xffffffffu] = true;
+				}
+			}
+			for(uint32_t v = 0; v < vertexCount; v++) {
+				locked[v] = locked[v] || variantCount[v] > 1;
+			}
+		}
+
+		double maxCost = static_cast<double>(maxError) * maxError;
+		std::vector<uint32_t> collapseTarget(vertexCount);
+		std::vector<bool> touched(vertexCount);
+		std::vector<uint32_t> offsets(vertexCount + 1);
+		std::vector<uint32_t> adjacency;
+
+		while(result.size() > targetIndexCount) {
+			size_t triangleCount = result.size() / 3;
+
+			// Triangles around each (canonical) vertex
+			std::fill(offsets.begin(), offsets.end(), 0);
+			for(uint32_t index : result) {
+				offsets[canonical[index] + 1]++;
+			}
+			for(size_t v = 0; v < vertexCount; v++) {
+				offsets[v + 1] += offsets[v];
+			}
+			adjacency.resize(result.size());
+			std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for(size_t i = 0; i < result.size(); i++) {
+				adjacency[fill[canonical[result[i]]]++] = static_cast<uint32_t>(i / 3);
+			}
+
+			std::vector<Collapse> collapses;
+			collapses.reserve(result.size() * 2);
+			for(size_t t = 0; t < triangleCount; t++) {
+				for(int c = 0; c < 3; c++) {
+					uint32_t a = canonical[result[t * 3 + c]];
+					uint32_t b = canonical[result[t * 3 + (c + 1) % 3]];
+					if(!locked[a]) {
+						collapses.push_back({a, b, quadrics[a].evaluate(positions[b])});
+					}
+					if(!locked[b]) {
+						collapses.push_back({b, a, quadrics[b].evaluate(positions[a])});
+					}
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) {
+				return x.cost < y.cost;
+			});
+
+			// Collapses of a pass must not share triangles, or the flip checks would be stale
+			std::fill(touched.begin(), touched.end(), false);
+			std::fill(collapseTarget.begin(), collapseTarget.end(), std::numeric_limits<uint32_t>::max());
+			size_t remainingIndexCount = result.size();
+			size_t collapseCount = 0;
+			for(auto& collapse : collapses) {
+				if(collapse.cost > maxCost || remainingIndexCount <= targetIndexCount) {
+					break;
+				}
+				if(touched[collapse.from] || touched[collapse.to]) {
+					continue;
+				}
+
+				bool valid = true;
+				uint32_t target = std::numeric_limits<uint32_t>::max();
+				size_t removedTriangles = 0;
+				for(uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1] && valid; i++) {
+					uint32_t t = adjacency[i];
+					uint32_t corners[3] = {canonical[result[t * 3]], canonical[result[t * 3 + 1]], canonical[result[t * 3 + 2]]};
+					if(corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+						// Degenerates, the variant of the target it uses is the one on this side of any seam
+						for(int c = 0; c < 3; c++) {
+							if(corners[c] == collapse.to) {
+								target = result[t * 3 + c];
+							}
+						}
+						removedTriangles++;
+						continue;
+					}
+
+					Vector before[3];
+					Vector after[3];
+					for(int c = 0; c < 3; c++) {
+						before[c] = positions[corners[c]];
+						after[c] = corners[c] == collapse.from ? positions[collapse.to] : before[c];
+					}
+					Vector normalBefore = cross(subtract(before[1], before[0]), subtract(before[2], before[0]));
+					Vector normalAfter = cross(subtract(after[1], after[0]), subtract(after[2], after[0]));
+					// Rejects flips, and the slivers left when all corners end up on a locked seam or border
+					valid = dot(normalBefore, normalAfter) > maxNormalRotation * std::sqrt(dot(normalBefore, normalBefore) * dot(normalAfter, normalAfter));
+				}
+				if(!valid || target == std::numeric_limits<uint32_t>::max()) {
+					continue;
+				}
+
+				collapseTarget[collapse.from] = target;
+				quadrics[collapse.to].add(quadrics[collapse.from]);
+				resultError = std::max(resultError, collapse.cost);
+				remainingIndexCount -= removedTriangles * 3;
+				collapseCount++;
+				for(uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1]; i++) {
+					uint32_t t = adjacency[i];
+					for(int c = 0; c < 3; c++) {
+						touched[canonical[result[t * 3 + c]]] = true;
+					}
+				}
+			}
+			if(collapseCount == 0) {
+				break;
+			}
+
+			size_t write = 0;
+			for(size_t t = 0; t < triangleCount; t++) {
+				uint32_t triangle[3];
+				for(int c = 0; c < 3; c++) {
+					uint32_t index = result[t * 3 + c];
+					uint32_t target = collapseTarget[canonical[index]];
+					triangle[c] = target != std::numeric_limits<uint32_t>::max() ? target : index;
+				}
+				uint32_t a = canonical[triangle[0]], b = canonical[triangle[1]], c = canonical[triangle[2]];
+				if(a == b || b == c || a == c) {
+					continue;
+				}
+				memcpy(&result[write], triangle, sizeof(triangle));
+				write += 3;
+			}
+			result.resize(write);
+		}
+
+		if(error) {
+			*error = static_cast<float>(std::sqrt(resultError));
+		}
+		return result;
+	}
+
+	std::vector<ktw::SimplifiedLod> MeshSimplifier::generateLods(const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize, size_t positionOffset, uint32_t maxLevels, uint32_t positionComponents) {
+		std::vector<ktw::SimplifiedLod> lods;
+		const uint32_t* source = indices;
+		size_t sourceIndexCount = indexCount;
+		float sourceError = 0.0f;
+		for(uint32_t level = 1; level <= maxLevels; level++) {
+			size_t target = (sourceIndexCount / 2) / 3 * 3;
+			if(target < minLodIndexCount) {
+				break;
+			}
+
+			// Each level is simplified from the previous one, so the chain costs about twice the first level.
+			// Errors add up, which also keeps them growing along the chain as the selector expects.
+			ktw::SimplifiedLod lod;
+			lod.indices = simplify(source, sourceIndexCount, vertices, vertexCount, vertexSize, positionOffset, target, std::numeric_limits<float>::max(), &lod.error, positionComponents);
+			if(lod.indices.size() > sourceIndexCount * 9 / 10) {
+				break;
+			}
+			lod.error += sourceError;
+			lods.push_back(std::move(lod));
+			source = lods.back().indices.data();
+			sourceIndexCount = lods.back().indices.size();
+			sourceError = lods.back().error;
+		}
+		return lods;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ktw {
+	// A level of detail as indices over the same vertices as the full mesh.
+	// error is the object space distance by which it may deviate from it.
+	struct SimplifiedLod {
+		std::vector<uint32_t> indices;
+		float error = 0.0f;
+	};
+
+	// Quadric error metric simplification (Garland and Heckbert), meant to run
+	// once when a mesh is imported or baked. Edges are collapsed onto one of
+	// their existing vertices, so every level shares the vertex buffer and only
+	// needs its own index range. Border vertices and seams (vertices at the same
+	// position with other attributes) never move, so UVs and open edges hold.
+	class MeshSimplifier {
+	public:
+		static std::vector<uint32_t> simplify(const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize, size_t positionOffset, size_t targetIndexCount, float maxError = std::numeric_limits<float>::max(), float* error = nullptr, uint32_t positionComponents = 3);
+		// Each level aims at half the triangles of the previous one, the chain stops
+		// when a level would remove less than a tenth of them. Errors only grow.
+		static std::vector<ktw::SimplifiedLod> generateLods(const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize, size_t positionOffset, uint32_t maxLevels = 4, uint32_t positionComponents = 3);
+	};
+}
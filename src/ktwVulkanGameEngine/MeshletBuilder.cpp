@@ -0,0 +1,214 @@
+#include "pch.hpp"
+#include "MeshletBuilder.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace ktw {
+	namespace {
+		// Cones wider than this (about 84 degrees from the axis) never cull anything, they are disabled
+		const float minConeDot = 0.1f;
+
+		void readPosition(const void* vertices, size_t vertexSize, size_t positionOffset, uint32_t positionComponents, uint32_t index, float position[3]) {
+			position[2] = 0.0f;
+			memcpy(position, static_cast<const uint8_t*>(vertices) + index * vertexSize + positionOffset, positionComponents * sizeof(float));
+		}
+
+		void triangleNormal(const float a[3], const float b[3], const float c[3], float normal[3]) {
+			float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+			float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+			normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+			normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+			normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+			float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			for(int c = 0; c < 3; c++) {
+				// Degenerate triangles get a null normal, they do not constrain the cone
+				normal[c] = length > 0.0f ? normal[c] / length : 0.0f;
+			}
+		}
+	}
+
+	std::vector<ktw::Meshlet> MeshletBuilder::build(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize, size_t positionOffset, uint32_t positionComponents) {
+		std::vector<ktw::Meshlet> meshlets;
+		size_t triangleCount = indexCount / 3;
+		if(triangleCount == 0) {
+			return meshlets;
+		}
+
+		std::vector<float> normals(triangleCount * 3);
+		for(size_t t = 0; t < triangleCount; t++) {
+			float a[3], b[3], c[3];
+			readPosition(vertices, vertexSize, positionOffset, positionComponents, indices[t * 3 + 0], a);
+			readPosition(vertices, vertexSize, positionOffset, positionComponents, indices[t * 3 + 1], b);
+			readPosition(vertices, vertexSize, positionOffset, positionComponents, indices[t * 3 + 2], c);
+			triangleNormal(a, b, c, &normals[t * 3]);
+		}
+
+		// Triangles around each vertex
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for(size_t i = 0; i < triangleCount * 3; i++) {
+			offsets[indices[i] + 1]++;
+		}
+		for(size_t v = 0; v < vertexCount; v++) {
+			offsets[v + 1] += offsets[v];
+		}
+		std::vector<uint32_t> adjacency(triangleCount * 3);
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for(size_t i = 0; i < triangleCount * 3; i++) {
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::vector<bool> emitted(triangleCount, false);
+		// Meshlet a vertex or a candidate triangle was last added to, so membership needs no clearing
+		const uint32_t none = std::numeric_limits<uint32_t>::max();
+		std::vector<uint32_t> vertexMeshlet(vertexCount, none);
+		std::vector<uint32_t> candidateMeshlet(triangleCount, none);
+		std::vector<uint32_t> reordered;
+		reordered.reserve(triangleCount * 3);
+		size_t scanCursor = 0;
+
+		while(true) {
+			// Seeds are taken in input order, which the vertex cache optimization made spatially coherent
+			while(scanCursor < triangleCount && emitted[scanCursor]) {
+				scanCursor++;
+			}
+			if(scanCursor == triangleCount) {
+				break;
+			}
+
+			uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+			ktw::Meshlet meshlet{};
+			meshlet.firstIndex = static_cast<uint32_t>(reordered.size());
+			uint32_t meshletVertexCount = 0;
+			uint32_t meshletTriangleCount = 0;
+			float normalSum[3] = {0.0f, 0.0f, 0.0f};
+			std::vector<uint32_t> candidates;
+
+			auto add = [&](uint32_t triangle) {
+				emitted[triangle] = true;
+				meshletTriangleCount++;
+				for(int k = 0; k < 3; k++) {
+					normalSum[k] += normals[triangle * 3 + k];
+				}
+				for(int c = 0; c < 3; c++) {
+					uint32_t vertex = indices[triangle * 3 + c];
+					reordered.push_back(vertex);
+					if(vertexMeshlet[vertex] != meshletIndex) {
+						vertexMeshlet[vertex] = meshletIndex;
+						meshletVertexCount++;
+						for(uint32_t i = offsets[vertex]; i < offsets[vertex + 1]; i++) {
+							uint32_t neighbour = adjacency[i];
+							if(!emitted[neighbour] && candidateMeshlet[neighbour] != meshletIndex) {
+								candidateMeshlet[neighbour] = meshletIndex;
+								candidates.push_back(neighbour);
+							}
+						}
+					}
+				}
+			};
+
+			add(static_cast<uint32_t>(scanCursor));
+
+			while(meshletTriangleCount < maxTriangles) {
+				// Grow through connected triangles, fewest new vertices first, then the most aligned
+				// normal so the cone stays narrow
+				uint32_t best = none;
+				uint32_t bestNewVertices = 4;
+				float bestAlignment = -std::numeric_limits<float>::max();
+				for(size_t i = 0; i < candidates.size(); i++) {
+					uint32_t triangle = candidates[i];
+					if(emitted[triangle]) {
+						candidates[i--] = candidates.back();
+						candidates.pop_back();
+						continue;
+					}
+
+					uint32_t newVertices = 0;
+					for(int c = 0; c < 3; c++) {
+						newVertices += vertexMeshlet[indices[triangle * 3 + c]] != meshletIndex ? 1 : 0;
+					}
+					if(meshletVertexCount + newVertices > maxVertices) {
+						continue;
+					}
+
+					float alignment = normals[triangle * 3 + 0] * normalSum[0] + normals[triangle * 3 + 1] * normalSum[1] + normals[triangle * 3 + 2] * normalSum[2];
+					if(newVertices < bestNewVertices || (newVertices == bestNewVertices && alignment > bestAlignment)) {
+						best = triangle;
+						bestNewVertices = newVertices;
+						bestAlignment = alignment;
+					}
+				}
+				if(best == none) {
+					break;
+				}
+				add(best);
+			}
+
+			meshlet.indexCount = meshletTriangleCount * 3;
+			computeBounds(meshlet, reordered.data(), vertices, vertexSize, positionOffset, positionComponents);
+			meshlets.push_back(meshlet);
+		}
+
+		std::copy(reordered.begin(), reordered.end(), indices);
+		return meshlets;
+	}
+
+	void MeshletBuilder::computeBounds(ktw::Meshlet& meshlet, const uint32_t* indices, const void* vertices, size_t vertexSize, size_t positionOffset, uint32_t positionComponents) {
+		const uint32_t* first = indices + meshlet.firstIndex;
+		uint32_t triangleCount = meshlet.indexCount / 3;
+
+		// Sphere around the box center, looser than a minimal sphere but stable and cheap
+		float boundsMin[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+		float boundsMax[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+		for(uint32_t i = 0; i < meshlet.indexCount; i++) {
+			float position[3];
+			readPosition(vertices, vertexSize, positionOffset, positionComponents, first[i], position);
+			for(int c = 0; c < 3; c++) {
+				boundsMin[c] = std::min(boundsMin[c], position[c]);
+				boundsMax[c] = std::max(boundsMax[c], position[c]);
+			}
+		}
+		float radiusSquared = 0.0f;
+		for(int c = 0; c < 3; c++) {
+			meshlet.center[c] = meshlet.indexCount > 0 ? (boundsMin[c] + boundsMax[c]) * 0.5f : 0.0f;
+		}
+		for(uint32_t i = 0; i < meshlet.indexCount; i++) {
+			float position[3];
+			readPosition(vertices, vertexSize, positionOffset, positionComponents, first[i], position);
+			float dx = position[0] - meshlet.center[0];
+			float dy = position[1] - meshlet.center[1];
+			float dz = position[2] - meshlet.center[2];
+			radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+		}
+		meshlet.radius = std::sqrt(radiusSquared);
+
+		// Cone axis is the average normal, its cutoff the sine of the widest normal's angle to it
+		std::vector<float> normals(triangleCount * 3);
+		float axis[3] = {0.0f, 0.0f, 0.0f};
+		for(uint32_t t = 0; t < triangleCount; t++) {
+			float a[3], b[3], c[3];
+			readPosition(vertices, vertexSize, positionOffset, positionComponents, first[t * 3 + 0], a);
+			readPosition(vertices, vertexSize, positionOffset, positionComponents, first[t * 3 + 1], b);
+			readPosition(vertices, vertexSize, positionOffset, positionComponents, first[t * 3 + 2], c);
+			triangleNormal(a, b, c, &normals[t * 3]);
+			for(int k = 0; k < 3; k++) {
+				axis[k] += normals[t * 3 + k];
+			}
+		}
+		float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		float minDot = axisLength > 0.0f ? 1.0f : -1.0f;
+		for(int k = 0; k < 3; k++) {
+			meshlet.coneAxis[k] = axisLength > 0.0f ? axis[k] / axisLength : 0.0f;
+		}
+		for(uint32_t t = 0; t < triangleCount && axisLength > 0.0f; t++) {
+			const float* normal = &normals[t * 3];
+			if(normal[0] == 0.0f && normal[1] == 0.0f && normal[2] == 0.0f) {
+				continue;
+			}
+			minDot = std::min(minDot, normal[0] * meshlet.coneAxis[0] + normal[1] * meshlet.coneAxis[1] + normal[2] * meshlet.coneAxis[2]);
+		}
+		// A cutoff of 1 makes the back-face test always fail
+		meshlet.coneCutoff = minDot < minConeDot ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+	}
+}
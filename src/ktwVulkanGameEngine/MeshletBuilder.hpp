@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ktw {
+	// A cluster of triangles drawn as one contiguous index range. The bounds
+	// are in object space: a sphere for frustum culling and a normal cone for
+	// back-face culling, the whole meshlet faces away from the camera when
+	// dot(center - camera, coneAxis) >= coneCutoff * length(center - camera) + radius.
+	// Same layout as MeshFileMeshlet and the Meshlet struct of meshlet_cull.comp.
+	struct Meshlet {
+		float center[3];
+		float radius;
+		float coneAxis[3];
+		float coneCutoff;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		int32_t vertexOffset;
+		uint32_t padding;
+	};
+
+	static_assert(sizeof(Meshlet) == 48, "Meshlet must match the std430 layout of the culling shader");
+
+	// Splits triangle lists into meshlets, meant to run once when a mesh is
+	// imported or baked, after MeshOptimizer.
+	class MeshletBuilder {
+	public:
+		// Same limits as the usual mesh shader meshlets, so the data can feed them later
+		static const uint32_t maxVertices = 64;
+		static const uint32_t maxTriangles = 124;
+
+		// Reorders the triangles so each meshlet is a contiguous index range (firstIndex
+		// is relative to indices). Triangles are counter-clockwise when front facing.
+		static std::vector<ktw::Meshlet> build(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexSize, size_t positionOffset, uint32_t positionComponents = 3);
+		static void computeBounds(ktw::Meshlet& meshlet, const uint32_t* indices, const void* vertices, size_t vertexSize, size_t positionOffset, uint32_t positionComponents = 3);
+	};
+}
@@ -0,0 +1,42 @@
+#include "pch.hpp"
+#include "MeshletCuller.hpp"
+#include "DescriptorSet.hpp"
+#include "FrustumCuller.hpp"
+
+#include <ktwVulkanGameEngine/EmbeddedShaders.hpp>
+
+namespace ktw {
+	namespace {
+		const uint32_t workgroupSize = 64;
+	}
+
+	MeshletCuller::MeshletCuller(ktw::Context& context, ktw::LayoutCache& layoutCache, ktw::DescriptorSetCache& descriptorSetCache) :
+		descriptorSetCache(descriptorSetCache),
+		pipeline(context, layoutCache, ktw::ShaderSource(ktw::shaders::meshlet_cull_comp, ktw::shaders::meshlet_cull_comp_source))
+	{
+		static_assert(sizeof(Culling) == 112, "Culling must match the push constants of meshlet_cull.comp");
+	}
+
+	void MeshletCuller::cull(ktw::CommandBuffer& commandBuffer, ktw::Mesh* mesh, const glm::mat4& model, const glm::mat4& viewProjection, const glm::vec3& cameraPosition) {
+		if(mesh->getMeshletCount() == 0) {
+			throw std::runtime_error("mesh has no meshlets, convert it with MeshConverter");
+		}
+
+		// The test runs in object space, so the bounds are used as stored
+		Culling culling;
+		ktw::Frustum frustum(viewProjection * model);
+		std::copy(std::begin(frustum.planes), std::end(frustum.planes), culling.planes);
+		culling.cameraPosition = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+		culling.meshletCount = mesh->getMeshletCount();
+
+		auto descriptorSet = ktw::DescriptorSet(pipeline.getDescriptorSetLayouts()[0])
+			.bindBuffer(0, *mesh->getMeshletBuffer(), vk::DescriptorType::eStorageBuffer)
+			.bindBuffer(1, *mesh->getDrawCommandBuffer(), vk::DescriptorType::eStorageBuffer);
+
+		commandBuffer
+			.bindPipeline(&pipeline)
+			.bindDescriptorSet(&pipeline, 0, descriptorSetCache.getDescriptorSet(descriptorSet))
+			.pushConstants(&pipeline, &culling, sizeof(culling))
+			.dispatch((culling.meshletCount + workgroupSize - 1) / workgroupSize);
+	}
+}
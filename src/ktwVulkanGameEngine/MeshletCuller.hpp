@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Context.hpp"
+#include "ComputePipeline.hpp"
+#include "DescriptorSetCache.hpp"
+#include "CommandBuffer.hpp"
+#include "Mesh.hpp"
+
+namespace ktw {
+	// GPU meshlet culling. A compute pass tests every meshlet of a mesh against
+	// the view frustum and its normal cone and fills the mesh's indirect draw
+	// buffer, which CommandBuffer::drawMeshlets then draws. Meshes are culled
+	// at most once per frame (the draw buffer is the mesh's), before the first
+	// draw of the command buffer.
+	class MeshletCuller {
+	public:
+		MeshletCuller(ktw::Context& context, ktw::LayoutCache& layoutCache, ktw::DescriptorSetCache& descriptorSetCache);
+		void cull(ktw::CommandBuffer& commandBuffer, ktw::Mesh* mesh, const glm::mat4& model, const glm::mat4& viewProjection, const glm::vec3& cameraPosition);
+
+	private:
+		// Matches the push constant block of meshlet_cull.comp
+		struct Culling {
+			glm::vec4 planes[6];
+			glm::vec3 cameraPosition;
+			uint32_t meshletCount;
+		};
+
+		ktw::DescriptorSetCache& descriptorSetCache;
+		ktw::ComputePipeline pipeline;
+	};
+}
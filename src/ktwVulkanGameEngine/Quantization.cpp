@@ -0,0 +1,139 @@
+#include "pch.hpp"
+#include "Quantization.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace ktw {
+	uint16_t packHalf(float value) {
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+		uint32_t exponent = (bits >> 23) & 0xFF;
+		uint32_t mantissa = bits & 0x7FFFFF;
+
+		if(exponent == 0xFF) {
+			// Infinity stays infinity, NaN keeps a mantissa bit
+			return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+		}
+
+		int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+		if(halfExponent >= 0x1F) {
+			return sign | 0x7C00;
+		}
+		if(halfExponent <= 0) {
+			if(halfExponent < -10) {
+				return sign;
+			}
+			// Denormal, the implicit leading bit becomes explicit
+			mantissa |= 0x800000;
+			uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+			uint32_t halfMantissa = mantissa >> shift;
+			uint32_t remainder = mantissa & ((1u << shift) - 1);
+			uint32_t halfway = 1u << (shift - 1);
+			if(remainder > halfway || (remainder == halfway && (halfMantissa & 1))) {
+				halfMantissa++;
+			}
+			return sign | static_cast<uint16_t>(halfMantissa);
+		}
+
+		// Round to nearest even, a carry into the exponent is still the right result
+		uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+		uint32_t remainder = mantissa & 0x1FFF;
+		if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+			half++;
+		}
+		return sign | static_cast<uint16_t>(half);
+	}
+
+	float unpackHalf(uint16_t value) {
+		uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+		uint32_t exponent = (value >> 10) & 0x1F;
+		uint32_t mantissa = value & 0x3FF;
+
+		uint32_t bits;
+		if(exponent == 0x1F) {
+			bits = sign | 0x7F800000 | (mantissa << 13);
+		}
+		else if(exponent != 0) {
+			bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+		}
+		else if(mantissa != 0) {
+			// Denormal, normalized for the float representation
+			exponent = 127 - 15 + 1;
+			while(!(mantissa & 0x400)) {
+				mantissa <<= 1;
+				exponent--;
+			}
+			bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+		}
+		else {
+			bits = sign;
+		}
+
+		float result;
+		memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	uint8_t packUNorm8(float value) {
+		return static_cast<uint8_t>(std::lround(glm::clamp(value, 0.0f, 1.0f) * 255.0f));
+	}
+
+	int8_t packSNorm8(float value) {
+		return static_cast<int8_t>(std::lround(glm::clamp(value, -1.0f, 1.0f) * 127.0f));
+	}
+
+	uint16_t packUNorm16(float value) {
+		return static_cast<uint16_t>(std::lround(glm::clamp(value, 0.0f, 1.0f) * 65535.0f));
+	}
+
+	int16_t packSNorm16(float value) {
+		return static_cast<int16_t>(std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	uint32_t packColor(const glm::vec3& color) {
+		return packColor(glm::vec4(color, 1.0f));
+	}
+
+	uint32_t packColor(const glm::vec4& color) {
+		// R in the lowest byte, the order of R8G8B8A8 in memory
+		return static_cast<uint32_t>(packUNorm8(color.r))
+			| static_cast<uint32_t>(packUNorm8(color.g)) << 8
+			| static_cast<uint32_t>(packUNorm8(color.b)) << 16
+			| static_cast<uint32_t>(packUNorm8(color.a)) << 24;
+	}
+
+	uint32_t packNormal(const glm::vec3& normal, float w) {
+		auto snorm10 = [](float value) {
+			return static_cast<uint32_t>(std::lround(glm::clamp(value, -1.0f, 1.0f) * 511.0f)) & 0x3FF;
+		};
+		uint32_t snorm2 = static_cast<uint32_t>(std::lround(glm::clamp(w, -1.0f, 1.0f))) & 0x3;
+
+		// A2B10G10R10 puts x in the lowest bits
+		return snorm10(normal.x) | snorm10(normal.y) << 10 | snorm10(normal.z) << 20 | snorm2 << 30;
+	}
+
+	std::array<uint16_t, 2> packUV(const glm::vec2& uv) {
+		return {packHalf(uv.x), packHalf(uv.y)};
+	}
+
+	std::array<uint16_t, 4> packPosition(const glm::vec3& position) {
+		return {packHalf(position.x), packHalf(position.y), packHalf(position.z), packHalf(1.0f)};
+	}
+
+	ktw::PositionQuantization PositionQuantization::fromBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+		ktw::PositionQuantization quantization;
+		quantization.offset = boundsMin;
+		// A flat axis keeps a non-zero scale so packing does not divide by zero
+		quantization.scale = glm::max(boundsMax - boundsMin, glm::vec3(std::numeric_limits<float>::min()));
+		return quantization;
+	}
+
+	std::array<uint16_t, 4> PositionQuantization::pack(const glm::vec3& position) const {
+		glm::vec3 normalized = (position - offset) / scale;
+		return {packUNorm16(normalized.x), packUNorm16(normalized.y), packUNorm16(normalized.z), packUNorm16(1.0f)};
+	}
+}
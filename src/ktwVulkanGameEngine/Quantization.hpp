@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+
+// Packing helpers for the compact ktw::Format vertex formats. Every packed
+// value has the memory layout the matching format expects, so it can be
+// stored as is in a vertex struct.
+namespace ktw {
+	uint16_t packHalf(float value);
+	float unpackHalf(uint16_t value);
+	uint8_t packUNorm8(float value);
+	int8_t packSNorm8(float value);
+	uint16_t packUNorm16(float value);
+	int16_t packSNorm16(float value);
+
+	// ktw::Format::eUByte4Norm, 4 bytes instead of 12 or 16
+	uint32_t packColor(const glm::vec3& color);
+	uint32_t packColor(const glm::vec4& color);
+	// ktw::Format::eInt1010102Norm, for unit vectors (normals, tangents with the sign in w)
+	uint32_t packNormal(const glm::vec3& normal, float w = 0.0f);
+	// ktw::Format::eHalf2
+	std::array<uint16_t, 2> packUV(const glm::vec2& uv);
+	// ktw::Format::eHalf4, w is 1 so the shader can read a vec4 position
+	std::array<uint16_t, 4> packPosition(const glm::vec3& position);
+
+	// ktw::Format::eUShort4Norm positions relative to the mesh bounds. The
+	// shader gets them back with position * scale + offset, both passed as
+	// uniforms or push constants.
+	struct PositionQuantization {
+		glm::vec3 offset;
+		glm::vec3 scale;
+
+		static ktw::PositionQuantization fromBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+		std::array<uint16_t, 4> pack(const glm::vec3& position) const;
+	};
+}
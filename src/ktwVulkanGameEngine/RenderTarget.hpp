@@ -9,6 +9,10 @@ namespace ktw {
 		virtual uint32_t getWidth() = 0;
 		virtual uint32_t getHeight() = 0;
 		virtual ktw::FrameBuffer& getFrameBuffer() = 0;
+		// Null when the target is drawn with dynamic rendering
 		virtual vk::RenderPass getRenderPass() = 0;
+		virtual vk::Format getColorFormat() = 0;
+		// vk::Format::eUndefined when the target has no depth attachment
+		virtual vk::Format getDepthFormat() = 0;
 	};
 }
\ No newline at end of file
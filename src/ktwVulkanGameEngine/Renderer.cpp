@@ -2,10 +2,21 @@
 #include "Renderer.hpp"
 
 namespace ktw {
-	Renderer::Renderer(ktw::Context& context) :
+	Renderer::Renderer(ktw::Context& context, ktw::JobSystem& jobSystem) :
 		context(context),
+		jobSystem(jobSystem),
 		commandPool(context),
-		descriptorPool(context, 2, 2, 2)
+		descriptorPool(context, 64, {
+			{vk::DescriptorType::eUniformBuffer, 128},
+			{vk::DescriptorType::eStorageBuffer, 32},
+			{vk::DescriptorType::eCombinedImageSampler, 128}
+		}),
+		descriptorSetCache(context, 256, {
+			{vk::DescriptorType::eUniformBuffer, 512},
+			{vk::DescriptorType::eStorageBuffer, 128},
+			{vk::DescriptorType::eCombinedImageSampler, 512}
+		}),
+		layoutCache(context)
 	{
 		auto fenceInfo = vk::FenceCreateInfo();
 		renderFinishedFence = context.getDevice().createFenceUnique(fenceInfo);
@@ -13,8 +24,75 @@ namespace ktw {
 		LOG_TRACE("Renderer Created");
 	}
 	
-	ktw::GraphicsPipeline* Renderer::createGraphicsPipeline(ktw::RenderTarget* renderTarget, std::string vertexShader, std::string fragmentShader, const std::vector<ktw::VertexBufferBinding>& vertexBufferBindings, const std::vector<ktw::UniformDescriptor>& uniformDescriptors) {
-		return new ktw::GraphicsPipeline(context, *renderTarget, vertexShader, fragmentShader, vertexBufferBindings, uniformDescriptors);
+	ktw::GraphicsPipeline* Renderer::createGraphicsPipeline(ktw::RenderTarget* renderTarget, const ktw::ShaderSource& vertexShader, const ktw::ShaderSource& fragmentShader, const ktw::SpecializationConstants& specializationConstants, ktw::DepthMode depthMode) {
+		// Vertex input and layouts are all derived from the shaders
+		return createGraphicsPipeline(renderTarget, vertexShader, fragmentShader, {}, {}, specializationConstants, depthMode);
+	}
+
+	ktw::GraphicsPipeline* Renderer::createGraphicsPipeline(ktw::RenderTarget* renderTarget, const ktw::ShaderSource& vertexShader, const ktw::ShaderSource& fragmentShader, const std::vector<ktw::VertexBufferBinding>& vertexBufferBindings, const std::vector<ktw::UniformDescriptor>& uniformDescriptors, const ktw::SpecializationConstants& specializationConstants, ktw::DepthMode depthMode) {
+		return new ktw::GraphicsPipeline(context, layoutCache, *renderTarget, vertexShader, fragmentShader, vertexBufferBindings, uniformDescriptors, specializationConstants, depthMode, shaderWatcher.get());
+	}
+
+	void Renderer::enableShaderHotReload() {
+		if(!shaderWatcher) {
+			shaderWatcher = std::make_unique<ktw::ShaderWatcher>(jobSystem);
+		}
+	}
+
+	ktw::BindlessHeap& Renderer::enableBindless(uint32_t maxStorageBuffers, uint32_t maxCombinedImageSamplers) {
+		// Pipelines pick the bindless layout for their set 0 at creation, so this comes first
+		if(!bindlessHeap) {
+			bindlessHeap = std::make_unique<ktw::BindlessHeap>(context, layoutCache, maxStorageBuffers, maxCombinedImageSamplers);
+		}
+		return *bindlessHeap;
+	}
+
+	ktw::BindlessHeap& Renderer::getBindlessHeap() {
+		if(!bindlessHeap) {
+			throw std::runtime_error("Bindless mode not enabled");
+		}
+		return *bindlessHeap;
+	}
+
+	ktw::TextureStreamer& Renderer::enableTextureStreaming(vk::DeviceSize budget) {
+		if(!textureStreamer) {
+			textureStreamer = std::make_unique<ktw::TextureStreamer>(context, commandPool, budget);
+		}
+		return *textureStreamer;
+	}
+
+	ktw::TextureStreamer& Renderer::getTextureStreamer() {
+		if(!textureStreamer) {
+			throw std::runtime_error("Texture streaming not enabled");
+		}
+		return *textureStreamer;
+	}
+
+	ktw::MeshletCuller& Renderer::getMeshletCuller() {
+		// Created on first use, its pipeline is only needed by scenes drawing meshlets
+		if(!meshletCuller) {
+			meshletCuller = std::make_unique<ktw::MeshletCuller>(context, layoutCache, descriptorSetCache);
+		}
+		return *meshletCuller;
+	}
+
+	ktw::DynamicBuffer* Renderer::createDynamicBuffer(uint32_t itemSize, ktw::BufferUsage usage, uint32_t initialCapacity) {
+		return new ktw::DynamicBuffer(context, itemSize, usage, initialCapacity);
+	}
+
+	ktw::GeometryArena& Renderer::enableGeometryArena(vk::DeviceSize vertexPoolSize, uint32_t indexPoolCount) {
+		// Only meshes created afterwards are sub-allocated from it
+		if(!geometryArena) {
+			geometryArena = std::make_unique<ktw::GeometryArena>(context, vertexPoolSize, indexPoolCount);
+		}
+		return *geometryArena;
+	}
+
+	ktw::GeometryArena& Renderer::getGeometryArena() {
+		if(!geometryArena) {
+			throw std::runtime_error("Geometry arena not enabled");
+		}
+		return *geometryArena;
 	}
 
 	ktw::Buffer* Renderer::createBuffer(uint32_t itemSize, size_t count, ktw::BufferUsage usage, void* data) {
@@ -26,6 +104,14 @@ namespace ktw {
 	}
 
 	void Renderer::startFrame(ktw::FrameBuffer& frameBuffer) {
+		// The previous frame has been waited on, so replaced pipelines are no longer in use
+		if(shaderWatcher) {
+			shaderWatcher->applyReloads();
+		}
+		// Mips requested during the previous frame are uploaded before anything is recorded
+		if(textureStreamer) {
+			textureStreamer->update();
+		}
 		renderingFrameBuffer = &frameBuffer;
 	}
 
@@ -44,6 +130,16 @@ namespace ktw {
 
 	void Renderer::waitEndOfRender() {
 		auto result = context.getDevice().waitForFences(1, &(*renderFinishedFence), true, UINT64_MAX);
+		if(renderingFrameBuffer) {
+			descriptorPool.freeDescriptorPools(*renderingFrameBuffer);
+		}
+		if(textureStreamer) {
+			textureStreamer->recycle();
+		}
+		descriptorSetCache.recycle();
+		if(bindlessHeap) {
+			bindlessHeap->recycle();
+		}
 		renderingFrameBuffer = nullptr;
 		for(auto buffer: postedCommandBuffers) {
 			commandPool.freeCommandBuffer(buffer);
@@ -56,7 +152,60 @@ namespace ktw {
 	}
 
 	ktw::Buffer* Renderer::createIndexBuffer(size_t count, void* data) {
-		return createBuffer(sizeof(uint32_t), count, ktw::BufferUsage::eIndexBuffer, data);
+		// 32-bit indices in, stored as 16-bit when the vertex count allows it
+		return new ktw::Buffer(context, static_cast<const uint32_t*>(data), static_cast<uint32_t>(count));
+	}
+
+	ktw::Mesh* Renderer::createMesh(const ktw::VertexBufferBinding& vertexBufferBinding, const void* vertices, size_t vertexCount, const std::vector<uint32_t>& indices) {
+		return new ktw::Mesh(context, vertexBufferBinding, vertices, static_cast<uint32_t>(vertexCount), indices.data(), static_cast<uint32_t>(indices.size()), {}, geometryArena.get());
+	}
+
+	ktw::Mesh* Renderer::loadMesh(const std::string& filename) {
+		return new ktw::Mesh(context, filename, geometryArena.get());
+	}
+
+	std::vector<ktw::Mesh*> Renderer::loadMeshes(const std::vector<std::string>& filenames) {
+		// Each mesh maps its file and fills its own buffers (or disjoint ranges of the arena's)
+		std::vector<std::unique_ptr<ktw::Mesh>> meshes(filenames.size());
+		jobSystem.parallelFor(static_cast<uint32_t>(filenames.size()), 1, [&](uint32_t begin, uint32_t end) {
+			for(uint32_t i = begin; i < end; i++) {
+				meshes[i] = std::make_unique<ktw::Mesh>(context, filenames[i], geometryArena.get());
+			}
+		});
+
+		std::vector<ktw::Mesh*> result;
+		for(auto& mesh : meshes) {
+			result.push_back(mesh.release());
+		}
+		return result;
+	}
+
+	ktw::Texture* Renderer::createTexture(uint32_t width, uint32_t height, vk::Format format, const void* pixels, size_t size, bool generateMipmaps) {
+		return new ktw::Texture(context, commandPool, width, height, format, pixels, size, generateMipmaps);
+	}
+
+	ktw::Texture* Renderer::loadTexture(const std::string& filename) {
+		// The levels are copied straight from the mapping to the staging buffer
+		ktw::Ktx2File file(filename);
+		return new ktw::Texture(context, commandPool, file.getWidth(), file.getHeight(), file.getFormat(), file.getLevels());
+	}
+
+	void Renderer::setDescriptorPoolSizes(uint32_t maxSets, const std::vector<vk::DescriptorPoolSize>& poolSizes) {
+		descriptorPool.setPoolSizes(maxSets, poolSizes);
+	}
+
+	vk::DescriptorSet Renderer::allocateDescriptorSet(vk::DescriptorSetLayout layout) {
+		if(!renderingFrameBuffer) {
+			throw std::runtime_error("Frame not started");
+		}
+
+		// Only valid for the current frame, recycled once it has been rendered
+		return descriptorPool.getDescriptorSet(*renderingFrameBuffer, layout);
+	}
+
+	vk::DescriptorSet Renderer::getDescriptorSet(const ktw::DescriptorSet& descriptorSet) {
+		// Written once and kept across frames, until one of its resources is destroyed
+		return descriptorSetCache.getDescriptorSet(descriptorSet);
 	}
 
 	ktw::CommandBuffer Renderer::startCommandBuffer() {
@@ -68,7 +217,15 @@ namespace ktw {
 
 		postedCommandBuffers.push_back(commandBuffer);
 
-		return ktw::CommandBuffer(*renderingFrameBuffer, commandBuffer);
+		ktw::CommandBuffer result(context, *renderingFrameBuffer, commandBuffer);
+		if(bindlessHeap) {
+			// Every pipeline shares this set 0, it stays bound across pipeline switches
+			result.bindDescriptorSet(bindlessHeap->getPipelineLayout(), 0, bindlessHeap->getDescriptorSet());
+		}
+		return result;
 	}
 
+	ktw::JobSystem& Renderer::getJobSystem() {
+		return jobSystem;
+	}
 }
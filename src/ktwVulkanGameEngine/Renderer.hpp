@@ -7,35 +7,73 @@
 
 #include "GraphicsPipeline.hpp"
 #include "Buffer.hpp"
+#include "DynamicBuffer.hpp"
 #include "CommandPool.hpp"
 #include "Context.hpp"
 #include "FrameBuffer.hpp"
 #include "DescriptorPool.hpp"
+#include "DescriptorSetCache.hpp"
 #include "CommandBuffer.hpp"
+#include "ShaderWatcher.hpp"
+#include "BindlessHeap.hpp"
+#include "Texture.hpp"
+#include "Ktx2File.hpp"
+#include "TextureStreamer.hpp"
+#include "Mesh.hpp"
+#include "GeometryArena.hpp"
+#include "JobSystem.hpp"
+#include "MeshletCuller.hpp"
 
 namespace ktw {
 	class Renderer {
 	public:
-		Renderer(ktw::Context& context);
+		Renderer(ktw::Context& context, ktw::JobSystem& jobSystem);
 
-		ktw::GraphicsPipeline* createGraphicsPipeline(ktw::RenderTarget* renderTarget, std::string vertexShader, std::string fragmentShader, const std::vector<ktw::VertexBufferBinding>& vertexBufferBindings, const std::vector<ktw::UniformDescriptor>& uniformDescriptors);
+		ktw::GraphicsPipeline* createGraphicsPipeline(ktw::RenderTarget* renderTarget, const ktw::ShaderSource& vertexShader, const ktw::ShaderSource& fragmentShader, const ktw::SpecializationConstants& specializationConstants = ktw::SpecializationConstants(), ktw::DepthMode depthMode = ktw::DepthMode::eReadWrite);
+		ktw::GraphicsPipeline* createGraphicsPipeline(ktw::RenderTarget* renderTarget, const ktw::ShaderSource& vertexShader, const ktw::ShaderSource& fragmentShader, const std::vector<ktw::VertexBufferBinding>& vertexBufferBindings, const std::vector<ktw::UniformDescriptor>& uniformDescriptors, const ktw::SpecializationConstants& specializationConstants = ktw::SpecializationConstants(), ktw::DepthMode depthMode = ktw::DepthMode::eReadWrite);
 		ktw::Buffer* createBuffer(uint32_t itemSize, size_t count, ktw::BufferUsage usage, void* data);
 		ktw::Buffer* createVertexBuffer(uint32_t itemSize, size_t count, void* data);
 		ktw::Buffer* createIndexBuffer(size_t count, void* data);
+		ktw::DynamicBuffer* createDynamicBuffer(uint32_t itemSize, ktw::BufferUsage usage, uint32_t initialCapacity = 1024);
+		ktw::Texture* createTexture(uint32_t width, uint32_t height, vk::Format format, const void* pixels, size_t size, bool generateMipmaps = true);
+		ktw::Texture* loadTexture(const std::string& filename);
+		ktw::Mesh* createMesh(const ktw::VertexBufferBinding& vertexBufferBinding, const void* vertices, size_t vertexCount, const std::vector<uint32_t>& indices);
+		ktw::Mesh* loadMesh(const std::string& filename);
+		// Loaded in parallel on the job system, in the order of the filenames
+		std::vector<ktw::Mesh*> loadMeshes(const std::vector<std::string>& filenames);
 		//ktw::UniformBuffer* createUniformBuffer(uint32_t size);
 		void waitDeviceIdle();
 		void startFrame(ktw::FrameBuffer& frameBuffer);
 		void endFrame();
 		void waitEndOfRender();
-		void setDescriptorPoolSize(uint32_t size);
+		void setDescriptorPoolSizes(uint32_t maxSets, const std::vector<vk::DescriptorPoolSize>& poolSizes);
+		vk::DescriptorSet allocateDescriptorSet(vk::DescriptorSetLayout layout);
+		vk::DescriptorSet getDescriptorSet(const ktw::DescriptorSet& descriptorSet);
+		void enableShaderHotReload();
+		ktw::BindlessHeap& enableBindless(uint32_t maxStorageBuffers = 16384, uint32_t maxCombinedImageSamplers = 16384);
+		ktw::BindlessHeap& getBindlessHeap();
+		ktw::TextureStreamer& enableTextureStreaming(vk::DeviceSize budget = 0);
+		ktw::TextureStreamer& getTextureStreamer();
+		ktw::MeshletCuller& getMeshletCuller();
+		ktw::GeometryArena& enableGeometryArena(vk::DeviceSize vertexPoolSize = 64 << 20, uint32_t indexPoolCount = 8 << 20);
+		ktw::GeometryArena& getGeometryArena();
 		ktw::CommandBuffer startCommandBuffer();
+		ktw::JobSystem& getJobSystem();
 
 	private:
 		ktw::Context& context;
+		ktw::JobSystem& jobSystem;
 		std::vector<vk::CommandBuffer> postedCommandBuffers;
 		ktw::FrameBuffer* renderingFrameBuffer = nullptr;
 		ktw::CommandPool commandPool;
 		ktw::DescriptorPool descriptorPool;
+		ktw::DescriptorSetCache descriptorSetCache;
+		ktw::LayoutCache layoutCache;
+		std::unique_ptr<ktw::BindlessHeap> bindlessHeap;
+		std::unique_ptr<ktw::TextureStreamer> textureStreamer;
+		std::unique_ptr<ktw::MeshletCuller> meshletCuller;
+		std::unique_ptr<ktw::GeometryArena> geometryArena;
 		vk::UniqueFence renderFinishedFence;
+		std::unique_ptr<ktw::ShaderWatcher> shaderWatcher;
 	};
 }
\ No newline at end of file
@@ -1,17 +1,53 @@
 #include "pch.hpp"
 #include "Shader.hpp"
-#include "ShaderCompiler.hpp"
+
+#ifdef KTW_RUNTIME_SHADERS
+	#include "ShaderCompiler.hpp"
+#endif
 
 namespace ktw {
-	Shader::Shader(ktw::Context& context, const std::string& filename) {
-		createShaderModule(context, CompileGLSL(filename));
-		LOG_TRACE("Shader {} created", filename);
+	Shader::Shader(ktw::Context& context, const ktw::ShaderSource& source) : filename(source.filename), compiledFromGLSL(false) {
+#ifdef KTW_RUNTIME_SHADERS
+		if(!filename.empty()) {
+			std::vector<uint32_t> code = CompileGLSL(filename, &includedFiles);
+			createShaderModule(context, code.data(), code.size() * sizeof(uint32_t));
+			reflection.emplace(code.data(), code.size() * sizeof(uint32_t));
+			compiledFromGLSL = true;
+			LOG_TRACE("Shader {} created", filename);
+			return;
+		}
+#endif
+		if(!source.code) {
+			throw std::runtime_error("no embedded SPIR-V for shader " + filename + " (build with KTW_RUNTIME_SHADERS to compile GLSL at runtime)");
+		}
+
+		createShaderModule(context, source.code, source.codeSize);
+		reflection.emplace(source.code, source.codeSize);
+		LOG_TRACE("Shader {} created from embedded SPIR-V", filename);
 	}
 
 	vk::UniqueShaderModule& Shader::getModule() {
 		return module;
 	}
 
+	const std::string& Shader::getFilename() {
+		return filename;
+	}
+
+	std::vector<std::string> Shader::getFiles() {
+		if(!compiledFromGLSL) {
+			return {};
+		}
+
+		std::vector<std::string> files = {filename};
+		files.insert(files.end(), includedFiles.begin(), includedFiles.end());
+		return files;
+	}
+
+	ktw::ShaderReflection& Shader::getReflection() {
+		return *reflection;
+	}
+
 	std::vector<char> Shader::readFile(const std::string& filename) {
 		std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
@@ -30,10 +66,10 @@ namespace ktw {
 		return buffer;
 	}
 
-	void Shader::createShaderModule(ktw::Context& context, const std::vector<uint32_t>& code) {
+	void Shader::createShaderModule(ktw::Context& context, const uint32_t* code, size_t codeSize) {
 		auto createInfo = vk::ShaderModuleCreateInfo()
-			.setCodeSize(code.size() * sizeof(uint32_t))
-			.setPCode(code.data());
+			.setCodeSize(codeSize)
+			.setPCode(code);
 
 		module = context.getDevice().createShaderModuleUnique(createInfo);
 	}
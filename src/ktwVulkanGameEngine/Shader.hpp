@@ -1,17 +1,40 @@
 #pragma once
 
 #include "Context.hpp"
+#include "ShaderReflection.hpp"
 
 namespace ktw {
+	// Where a shader stage comes from: SPIR-V embedded at build time (see
+	// EmbeddedShaders.hpp) and/or a GLSL file. The GLSL file is only compiled
+	// when the engine is built with KTW_RUNTIME_SHADERS (dev mode).
+	struct ShaderSource {
+		std::string filename;
+		const uint32_t* code = nullptr;
+		size_t codeSize = 0;
+
+		ShaderSource(const std::string& filename) : filename(filename) {}
+		ShaderSource(const char* filename) : filename(filename) {}
+
+		template<size_t N>
+		ShaderSource(const uint32_t (&code)[N], const std::string& filename = "") : filename(filename), code(code), codeSize(N * sizeof(uint32_t)) {}
+	};
+
 	class Shader {
 	public:
-		Shader(ktw::Context& context, const std::string& filename);
+		Shader(ktw::Context& context, const ktw::ShaderSource& source);
 		vk::UniqueShaderModule& getModule();
+		const std::string& getFilename();
+		std::vector<std::string> getFiles();
+		ktw::ShaderReflection& getReflection();
 
 	private:
 		vk::UniqueShaderModule module;
+		std::string filename;
+		std::vector<std::string> includedFiles;
+		bool compiledFromGLSL;
+		std::optional<ktw::ShaderReflection> reflection;
 
 		static std::vector<char> readFile(const std::string& filename);
-		void createShaderModule(ktw::Context& context, const std::vector<uint32_t>& code);
+		void createShaderModule(ktw::Context& context, const uint32_t* code, size_t codeSize);
 	};
 }
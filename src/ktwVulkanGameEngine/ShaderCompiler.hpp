@@ -157,17 +157,49 @@ const TBuiltInResource DefaultTBuiltInResource = {
 };
 
 static bool glslangInitialized = false;
+static std::mutex glslangInitializationMutex;
 
-//TODO: Multithread, manage SpirV that doesn't need recompiling (only recompile when dirty)
-const std::vector<uint32_t> CompileGLSL(const std::string& filename)
+// Remembers every file pulled in through #include so the caller can watch them
+class RecordingFileIncluder : public DirStackFileIncluder
+{
+public:
+	RecordingFileIncluder(std::vector<std::string>* includedFiles) : includedFiles(includedFiles) {}
+
+	IncludeResult* includeLocal(const char* headerName, const char* includerName, size_t inclusionDepth) override
+	{
+		return record(DirStackFileIncluder::includeLocal(headerName, includerName, inclusionDepth));
+	}
+
+	IncludeResult* includeSystem(const char* headerName, const char* includerName, size_t inclusionDepth) override
+	{
+		return record(DirStackFileIncluder::includeSystem(headerName, includerName, inclusionDepth));
+	}
+
+private:
+	std::vector<std::string>* includedFiles;
+
+	IncludeResult* record(IncludeResult* result)
+	{
+		if (result && includedFiles && std::find(includedFiles->begin(), includedFiles->end(), result->headerName) == includedFiles->end())
+		{
+			includedFiles->push_back(result->headerName);
+		}
+		return result;
+	}
+};
+
+//TODO: manage SpirV that doesn't need recompiling (only recompile when dirty)
+const std::vector<uint32_t> CompileGLSL(const std::string& filename, std::vector<std::string>* includedFiles = nullptr)
 {
 	LOG_INFO("Compiling {}", filename);
-	//TODO: Handle initialization / finalization once
 	// from source: "ShInitialize() should be called exactly once per process, not per thread."
-	if (!glslangInitialized)
 	{
-		glslang::InitializeProcess();
-		glslangInitialized = true;
+		std::lock_guard<std::mutex> lock(glslangInitializationMutex);
+		if (!glslangInitialized)
+		{
+			glslang::InitializeProcess();
+			glslangInitialized = true;
+		}
 	}
 
 	//Load GLSL into a string
@@ -203,7 +235,7 @@ const std::vector<uint32_t> CompileGLSL(const std::string& filename)
 
 	const int DefaultVersion = 100;
 
-	DirStackFileIncluder Includer;
+	RecordingFileIncluder Includer(includedFiles);
 	
 	//Get Path of File
 	std::string Path = GetFilePath(filename);
@@ -214,6 +246,7 @@ const std::vector<uint32_t> CompileGLSL(const std::string& filename)
 	if (!Shader.preprocess(&Resources, DefaultVersion, ENoProfile, false, false, messages, &PreprocessedGLSL, Includer)) 
 	{
 		LOG_ERROR("GLSL Preprocessing Failed for: {}\n{}\n{}", filename, Shader.getInfoLog(), Shader.getInfoDebugLog());
+		throw std::runtime_error("failed to preprocess shader: " + filename);
 	}
 
 	//std::cout << PreprocessedGLSL << std::endl;
@@ -224,6 +257,7 @@ const std::vector<uint32_t> CompileGLSL(const std::string& filename)
 	if (!Shader.parse(&Resources, 100, false, messages))
 	{
 		LOG_ERROR("GLSL Parsing Failed for: {}\n{}\n{}", filename, Shader.getInfoLog(), Shader.getInfoDebugLog());
+		throw std::runtime_error("failed to parse shader: " + filename);
 	}
 
 	glslang::TProgram Program;
@@ -232,6 +266,7 @@ const std::vector<uint32_t> CompileGLSL(const std::string& filename)
 	if(!Program.link(messages))
 	{
 		LOG_ERROR("GLSL Linking Failed for: {}\n{}\n{}", filename, Shader.getInfoLog(), Shader.getInfoDebugLog());
+		throw std::runtime_error("failed to link shader: " + filename);
 	}
 
 	std::vector<uint32_t> SpirV;
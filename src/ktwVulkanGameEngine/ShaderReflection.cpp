@@ -0,0 +1,357 @@
+#include "pch.hpp"
+#include "ShaderReflection.hpp"
+
+namespace {
+	// Subset of the SPIR-V specification needed to read a module's interface
+	const uint32_t SpirVMagicNumber = 0x07230203;
+
+	enum SpirVOp {
+		OpEntryPoint = 15,
+		OpTypeBool = 20,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpSpecConstant = 50,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72
+	};
+
+	enum SpirVDecoration {
+		DecorationBlock = 2,
+		DecorationBufferBlock = 3,
+		DecorationArrayStride = 6,
+		DecorationMatrixStride = 7,
+		DecorationBuiltIn = 11,
+		DecorationLocation = 30,
+		DecorationBinding = 33,
+		DecorationDescriptorSet = 34,
+		DecorationOffset = 35
+	};
+
+	enum SpirVStorageClass {
+		StorageClassUniformConstant = 0,
+		StorageClassInput = 1,
+		StorageClassUniform = 2,
+		StorageClassPushConstant = 9,
+		StorageClassStorageBuffer = 12
+	};
+
+	enum SpirVDim {
+		DimBuffer = 5,
+		DimSubpassData = 6
+	};
+
+	vk::ShaderStageFlagBits getStageFromExecutionModel(uint32_t executionModel) {
+		switch(executionModel) {
+			case 0: return vk::ShaderStageFlagBits::eVertex;
+			case 1: return vk::ShaderStageFlagBits::eTessellationControl;
+			case 2: return vk::ShaderStageFlagBits::eTessellationEvaluation;
+			case 3: return vk::ShaderStageFlagBits::eGeometry;
+			case 4: return vk::ShaderStageFlagBits::eFragment;
+			case 5: return vk::ShaderStageFlagBits::eCompute;
+			default: throw std::runtime_error("unsupported SPIR-V execution model");
+		}
+	}
+}
+
+namespace ktw {
+	ShaderReflection::ShaderReflection(const uint32_t* code, size_t codeSize) : pushConstantSize(0) {
+		std::vector<Variable> variables;
+		parse(code, codeSize / sizeof(uint32_t), variables);
+
+		for(auto& variable : variables) {
+			switch(variable.storageClass) {
+				case StorageClassUniformConstant:
+				case StorageClassUniform:
+				case StorageClassStorageBuffer:
+					reflectDescriptor(variable);
+					break;
+				case StorageClassInput:
+					if(stage == vk::ShaderStageFlagBits::eVertex) {
+						reflectInput(variable);
+					}
+					break;
+				case StorageClassPushConstant:
+					pushConstantSize = std::max(pushConstantSize, getTypeSize(types[variable.pointerType].operands[1]));
+					break;
+			}
+		}
+
+		std::sort(descriptorBindings.begin(), descriptorBindings.end(), [](const ktw::ReflectedDescriptorBinding& a, const ktw::ReflectedDescriptorBinding& b) {
+			return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+		});
+		std::sort(inputAttributes.begin(), inputAttributes.end(), [](const ktw::ReflectedInputAttribute& a, const ktw::ReflectedInputAttribute& b) {
+			return a.location < b.location;
+		});
+
+		// The parsed module is only needed while reflecting
+		types.clear();
+		constants.clear();
+		decorations.clear();
+		memberDecorations.clear();
+	}
+
+	vk::ShaderStageFlagBits ShaderReflection::getStage() {
+		return stage;
+	}
+
+	const std::vector<ktw::ReflectedDescriptorBinding>& ShaderReflection::getDescriptorBindings() {
+		return descriptorBindings;
+	}
+
+	const std::vector<ktw::ReflectedInputAttribute>& ShaderReflection::getInputAttributes() {
+		return inputAttributes;
+	}
+
+	uint32_t ShaderReflection::getPushConstantSize() {
+		return pushConstantSize;
+	}
+
+	void ShaderReflection::parse(const uint32_t* code, size_t wordCount, std::vector<Variable>& variables) {
+		if(wordCount < 5 || code[0] != SpirVMagicNumber) {
+			throw std::runtime_error("invalid SPIR-V module");
+		}
+
+		bool entryPointFound = false;
+
+		// Instructions start after the 5 words header
+		for(size_t i = 5; i < wordCount;) {
+			uint32_t opcode = code[i] & 0xFFFF;
+			uint32_t instructionWordCount = code[i] >> 16;
+			if(instructionWordCount == 0 || i + instructionWordCount > wordCount) {
+				throw std::runtime_error("malformed SPIR-V module");
+			}
+
+			const uint32_t* operands = code + i + 1;
+			uint32_t operandCount = instructionWordCount - 1;
+
+			switch(opcode) {
+				case OpEntryPoint:
+					if(!entryPointFound) {
+						stage = getStageFromExecutionModel(operands[0]);
+						entryPointFound = true;
+					}
+					break;
+
+				case OpDecorate: {
+					auto& decoration = decorations[operands[0]];
+					switch(operands[1]) {
+						case DecorationBlock: decoration.block = true; break;
+						case DecorationBufferBlock: decoration.bufferBlock = true; break;
+						case DecorationBuiltIn: decoration.builtIn = true; break;
+						case DecorationArrayStride: decoration.arrayStride = operands[2]; break;
+						case DecorationLocation: decoration.location = operands[2]; break;
+						case DecorationBinding: decoration.binding = operands[2]; break;
+						case DecorationDescriptorSet: decoration.set = operands[2]; break;
+					}
+					break;
+				}
+
+				case OpMemberDecorate: {
+					auto& members = memberDecorations[operands[0]];
+					if(members.size() <= operands[1]) {
+						members.resize(operands[1] + 1);
+					}
+					if(operands[2] == DecorationOffset) {
+						members[operands[1]].offset = operands[3];
+					}
+					else if(operands[2] == DecorationMatrixStride) {
+						members[operands[1]].matrixStride = operands[3];
+					}
+					break;
+				}
+
+				case OpTypeBool:
+				case OpTypeInt:
+				case OpTypeFloat:
+				case OpTypeVector:
+				case OpTypeMatrix:
+				case OpTypeImage:
+				case OpTypeSampler:
+				case OpTypeSampledImage:
+				case OpTypeArray:
+				case OpTypeRuntimeArray:
+				case OpTypeStruct:
+				case OpTypePointer:
+					types[operands[0]] = {opcode, std::vector<uint32_t>(operands + 1, operands + operandCount)};
+					break;
+
+				case OpConstant:
+				case OpSpecConstant:
+					constants[operands[1]] = operands[2];
+					break;
+
+				case OpVariable:
+					variables.push_back({operands[1], operands[0], operands[2]});
+					break;
+			}
+
+			i += instructionWordCount;
+		}
+
+		if(!entryPointFound) {
+			throw std::runtime_error("SPIR-V module has no entry point");
+		}
+	}
+
+	void ShaderReflection::reflectDescriptor(const Variable& variable) {
+		auto& decoration = decorations[variable.id];
+		uint32_t typeId = types[variable.pointerType].operands[1];
+
+		uint32_t count = 1;
+		while(types[typeId].opcode == OpTypeArray || types[typeId].opcode == OpTypeRuntimeArray) {
+			count *= types[typeId].opcode == OpTypeArray ? getArrayLength(typeId) : 0;
+			typeId = types[typeId].operands[0];
+		}
+
+		auto& type = types[typeId];
+		vk::DescriptorType descriptorType;
+		switch(type.opcode) {
+			case OpTypeSampler:
+				descriptorType = vk::DescriptorType::eSampler;
+				break;
+			case OpTypeSampledImage:
+				descriptorType = vk::DescriptorType::eCombinedImageSampler;
+				break;
+			case OpTypeImage: {
+				uint32_t dim = type.operands[1];
+				bool storage = type.operands[5] == 2;
+				if(dim == DimSubpassData) {
+					descriptorType = vk::DescriptorType::eInputAttachment;
+				}
+				else if(dim == DimBuffer) {
+					descriptorType = storage ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+				}
+				else {
+					descriptorType = storage ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+				}
+				break;
+			}
+			case OpTypeStruct:
+				if(variable.storageClass == StorageClassStorageBuffer || decorations[typeId].bufferBlock) {
+					descriptorType = vk::DescriptorType::eStorageBuffer;
+				}
+				else {
+					descriptorType = vk::DescriptorType::eUniformBuffer;
+				}
+				break;
+			default:
+				LOG_WARN("Unsupported resource type at binding {}, skipped by reflection", decoration.binding.value_or(0));
+				return;
+		}
+
+		descriptorBindings.push_back({decoration.set.value_or(0), decoration.binding.value_or(0), descriptorType, count});
+	}
+
+	void ShaderReflection::reflectInput(const Variable& variable) {
+		auto& decoration = decorations[variable.id];
+		if(decoration.builtIn || !decoration.location) {
+			return;
+		}
+
+		uint32_t typeId = types[variable.pointerType].operands[1];
+		uint32_t elements = 1;
+		uint32_t columns = 1;
+		if(types[typeId].opcode == OpTypeArray) {
+			elements = getArrayLength(typeId);
+			typeId = types[typeId].operands[0];
+		}
+		if(types[typeId].opcode == OpTypeMatrix) {
+			// Each column of a matrix attribute takes its own location
+			columns = types[typeId].operands[1];
+			typeId = types[typeId].operands[0];
+		}
+
+		vk::Format format = getFormat(typeId);
+		uint32_t size = getTypeSize(typeId);
+		uint32_t location = *decoration.location;
+		for(uint32_t i = 0; i < elements * columns; i++) {
+			inputAttributes.push_back({location++, format, size});
+		}
+	}
+
+	uint32_t ShaderReflection::getTypeSize(uint32_t typeId) {
+		auto& type = types[typeId];
+		switch(type.opcode) {
+			case OpTypeBool:
+				return 4;
+			case OpTypeInt:
+			case OpTypeFloat:
+				return type.operands[0] / 8;
+			case OpTypeVector:
+				return type.operands[1] * getTypeSize(type.operands[0]);
+			case OpTypeMatrix:
+				return type.operands[1] * getTypeSize(type.operands[0]);
+			case OpTypeArray: {
+				auto& decoration = decorations[typeId];
+				uint32_t stride = decoration.arrayStride ? *decoration.arrayStride : getTypeSize(type.operands[0]);
+				return stride * getArrayLength(typeId);
+			}
+			case OpTypeStruct: {
+				auto& members = memberDecorations[typeId];
+				uint32_t size = 0;
+				for(size_t i = 0; i < type.operands.size(); i++) {
+					uint32_t memberType = type.operands[i];
+					MemberDecorations member = i < members.size() ? members[i] : MemberDecorations();
+					uint32_t memberSize = getTypeSize(memberType);
+					if(member.matrixStride && types[memberType].opcode == OpTypeMatrix) {
+						memberSize = types[memberType].operands[1] * member.matrixStride;
+					}
+					size = std::max(size, member.offset + memberSize);
+				}
+				return size;
+			}
+			default:
+				return 0;
+		}
+	}
+
+	uint32_t ShaderReflection::getArrayLength(uint32_t typeId) {
+		auto constant = constants.find(types[typeId].operands[1]);
+		if(constant == constants.end()) {
+			throw std::runtime_error("SPIR-V array length is not a constant");
+		}
+		return constant->second;
+	}
+
+	vk::Format ShaderReflection::getFormat(uint32_t typeId) {
+		uint32_t components = 1;
+		if(types[typeId].opcode == OpTypeVector) {
+			components = types[typeId].operands[1];
+			typeId = types[typeId].operands[0];
+		}
+
+		static const vk::Format float16[] = {vk::Format::eR16Sfloat, vk::Format::eR16G16Sfloat, vk::Format::eR16G16B16Sfloat, vk::Format::eR16G16B16A16Sfloat};
+		static const vk::Format float32[] = {vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat};
+		static const vk::Format float64[] = {vk::Format::eR64Sfloat, vk::Format::eR64G64Sfloat, vk::Format::eR64G64B64Sfloat, vk::Format::eR64G64B64A64Sfloat};
+		static const vk::Format int32[] = {vk::Format::eR32Sint, vk::Format::eR32G32Sint, vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint};
+		static const vk::Format uint32[] = {vk::Format::eR32Uint, vk::Format::eR32G32Uint, vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint};
+
+		auto& scalar = types[typeId];
+		if(components < 1 || components > 4 || scalar.operands.empty()) {
+			throw std::runtime_error("unsupported vertex input type");
+		}
+
+		uint32_t width = scalar.operands[0];
+		if(scalar.opcode == OpTypeFloat) {
+			if(width == 16) return float16[components - 1];
+			if(width == 32) return float32[components - 1];
+			if(width == 64) return float64[components - 1];
+		}
+		else if(scalar.opcode == OpTypeInt && width == 32) {
+			return scalar.operands[1] ? int32[components - 1] : uint32[components - 1];
+		}
+
+		throw std::runtime_error("unsupported vertex input type");
+	}
+}
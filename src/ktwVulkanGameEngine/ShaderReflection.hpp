@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace ktw {
+	struct ReflectedDescriptorBinding {
+		uint32_t set;
+		uint32_t binding;
+		vk::DescriptorType type;
+		uint32_t count; // 0 for runtime (unsized) arrays
+	};
+
+	struct ReflectedInputAttribute {
+		uint32_t location;
+		vk::Format format;
+		uint32_t size;
+	};
+
+	// Reads the interface of a SPIR-V module: stage, descriptor bindings,
+	// push constant block size and (for vertex shaders) input attributes.
+	class ShaderReflection {
+	public:
+		ShaderReflection(const uint32_t* code, size_t codeSize);
+		vk::ShaderStageFlagBits getStage();
+		const std::vector<ktw::ReflectedDescriptorBinding>& getDescriptorBindings();
+		const std::vector<ktw::ReflectedInputAttribute>& getInputAttributes();
+		uint32_t getPushConstantSize();
+
+	private:
+		struct Type {
+			uint32_t opcode = 0;
+			std::vector<uint32_t> operands;
+		};
+
+		struct Decorations {
+			std::optional<uint32_t> location;
+			std::optional<uint32_t> binding;
+			std::optional<uint32_t> set;
+			std::optional<uint32_t> arrayStride;
+			bool builtIn = false;
+			bool block = false;
+			bool bufferBlock = false;
+		};
+
+		struct MemberDecorations {
+			uint32_t offset = 0;
+			uint32_t matrixStride = 0;
+		};
+
+		struct Variable {
+			uint32_t id;
+			uint32_t pointerType;
+			uint32_t storageClass;
+		};
+
+		vk::ShaderStageFlagBits stage;
+		std::vector<ktw::ReflectedDescriptorBinding> descriptorBindings;
+		std::vector<ktw::ReflectedInputAttribute> inputAttributes;
+		uint32_t pushConstantSize;
+
+		std::unordered_map<uint32_t, Type> types;
+		std::unordered_map<uint32_t, uint32_t> constants;
+		std::unordered_map<uint32_t, Decorations> decorations;
+		std::unordered_map<uint32_t, std::vector<MemberDecorations>> memberDecorations;
+
+		void parse(const uint32_t* code, size_t wordCount, std::vector<Variable>& variables);
+		void reflectDescriptor(const Variable& variable);
+		void reflectInput(const Variable& variable);
+		uint32_t getTypeSize(uint32_t typeId);
+		uint32_t getArrayLength(uint32_t typeId);
+		vk::Format getFormat(uint32_t typeId);
+	};
+}
@@ -0,0 +1,216 @@
+#include "pch.hpp"
+#include "ShaderWatcher.hpp"
+
+#ifdef __linux__
+	#include <sys/inotify.h>
+	#include <poll.h>
+	#include <unistd.h>
+#endif
+
+namespace ktw {
+	ShaderWatcher::ShaderWatcher(ktw::JobSystem& jobSystem) : jobSystem(jobSystem), running(true), inotifyFd(-1) {
+#ifdef __linux__
+		inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if(inotifyFd < 0) {
+			LOG_WARN("inotify unavailable, polling shader timestamps instead");
+		}
+#endif
+		thread = std::thread(&ShaderWatcher::run, this);
+		LOG_TRACE("Shader Watcher Created");
+	}
+
+	ShaderWatcher::~ShaderWatcher() {
+		running = false;
+		thread.join();
+#ifdef __linux__
+		if(inotifyFd >= 0) {
+			close(inotifyFd);
+		}
+#endif
+	}
+
+	void ShaderWatcher::watch(ktw::GraphicsPipeline* pipeline) {
+		std::lock_guard<std::mutex> lock(mutex);
+		addDependents(pipeline);
+	}
+
+	void ShaderWatcher::unwatch(ktw::GraphicsPipeline* pipeline) {
+		std::lock_guard<std::mutex> lock(mutex);
+		removeDependents(pipeline);
+		rebuiltPipelines.erase(pipeline);
+	}
+
+	void ShaderWatcher::applyReloads() {
+		std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+		if(!lock.owns_lock()) {
+			// A rebuild is in flight, pick it up at the next frame boundary instead of stalling this one
+			return;
+		}
+
+		for(auto pipeline : rebuiltPipelines) {
+			if(pipeline->swapPendingPipeline()) {
+				LOG_INFO("Graphics Pipeline Hot-Reloaded");
+			}
+		}
+		rebuiltPipelines.clear();
+	}
+
+	void ShaderWatcher::addDependents(ktw::GraphicsPipeline* pipeline) {
+		for(auto stage : {ktw::ShaderStage::eVertex, ktw::ShaderStage::eFragment}) {
+			for(auto& file : pipeline->getShader(stage).getFiles()) {
+				std::string path = normalizePath(file);
+				dependents[path].insert({pipeline, stage});
+				watchFile(path);
+			}
+		}
+	}
+
+	void ShaderWatcher::removeDependents(ktw::GraphicsPipeline* pipeline) {
+		for(auto it = dependents.begin(); it != dependents.end();) {
+			for(auto dependent = it->second.begin(); dependent != it->second.end();) {
+				if(dependent->first == pipeline) {
+					dependent = it->second.erase(dependent);
+				}
+				else {
+					dependent++;
+				}
+			}
+
+			if(it->second.empty()) {
+				timestamps.erase(it->first);
+				it = dependents.erase(it);
+			}
+			else {
+				it++;
+			}
+		}
+	}
+
+	void ShaderWatcher::watchFile(const std::string& file) {
+#ifdef __linux__
+		if(inotifyFd >= 0) {
+			std::string directory = std::filesystem::path(file).parent_path().string();
+			// inotify hands back the same descriptor when a directory is already watched
+			int wd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+			if(wd < 0) {
+				LOG_WARN("Cannot watch shader directory {}", directory);
+				return;
+			}
+			watchedDirectories[wd] = directory;
+			return;
+		}
+#endif
+		std::error_code error;
+		timestamps[file] = std::filesystem::last_write_time(file, error);
+	}
+
+	void ShaderWatcher::run() {
+		while(running) {
+			std::set<std::string> changedFiles = waitForChanges();
+			if(!changedFiles.empty()) {
+				reloadChangedFiles(changedFiles);
+			}
+		}
+	}
+
+	std::set<std::string> ShaderWatcher::waitForChanges() {
+		std::set<std::string> changedFiles;
+
+#ifdef __linux__
+		if(inotifyFd >= 0) {
+			pollfd pollInfo = {inotifyFd, POLLIN, 0};
+			if(poll(&pollInfo, 1, 100) <= 0) {
+				return changedFiles;
+			}
+
+			// Editors save in bursts (truncate, write, rename), coalesce them into one rebuild
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+			alignas(inotify_event) char buffer[4096];
+			ssize_t length;
+			std::lock_guard<std::mutex> lock(mutex);
+			while((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+				for(char* ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + ((inotify_event*) ptr)->len) {
+					auto event = (inotify_event*) ptr;
+					auto directory = watchedDirectories.find(event->wd);
+					if(event->len == 0 || directory == watchedDirectories.end()) {
+						continue;
+					}
+
+					std::string path = normalizePath(directory->second + "/" + event->name);
+					if(dependents.count(path)) {
+						changedFiles.insert(path);
+					}
+				}
+			}
+			return changedFiles;
+		}
+#endif
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for(auto& [file, timestamp] : timestamps) {
+			std::error_code error;
+			auto current = std::filesystem::last_write_time(file, error);
+			if(!error && current != timestamp) {
+				timestamp = current;
+				changedFiles.insert(file);
+			}
+		}
+		return changedFiles;
+	}
+
+	void ShaderWatcher::reloadChangedFiles(const std::set<std::string>& files) {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::map<ktw::GraphicsPipeline*, std::set<ktw::ShaderStage>> changedStages;
+		for(auto& file : files) {
+			LOG_INFO("Shader source changed: {}", file);
+			auto it = dependents.find(file);
+			if(it == dependents.end()) {
+				continue;
+			}
+			for(auto& [pipeline, stage] : it->second) {
+				changedStages[pipeline].insert(stage);
+			}
+		}
+
+		// Pipelines compile independently, a header shared by many of them rebuilds them all at once
+		std::vector<std::pair<ktw::GraphicsPipeline*, std::set<ktw::ShaderStage>>> reloads(changedStages.begin(), changedStages.end());
+		std::vector<char> reloaded(reloads.size(), 0);
+		jobSystem.parallelFor(static_cast<uint32_t>(reloads.size()), 1, [&](uint32_t begin, uint32_t end) {
+			for(uint32_t i = begin; i < end; i++) {
+				try {
+					reloads[i].first->reload(reloads[i].second);
+					reloaded[i] = 1;
+				}
+				catch(const std::exception& e) {
+					LOG_ERROR("Shader hot-reload failed, keeping previous pipeline: {}", e.what());
+				}
+			}
+		});
+
+		for(size_t i = 0; i < reloads.size(); i++) {
+			if(reloaded[i]) {
+				rebuiltPipelines.insert(reloads[i].first);
+				// Includes may have changed along with the source
+				removeDependents(reloads[i].first);
+				addDependents(reloads[i].first);
+			}
+		}
+	}
+
+	std::string ShaderWatcher::normalizePath(const std::string& path) {
+		std::string result = path;
+#ifndef _WIN32
+		std::replace(result.begin(), result.end(), '\\', '/');
+#endif
+		std::error_code error;
+		auto canonical = std::filesystem::weakly_canonical(result, error);
+		if(error) {
+			return std::filesystem::path(result).lexically_normal().generic_string();
+		}
+		return canonical.generic_string();
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+#include "GraphicsPipeline.hpp"
+#include "JobSystem.hpp"
+
+namespace ktw {
+	// Watches the shader sources (and their includes) of registered pipelines on
+	// a background thread. Changed stages are recompiled and the pipelines rebuilt
+	// in parallel on the job system; applyReloads() swaps them in and must be
+	// called between frames.
+	class ShaderWatcher {
+	public:
+		ShaderWatcher(ktw::JobSystem& jobSystem);
+		~ShaderWatcher();
+		void watch(ktw::GraphicsPipeline* pipeline);
+		void unwatch(ktw::GraphicsPipeline* pipeline);
+		void applyReloads();
+
+	private:
+		ktw::JobSystem& jobSystem;
+		std::mutex mutex;
+		std::atomic<bool> running;
+		std::thread thread;
+		std::map<std::string, std::set<std::pair<ktw::GraphicsPipeline*, ktw::ShaderStage>>> dependents;
+		std::unordered_map<std::string, std::filesystem::file_time_type> timestamps;
+		std::set<ktw::GraphicsPipeline*> rebuiltPipelines;
+		int inotifyFd;
+		std::unordered_map<int, std::string> watchedDirectories;
+
+		void run();
+		std::set<std::string> waitForChanges();
+		void addDependents(ktw::GraphicsPipeline* pipeline);
+		void removeDependents(ktw::GraphicsPipeline* pipeline);
+		void watchFile(const std::string& file);
+		void reloadChangedFiles(const std::set<std::string>& files);
+		static std::string normalizePath(const std::string& path);
+	};
+}
@@ -0,0 +1,36 @@
+#include "pch.hpp"
+#include "SpecializationConstants.hpp"
+
+namespace ktw {
+	bool SpecializationConstants::empty() const {
+		return entries.empty();
+	}
+
+	vk::SpecializationInfo SpecializationConstants::getInfo() const {
+		return vk::SpecializationInfo()
+			.setMapEntryCount(static_cast<uint32_t>(entries.size()))
+			.setPMapEntries(entries.data())
+			.setDataSize(data.size())
+			.setPData(data.data());
+	}
+
+	ktw::SpecializationConstants& SpecializationConstants::setData(uint32_t constantID, const void* value, uint32_t size) {
+		for(auto& entry : entries) {
+			if(entry.constantID == constantID && entry.size == size) {
+				memcpy(data.data() + entry.offset, value, size);
+				return *this;
+			}
+		}
+
+		entries.erase(std::remove_if(entries.begin(), entries.end(), [constantID](const vk::SpecializationMapEntry& entry) {
+			return entry.constantID == constantID;
+		}), entries.end());
+
+		uint32_t offset = static_cast<uint32_t>(data.size());
+		data.resize(offset + size);
+		memcpy(data.data() + offset, value, size);
+		entries.push_back(vk::SpecializationMapEntry(constantID, offset, size));
+
+		return *this;
+	}
+}
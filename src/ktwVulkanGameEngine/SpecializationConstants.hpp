@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace ktw {
+	struct SpecializationConstant {
+		uint32_t constantID;
+		uint32_t offset;
+		uint32_t size = sizeof(uint32_t);
+	};
+
+	// Values for the `layout(constant_id = N) const ...` declarations of a
+	// pipeline's shaders. The same values are given to every stage, a stage
+	// simply ignores the IDs it does not declare.
+	class SpecializationConstants {
+	public:
+		SpecializationConstants() = default;
+
+		// Maps the fields of a struct to constant IDs, like AttributeDescription
+		// does for vertices. Booleans must be stored as VkBool32 in the struct.
+		template<typename T>
+		SpecializationConstants(const T& values, const std::vector<ktw::SpecializationConstant>& constants) {
+			static_assert(std::is_trivially_copyable<T>::value, "specialization constants must be trivially copyable");
+			data.resize(sizeof(T));
+			memcpy(data.data(), &values, sizeof(T));
+			for(auto& constant : constants) {
+				entries.push_back(vk::SpecializationMapEntry(constant.constantID, constant.offset, constant.size));
+			}
+		}
+
+		template<typename T>
+		ktw::SpecializationConstants& set(uint32_t constantID, T value) {
+			static_assert(std::is_arithmetic<T>::value, "specialization constants must be scalars");
+			if constexpr (std::is_same<T, bool>::value) {
+				VkBool32 boolean = value ? VK_TRUE : VK_FALSE;
+				return setData(constantID, &boolean, sizeof(VkBool32));
+			}
+			else {
+				return setData(constantID, &value, sizeof(T));
+			}
+		}
+
+		bool empty() const;
+		vk::SpecializationInfo getInfo() const;
+
+	private:
+		std::vector<vk::SpecializationMapEntry> entries;
+		std::vector<uint8_t> data;
+
+		ktw::SpecializationConstants& setData(uint32_t constantID, const void* value, uint32_t size);
+	};
+}
@@ -5,6 +5,7 @@ namespace ktw {
 	SwapChain::SwapChain(ktw::Context& context) : context(context), imageAcquired(false) {
 		createSwapChain();
 		createImageViews();
+		depthBuffer = std::make_unique<ktw::DepthBuffer>(context, context.getWidth(), context.getHeight());
 		createRenderPass();
 		createFramebuffers();
 		createSemaphores();
@@ -137,16 +138,45 @@ namespace ktw {
 			.setAttachment(0)
 			.setLayout(vk::ImageLayout::eColorAttachmentOptimal);
 
+		// Cleared each frame and never read back, so it is not stored
+		auto depthAttachment = vk::AttachmentDescription()
+			.setFormat(depthBuffer->getFormat())
+			.setSamples(vk::SampleCountFlagBits::e1)
+			.setLoadOp(vk::AttachmentLoadOp::eClear)
+			.setStoreOp(vk::AttachmentStoreOp::eDontCare)
+			.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+			.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+			.setInitialLayout(vk::ImageLayout::eUndefined)
+			.setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+		auto depthAttachmentRef = vk::AttachmentReference()
+			.setAttachment(1)
+			.setLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
 		auto subpass = vk::SubpassDescription()
 			.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
 			.setColorAttachmentCount(1)
-			.setPColorAttachments(&colorAttachmentRef);
+			.setPColorAttachments(&colorAttachmentRef)
+			.setPDepthStencilAttachment(&depthAttachmentRef);
+
+		// The depth buffer is shared, the previous frame's depth tests finish before it is cleared
+		auto dependency = vk::SubpassDependency()
+			.setSrcSubpass(VK_SUBPASS_EXTERNAL)
+			.setDstSubpass(0)
+			.setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests)
+			.setSrcAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+			.setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests)
+			.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+
+		vk::AttachmentDescription attachments[] = {colorAttachment, depthAttachment};
 
 		auto renderPassInfo = vk::RenderPassCreateInfo()
-			.setAttachmentCount(1)
-			.setPAttachments(&colorAttachment)
+			.setAttachmentCount(2)
+			.setPAttachments(attachments)
 			.setSubpassCount(1)
-			.setPSubpasses(&subpass);
+			.setPSubpasses(&subpass)
+			.setDependencyCount(1)
+			.setPDependencies(&dependency);
 
 		renderPass = context.getDevice().createRenderPassUnique(renderPassInfo);
 		LOG_TRACE("RenderPass Created");
@@ -156,12 +186,32 @@ namespace ktw {
 		swapChainFramebuffers.reserve(swapChainImageViews.size());
 
 		for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-			swapChainFramebuffers.emplace_back(context, *(swapChainImageViews[i]), *renderPass);
+			swapChainFramebuffers.emplace_back(context, *(swapChainImageViews[i]), swapChainImageFormat, *renderPass, depthBuffer.get());
 		}
 
 		LOG_TRACE("Framebuffers ({}) Created", swapChainFramebuffers.size());
 	}
 
+	bool SwapChain::enableDynamicRendering() {
+		if(!context.supportsDynamicRendering()) {
+			LOG_WARN("Dynamic rendering is not supported by this GPU, render passes are kept");
+			return false;
+		}
+		if(!renderPass) {
+			return true;
+		}
+
+		// The images themselves are kept, only the objects tied to the render pass go
+		swapChainFramebuffers.clear();
+		renderPass.reset();
+		for (size_t i = 0; i < swapChainImages.size(); i++) {
+			swapChainFramebuffers.emplace_back(context, swapChainImages[i], *(swapChainImageViews[i]), swapChainImageFormat, vk::ImageLayout::ePresentSrcKHR, depthBuffer.get());
+		}
+
+		LOG_TRACE("Dynamic Rendering Enabled");
+		return true;
+	}
+
 	void SwapChain::createSemaphores() {
 		auto fenceInfo = vk::FenceCreateInfo();
 
@@ -177,6 +227,14 @@ namespace ktw {
 		return *renderPass;
 	}
 
+	vk::Format SwapChain::getColorFormat() {
+		return swapChainImageFormat;
+	}
+
+	vk::Format SwapChain::getDepthFormat() {
+		return depthBuffer->getFormat();
+	}
+
 	ktw::FrameBuffer& SwapChain::getFrameBuffer() {
 		context.getDevice().resetFences(*imageAvailableFence);
 		imageIndex = (context.getDevice().acquireNextImageKHR(*swapChain, UINT64_MAX, {}, *imageAvailableFence)).value;
@@ -189,7 +247,7 @@ namespace ktw {
 
 		uint32_t index = 0;
 		for(; index < swapChainFramebuffers.size(); index++) {
-			if(swapChainFramebuffers[index].getHandle() == frameBuffer.getHandle()) {
+			if(swapChainFramebuffers[index].getImageView() == frameBuffer.getImageView()) {
 				break;
 			}
 		}
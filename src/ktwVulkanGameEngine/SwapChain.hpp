@@ -2,6 +2,7 @@
 
 #include "Context.hpp"
 #include "FrameBuffer.hpp"
+#include "DepthBuffer.hpp"
 #include "RenderTarget.hpp"
 
 #include <optional>
@@ -14,6 +15,11 @@ namespace ktw {
 		uint32_t getHeight() override;
 		vk::Extent2D& getExtent();
 		vk::RenderPass getRenderPass() override;
+		vk::Format getColorFormat() override;
+		vk::Format getDepthFormat() override;
+		// Replaces the render pass and its framebuffers by dynamic rendering, before
+		// creating pipelines. Returns false, keeping them, when the GPU lacks it.
+		bool enableDynamicRendering();
 		//void setDescriptorPoolSize(uint32_t size);
 		//vk::DescriptorPool& getDescriptorPool();
 		ktw::FrameBuffer& getFrameBuffer() override;
@@ -26,6 +32,8 @@ namespace ktw {
 		vk::Format swapChainImageFormat;
 		vk::Extent2D swapChainExtent;
 		std::vector<vk::UniqueImageView> swapChainImageViews;
+		// Shared by the images, one frame is rendered at a time
+		std::unique_ptr<ktw::DepthBuffer> depthBuffer;
 		vk::UniqueRenderPass renderPass;
 		std::vector<ktw::FrameBuffer> swapChainFramebuffers;
 		uint32_t imageIndex;
@@ -0,0 +1,278 @@
+#include "pch.hpp"
+#include "Texture.hpp"
+#include "Buffer.hpp"
+
+#include <numeric>
+#include <vulkan/vulkan_format_traits.hpp>
+
+namespace ktw {
+	Texture::Texture(ktw::Context& context, ktw::CommandPool& commandPool, uint32_t width, uint32_t height, vk::Format format, const void* pixels, size_t size, bool generateMipmaps) :
+		context(context),
+		width(width),
+		height(height),
+		format(format),
+		mipLevels(1),
+		id(context.createResourceId())
+	{
+		if(generateMipmaps) {
+			// Blitting between levels needs linear filtering support for the format
+			vk::FormatFeatureFlags blitFeatures = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+			vk::FormatProperties properties = context.getPhysicalDevice().getFormatProperties(format);
+			if((properties.optimalTilingFeatures & blitFeatures) == blitFeatures) {
+				mipLevels = computeMipLevels(width, height);
+			}
+			else {
+				LOG_WARN("Format {} does not support linear blitting, texture created without mipmaps", vk::to_string(format));
+			}
+		}
+
+		vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+		if(mipLevels > 1) {
+			usage |= vk::ImageUsageFlagBits::eTransferSrc;
+		}
+
+		createImage(usage);
+		upload(commandPool, {{pixels, size}});
+		createImageView();
+		createSampler();
+
+		LOG_TRACE("Texture Created ({}x{}, {} mip levels)", width, height, mipLevels);
+	}
+
+	Texture::Texture(ktw::Context& context, ktw::CommandPool& commandPool, uint32_t width, uint32_t height, vk::Format format, const std::vector<ktw::TextureLevel>& levels) :
+		context(context),
+		width(width),
+		height(height),
+		format(format),
+		mipLevels(static_cast<uint32_t>(levels.size())),
+		id(context.createResourceId())
+	{
+		if(levels.empty() || levels.size() > computeMipLevels(width, height)) {
+			throw std::invalid_argument("invalid mip level count for a " + std::to_string(width) + "x" + std::to_string(height) + " texture");
+		}
+
+		createImage(vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled);
+		upload(commandPool, levels);
+		createImageView();
+		createSampler();
+
+		LOG_TRACE("Texture Created ({}x{}, {}, {} mip levels)", width, height, vk::to_string(format), mipLevels);
+	}
+
+	Texture::~Texture() {
+		context.destroyResourceId(id);
+	}
+
+	uint32_t Texture::computeMipLevels(uint32_t width, uint32_t height) {
+		uint32_t levels = 1;
+		uint32_t size = std::max(width, height);
+		while(size > 1) {
+			size /= 2;
+			levels++;
+		}
+		return levels;
+	}
+
+	void Texture::createImage(vk::ImageUsageFlags usage) {
+		vk::FormatProperties properties = context.getPhysicalDevice().getFormatProperties(format);
+		if(!(properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage)) {
+			throw std::runtime_error("texture format " + vk::to_string(format) + " is not supported by this GPU");
+		}
+
+		auto imageInfo = vk::ImageCreateInfo()
+			.setImageType(vk::ImageType::e2D)
+			.setExtent(vk::Extent3D(width, height, 1))
+			.setMipLevels(mipLevels)
+			.setArrayLayers(1)
+			.setFormat(format)
+			.setTiling(vk::ImageTiling::eOptimal)
+			.setInitialLayout(vk::ImageLayout::eUndefined)
+			.setUsage(usage)
+			.setSamples(vk::SampleCountFlagBits::e1)
+			.setSharingMode(vk::SharingMode::eExclusive);
+
+		image = context.getDevice().createImageUnique(imageInfo);
+
+		vk::MemoryRequirements memRequirements = context.getDevice().getImageMemoryRequirements(*image);
+
+		auto allocInfo = vk::MemoryAllocateInfo()
+			.setAllocationSize(memRequirements.size)
+			.setMemoryTypeIndex(ktw::Buffer::findMemoryType(context, memRequirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal));
+
+		memorySize = memRequirements.size;
+
+		imageMemory = context.getDevice().allocateMemoryUnique(allocInfo);
+
+		context.getDevice().bindImageMemory(*image, *imageMemory, 0);
+	}
+
+	void Texture::createImageView() {
+		auto viewInfo = vk::ImageViewCreateInfo()
+			.setImage(*image)
+			.setViewType(vk::ImageViewType::e2D)
+			.setFormat(format)
+			.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1));
+
+		imageView = context.getDevice().createImageViewUnique(viewInfo);
+	}
+
+	void Texture::createSampler() {
+		auto samplerInfo = vk::SamplerCreateInfo()
+			.setMagFilter(vk::Filter::eLinear)
+			.setMinFilter(vk::Filter::eLinear)
+			.setMipmapMode(vk::SamplerMipmapMode::eLinear)
+			.setAddressModeU(vk::SamplerAddressMode::eRepeat)
+			.setAddressModeV(vk::SamplerAddressMode::eRepeat)
+			.setAddressModeW(vk::SamplerAddressMode::eRepeat)
+			.setMinLod(0.0f)
+			.setMaxLod(static_cast<float>(mipLevels))
+			.setBorderColor(vk::BorderColor::eIntOpaqueBlack);
+
+		sampler = context.getDevice().createSamplerUnique(samplerInfo);
+	}
+
+	void Texture::upload(ktw::CommandPool& commandPool, const std::vector<ktw::TextureLevel>& levels) {
+		// Copy offsets have to be multiples of both the texel block size and 4,
+		// 12 byte formats like eR32G32B32Sfloat need 12 rather than a power of two
+		vk::DeviceSize alignment = std::lcm(static_cast<vk::DeviceSize>(vk::blockSize(format)), static_cast<vk::DeviceSize>(4));
+		std::vector<vk::DeviceSize> offsets;
+		vk::DeviceSize stagingSize = 0;
+		for(auto& level : levels) {
+			offsets.push_back(stagingSize);
+			stagingSize += (level.size + alignment - 1) / alignment * alignment;
+		}
+
+		ktw::Buffer stagingBuffer(context, 1, static_cast<uint32_t>(stagingSize), ktw::BufferUsage::eTransferSrc, nullptr);
+		for(size_t i = 0; i < levels.size(); i++) {
+			stagingBuffer.setData(levels[i].data, offsets[i], levels[i].size);
+		}
+
+		vk::CommandBuffer commandBuffer = commandPool.beginSingleTimeCommands();
+
+		transitionLayout(commandBuffer, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, 0, mipLevels);
+
+		std::vector<vk::BufferImageCopy> regions;
+		for(uint32_t level = 0; level < levels.size(); level++) {
+			regions.push_back(vk::BufferImageCopy()
+				.setBufferOffset(offsets[level])
+				.setImageSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1))
+				.setImageExtent(vk::Extent3D(std::max(width >> level, 1u), std::max(height >> level, 1u), 1)));
+		}
+
+		commandBuffer.copyBufferToImage(stagingBuffer.getBuffer(), *image, vk::ImageLayout::eTransferDstOptimal, regions);
+
+		if(levels.size() < mipLevels) {
+			generateMipmaps(commandBuffer);
+		}
+		else {
+			transitionLayout(commandBuffer, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, 0, mipLevels);
+		}
+
+		// Waits for the copy, the staging buffer can go away after this
+		commandPool.endSingleTimeCommands(commandBuffer);
+	}
+
+	void Texture::transitionLayout(vk::CommandBuffer commandBuffer, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t baseMipLevel, uint32_t levelCount) {
+		auto barrier = vk::ImageMemoryBarrier()
+			.setOldLayout(oldLayout)
+			.setNewLayout(newLayout)
+			.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setImage(*image)
+			.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, baseMipLevel, levelCount, 0, 1));
+
+		vk::PipelineStageFlags srcStage;
+		vk::PipelineStageFlags dstStage;
+
+		if(oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eTransferDstOptimal) {
+			barrier.setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+			srcStage = vk::PipelineStageFlagBits::eTopOfPipe;
+			dstStage = vk::PipelineStageFlagBits::eTransfer;
+		}
+		else if(oldLayout == vk::ImageLayout::eTransferDstOptimal && newLayout == vk::ImageLayout::eTransferSrcOptimal) {
+			barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite).setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+			srcStage = vk::PipelineStageFlagBits::eTransfer;
+			dstStage = vk::PipelineStageFlagBits::eTransfer;
+		}
+		else if(oldLayout == vk::ImageLayout::eTransferDstOptimal && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal) {
+			barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite).setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+			srcStage = vk::PipelineStageFlagBits::eTransfer;
+			dstStage = vk::PipelineStageFlagBits::eFragmentShader;
+		}
+		else if(oldLayout == vk::ImageLayout::eTransferSrcOptimal && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal) {
+			barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferRead).setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+			srcStage = vk::PipelineStageFlagBits::eTransfer;
+			dstStage = vk::PipelineStageFlagBits::eFragmentShader;
+		}
+		else {
+			throw std::invalid_argument("unsupported layout transition: " + vk::to_string(oldLayout) + " to " + vk::to_string(newLayout));
+		}
+
+		commandBuffer.pipelineBarrier(srcStage, dstStage, {}, nullptr, nullptr, barrier);
+	}
+
+	void Texture::generateMipmaps(vk::CommandBuffer commandBuffer) {
+		int32_t mipWidth = static_cast<int32_t>(width);
+		int32_t mipHeight = static_cast<int32_t>(height);
+
+		for(uint32_t level = 1; level < mipLevels; level++) {
+			// The previous level is complete, it becomes the source of this one
+			transitionLayout(commandBuffer, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferSrcOptimal, level - 1, 1);
+
+			int32_t nextWidth = std::max(mipWidth / 2, 1);
+			int32_t nextHeight = std::max(mipHeight / 2, 1);
+
+			auto blit = vk::ImageBlit()
+				.setSrcSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - 1, 0, 1))
+				.setSrcOffsets({vk::Offset3D(0, 0, 0), vk::Offset3D(mipWidth, mipHeight, 1)})
+				.setDstSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1))
+				.setDstOffsets({vk::Offset3D(0, 0, 0), vk::Offset3D(nextWidth, nextHeight, 1)});
+
+			commandBuffer.blitImage(*image, vk::ImageLayout::eTransferSrcOptimal, *image, vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+
+			transitionLayout(commandBuffer, vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, level - 1, 1);
+
+			mipWidth = nextWidth;
+			mipHeight = nextHeight;
+		}
+
+		// The last level was only written to
+		transitionLayout(commandBuffer, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, mipLevels - 1, 1);
+	}
+
+	vk::Image Texture::getImage() {
+		return *image;
+	}
+
+	vk::ImageView Texture::getImageView() {
+		return *imageView;
+	}
+
+	vk::Sampler Texture::getSampler() {
+		return *sampler;
+	}
+
+	vk::Format Texture::getFormat() {
+		return format;
+	}
+
+	uint32_t Texture::getWidth() {
+		return width;
+	}
+
+	uint32_t Texture::getHeight() {
+		return height;
+	}
+
+	uint32_t Texture::getMipLevels() {
+		return mipLevels;
+	}
+
+	vk::DeviceSize Texture::getMemorySize() {
+		return memorySize;
+	}
+
+	uint64_t Texture::getId() {
+		return id;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Context.hpp"
+#include "CommandPool.hpp"
+
+namespace ktw {
+	struct TextureLevel {
+		const void* data;
+		size_t size;
+	};
+
+	// Sampled 2D image in device local memory. Pixels go through a staging
+	// buffer, the mip chain is generated on the GPU by successive blits and
+	// every level ends up in eShaderReadOnlyOptimal, ready for a
+	// combined image sampler descriptor.
+	class Texture {
+	public:
+		Texture(ktw::Context& context, ktw::CommandPool& commandPool, uint32_t width, uint32_t height, vk::Format format, const void* pixels, size_t size, bool generateMipmaps = true);
+		// Every level is given, largest first, as block-compressed formats cannot be blitted
+		Texture(ktw::Context& context, ktw::CommandPool& commandPool, uint32_t width, uint32_t height, vk::Format format, const std::vector<ktw::TextureLevel>& levels);
+		~Texture();
+
+		vk::Image getImage();
+		vk::ImageView getImageView();
+		vk::Sampler getSampler();
+		vk::Format getFormat();
+		uint32_t getWidth();
+		uint32_t getHeight();
+		uint32_t getMipLevels();
+		vk::DeviceSize getMemorySize();
+		uint64_t getId();
+
+		static uint32_t computeMipLevels(uint32_t width, uint32_t height);
+
+	private:
+		ktw::Context& context;
+		uint32_t width;
+		uint32_t height;
+		vk::Format format;
+		uint32_t mipLevels;
+		uint64_t id;
+		vk::UniqueImage image;
+		vk::UniqueDeviceMemory imageMemory;
+		vk::DeviceSize memorySize;
+		vk::UniqueImageView imageView;
+		vk::UniqueSampler sampler;
+
+		void createImage(vk::ImageUsageFlags usage);
+		void createImageView();
+		void createSampler();
+		void upload(ktw::CommandPool& commandPool, const std::vector<ktw::TextureLevel>& levels);
+		void transitionLayout(vk::CommandBuffer commandBuffer, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t baseMipLevel, uint32_t levelCount);
+		void generateMipmaps(vk::CommandBuffer commandBuffer);
+	};
+}
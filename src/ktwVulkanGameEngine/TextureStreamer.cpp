@@ -0,0 +1,231 @@
+#include "pch.hpp"
+#include "TextureStreamer.hpp"
+
+#include <cmath>
+
+namespace ktw {
+	ktw::Texture& StreamedTexture::getTexture() {
+		return *texture;
+	}
+
+	uint32_t StreamedTexture::getResidentMip() {
+		return residentMip;
+	}
+
+	uint32_t StreamedTexture::getMipLevels() {
+		return static_cast<uint32_t>(file->getLevels().size());
+	}
+
+	uint32_t StreamedTexture::getWidth() {
+		return file->getWidth();
+	}
+
+	uint32_t StreamedTexture::getHeight() {
+		return file->getHeight();
+	}
+
+	TextureStreamer::TextureStreamer(ktw::Context& context, ktw::CommandPool& commandPool, vk::DeviceSize budget, vk::DeviceSize uploadBudgetPerFrame) :
+		context(context),
+		commandPool(commandPool),
+		budget(budget),
+		uploadBudgetPerFrame(uploadBudgetPerFrame)
+	{
+		if(budget == 0) {
+			vk::PhysicalDeviceMemoryProperties memProperties = context.getPhysicalDevice().getMemoryProperties();
+			for(uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+				if(memProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+					this->budget = std::max(this->budget, memProperties.memoryHeaps[i].size / 2);
+				}
+			}
+		}
+
+		LOG_TRACE("Texture Streamer Created ({} MiB budget)", this->budget >> 20);
+	}
+
+	ktw::StreamedTexture* TextureStreamer::load(const std::string& filename, uint32_t residentSize) {
+		auto texture = std::make_unique<ktw::StreamedTexture>();
+		texture->file = std::make_unique<ktw::Ktx2File>(filename);
+
+		// Start with the coarse levels only, up to residentSize pixels
+		uint32_t levelCount = static_cast<uint32_t>(texture->file->getLevels().size());
+		uint32_t size = std::max(texture->file->getWidth(), texture->file->getHeight());
+		uint32_t mip = 0;
+		while(mip + 1 < levelCount && (size >> mip) > residentSize) {
+			mip++;
+		}
+
+		texture->minimumMip = mip;
+		texture->requestedMip = mip;
+		texture->lastUsedFrame = frame;
+		makeResident(*texture, mip);
+
+		textures.push_back(std::move(texture));
+		return textures.back().get();
+	}
+
+	void TextureStreamer::unload(ktw::StreamedTexture* texture) {
+		auto it = std::find_if(textures.begin(), textures.end(), [&](const std::unique_ptr<ktw::StreamedTexture>& t) {
+			return t.get() == texture;
+		});
+		if(it == textures.end()) {
+			return;
+		}
+
+		retire(std::move(texture->texture));
+		textures.erase(it);
+	}
+
+	void TextureStreamer::requestMip(ktw::StreamedTexture* texture, uint32_t mip) {
+		mip = std::min(mip, texture->minimumMip);
+
+		// Several requests in the same frame keep the finest one
+		if(texture->lastUsedFrame != frame || mip < texture->requestedMip) {
+			texture->requestedMip = mip;
+		}
+		texture->lastUsedFrame = frame;
+	}
+
+	void TextureStreamer::requestScreenSize(ktw::StreamedTexture* texture, float pixels) {
+		float size = static_cast<float>(std::max(texture->getWidth(), texture->getHeight()));
+		float mip = pixels > 0.0f ? std::floor(std::log2(size / pixels)) : static_cast<float>(texture->minimumMip);
+		requestMip(texture, static_cast<uint32_t>(std::max(mip, 0.0f)));
+	}
+
+	vk::DeviceSize TextureStreamer::estimateSize(ktw::StreamedTexture& texture, uint32_t mip) {
+		vk::DeviceSize size = 0;
+		auto& levels = texture.file->getLevels();
+		for(size_t level = mip; level < levels.size(); level++) {
+			size += levels[level].size;
+		}
+		return size;
+	}
+
+	vk::DeviceSize TextureStreamer::estimateMemorySize(ktw::StreamedTexture& texture, uint32_t mip) {
+		auto& levels = texture.file->getLevels();
+		if(texture.memorySizes.empty()) {
+			texture.memorySizes.resize(levels.size(), 0);
+		}
+		if(texture.memorySizes[mip] == 0) {
+			// Asked from an image like the one Texture creates, never bound to memory
+			auto imageInfo = vk::ImageCreateInfo()
+				.setImageType(vk::ImageType::e2D)
+				.setExtent(vk::Extent3D(std::max(texture.file->getWidth() >> mip, 1u), std::max(texture.file->getHeight() >> mip, 1u), 1))
+				.setMipLevels(static_cast<uint32_t>(levels.size()) - mip)
+				.setArrayLayers(1)
+				.setFormat(texture.file->getFormat())
+				.setTiling(vk::ImageTiling::eOptimal)
+				.setInitialLayout(vk::ImageLayout::eUndefined)
+				.setUsage(vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled)
+				.setSamples(vk::SampleCountFlagBits::e1)
+				.setSharingMode(vk::SharingMode::eExclusive);
+
+			vk::UniqueImage image = context.getDevice().createImageUnique(imageInfo);
+			texture.memorySizes[mip] = context.getDevice().getImageMemoryRequirements(*image).size;
+		}
+		return texture.memorySizes[mip];
+	}
+
+	void TextureStreamer::makeResident(ktw::StreamedTexture& texture, uint32_t mip) {
+		auto& levels = texture.file->getLevels();
+		std::vector<ktw::TextureLevel> residentLevels(levels.begin() + mip, levels.end());
+
+		auto image = std::make_unique<ktw::Texture>(context, commandPool, std::max(texture.file->getWidth() >> mip, 1u), std::max(texture.file->getHeight() >> mip, 1u), texture.file->getFormat(), residentLevels);
+
+		if(texture.texture) {
+			retire(std::move(texture.texture));
+		}
+		residentSize += image->getMemorySize();
+		texture.texture = std::move(image);
+		texture.residentMip = mip;
+	}
+
+	void TextureStreamer::retire(std::unique_ptr<ktw::Texture> texture) {
+		residentSize -= texture->getMemorySize();
+		retiredSize += texture->getMemorySize();
+		retiredTextures.push_back(std::move(texture));
+	}
+
+	bool TextureStreamer::evictFor(vk::DeviceSize size, vk::DeviceSize& uploaded) {
+		if(residentSize + retiredSize + size <= budget) {
+			return true;
+		}
+
+		// Only textures not drawn this frame are candidates, least recently used first
+		std::vector<ktw::StreamedTexture*> candidates;
+		for(auto& texture : textures) {
+			if(texture->lastUsedFrame != frame && texture->residentMip < texture->minimumMip) {
+				candidates.push_back(texture.get());
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [](ktw::StreamedTexture* a, ktw::StreamedTexture* b) {
+			return a->lastUsedFrame < b->lastUsedFrame;
+		});
+
+		// Evicted images are only freed by recycle(), so this makes room for a
+		// later frame. The coarse levels replacing them are small and allocated
+		// right away.
+		for(auto texture : candidates) {
+			if(residentSize + size <= budget) {
+				break;
+			}
+			vk::DeviceSize uploadSize = estimateSize(*texture, texture->minimumMip);
+			if(uploaded + uploadSize > uploadBudgetPerFrame) {
+				break;
+			}
+			makeResident(*texture, texture->minimumMip);
+			uploaded += uploadSize;
+		}
+		return residentSize + retiredSize + size <= budget;
+	}
+
+	void TextureStreamer::update() {
+		std::vector<ktw::StreamedTexture*> pending;
+		for(auto& texture : textures) {
+			if(texture->lastUsedFrame == frame && texture->requestedMip < texture->residentMip) {
+				pending.push_back(texture.get());
+			}
+		}
+
+		// The blurriest textures are the most visible, serve them first
+		std::sort(pending.begin(), pending.end(), [](ktw::StreamedTexture* a, ktw::StreamedTexture* b) {
+			return a->residentMip - a->requestedMip > b->residentMip - b->requestedMip;
+		});
+
+		vk::DeviceSize uploaded = 0;
+		for(auto texture : pending) {
+			vk::DeviceSize uploadSize = estimateSize(*texture, texture->requestedMip);
+			if(uploaded > 0 && uploaded + uploadSize > uploadBudgetPerFrame) {
+				// The rest waits for the next frames, keeping the stall bounded
+				break;
+			}
+
+			// residentSize counts allocations, the growth has to be one too
+			vk::DeviceSize requiredSize = estimateMemorySize(*texture, texture->requestedMip);
+			vk::DeviceSize currentSize = texture->texture->getMemorySize();
+			vk::DeviceSize growth = requiredSize > currentSize ? requiredSize - currentSize : 0;
+			if(!evictFor(growth, uploaded)) {
+				LOG_WARN("Texture streaming budget exceeded, {} stays at mip {}", texture->file->getFilename(), texture->residentMip);
+				continue;
+			}
+
+			makeResident(*texture, texture->requestedMip);
+			uploaded += uploadSize;
+		}
+
+		frame++;
+	}
+
+	void TextureStreamer::recycle() {
+		// Called once the frame is rendered, the replaced images are no longer read
+		retiredTextures.clear();
+		retiredSize = 0;
+	}
+
+	vk::DeviceSize TextureStreamer::getBudget() {
+		return budget;
+	}
+
+	vk::DeviceSize TextureStreamer::getResidentSize() {
+		return residentSize;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Context.hpp"
+#include "CommandPool.hpp"
+#include "Texture.hpp"
+#include "Ktx2File.hpp"
+
+#include <list>
+
+namespace ktw {
+	// Texture whose finest mips are only resident when something asked for
+	// them. The GPU image is rebuilt with the resident range each time it
+	// changes, so getTexture() has to be read again every frame.
+	class StreamedTexture {
+	public:
+		ktw::Texture& getTexture();
+		uint32_t getResidentMip();
+		uint32_t getMipLevels();
+		uint32_t getWidth();
+		uint32_t getHeight();
+
+	private:
+		friend class TextureStreamer;
+
+		std::unique_ptr<ktw::Ktx2File> file;
+		std::unique_ptr<ktw::Texture> texture;
+		// Finest level resident, and the one never evicted below
+		uint32_t residentMip;
+		uint32_t minimumMip;
+		uint32_t requestedMip;
+		uint64_t lastUsedFrame = 0;
+		// Device allocation size of the image starting at each mip, 0 until asked
+		std::vector<vk::DeviceSize> memorySizes;
+	};
+
+	// Keeps the resident mips of every StreamedTexture under a VRAM budget.
+	// Each frame, the mips requested since the last update are loaded
+	// finest-deficit first within a per-frame upload budget, and the least
+	// recently used textures fall back to their minimum mip when the budget
+	// is exceeded.
+	class TextureStreamer {
+	public:
+		// A budget of 0 takes half of the largest device local heap
+		TextureStreamer(ktw::Context& context, ktw::CommandPool& commandPool, vk::DeviceSize budget = 0, vk::DeviceSize uploadBudgetPerFrame = 16 << 20);
+		ktw::StreamedTexture* load(const std::string& filename, uint32_t residentSize = 64);
+		void unload(ktw::StreamedTexture* texture);
+		void requestMip(ktw::StreamedTexture* texture, uint32_t mip);
+		// Size in pixels of the largest side of the texture as drawn on screen
+		void requestScreenSize(ktw::StreamedTexture* texture, float pixels);
+		void update();
+		void recycle();
+		vk::DeviceSize getBudget();
+		vk::DeviceSize getResidentSize();
+
+	private:
+		ktw::Context& context;
+		ktw::CommandPool& commandPool;
+		vk::DeviceSize budget;
+		vk::DeviceSize uploadBudgetPerFrame;
+		vk::DeviceSize residentSize = 0;
+		// Memory of the retired images, still allocated until recycle()
+		vk::DeviceSize retiredSize = 0;
+		uint64_t frame = 1;
+		std::list<std::unique_ptr<ktw::StreamedTexture>> textures;
+		// Replaced images, still referenced by the frame in flight
+		std::vector<std::unique_ptr<ktw::Texture>> retiredTextures;
+
+		void makeResident(ktw::StreamedTexture& texture, uint32_t mip);
+		void retire(std::unique_ptr<ktw::Texture> texture);
+		// Bytes uploaded from the file, for the per-frame upload budget
+		vk::DeviceSize estimateSize(ktw::StreamedTexture& texture, uint32_t mip);
+		// Device memory, for the VRAM budget, in the unit of Texture::getMemorySize()
+		vk::DeviceSize estimateMemorySize(ktw::StreamedTexture& texture, uint32_t mip);
+		// Evictions upload the coarse levels again and add to uploaded
+		bool evictFor(vk::DeviceSize size, vk::DeviceSize& uploaded);
+	};
+}
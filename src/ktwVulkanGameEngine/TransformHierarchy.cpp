@@ -0,0 +1,350 @@
+#include "pch.hpp"
+#include "TransformHierarchy.hpp"
+
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define KTW_SSE
+	#include <xmmintrin.h>
+#endif
+
+namespace ktw {
+	namespace {
+		// Levels larger than this are split over the job system
+		const uint32_t batchSize = 4096;
+
+		// out = a * b, a column of out per four wide multiply-add chain
+		inline void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out) {
+#ifdef KTW_SSE
+			__m128 a0 = _mm_loadu_ps(&a[0][0]);
+			__m128 a1 = _mm_loadu_ps(&a[1][0]);
+			__m128 a2 = _mm_loadu_ps(&a[2][0]);
+			__m128 a3 = _mm_loadu_ps(&a[3][0]);
+			for(int j = 0; j < 4; j++) {
+				const float* column = &b[j][0];
+				__m128 x = _mm_mul_ps(a0, _mm_set1_ps(column[0]));
+				__m128 y = _mm_mul_ps(a1, _mm_set1_ps(column[1]));
+				__m128 z = _mm_mul_ps(a2, _mm_set1_ps(column[2]));
+				__m128 w = _mm_mul_ps(a3, _mm_set1_ps(column[3]));
+				_mm_storeu_ps(&out[j][0], _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, w)));
+			}
+#else
+			out = a * b;
+#endif
+		}
+	}
+
+	const uint32_t TransformHierarchy::none;
+
+	TransformHierarchy::TransformHierarchy(uint32_t frameCount) : frameCount(std::max(std::min(frameCount, 255u), 1u)) {
+		LOG_TRACE("Transform Hierarchy Created");
+	}
+
+	uint32_t TransformHierarchy::create(const glm::mat4& local, uint32_t parent) {
+		if(parent != none) {
+			checkNode(parent);
+		}
+
+		uint32_t handle;
+		if(freeHandles.empty()) {
+			handle = static_cast<uint32_t>(slots.size());
+			slots.push_back(none);
+			destroyed.push_back(0);
+		}
+		else {
+			handle = freeHandles.back();
+			freeHandles.pop_back();
+		}
+
+		uint32_t slot = size();
+		uint32_t parentSlot = parent == none ? none : slots[parent];
+		uint32_t depth = parent == none ? 0 : depths[parentSlot] + 1;
+		slots[handle] = slot;
+		destroyed[handle] = 0;
+		locals.push_back(local);
+		worlds.push_back(local);
+		parents.push_back(parentSlot);
+		handles.push_back(handle);
+		depths.push_back(depth);
+		dirty.push_back(1);
+		changed.push_back(0);
+		pendingWrites.push_back(0);
+		firstDirty = std::min(firstDirty, slot);
+		lastDirty = lastDirty == none ? slot : std::max(lastDirty, slot);
+
+		// Appended at the deepest level the order holds, otherwise the next update sorts the levels again
+		uint32_t levelCount = levelStarts.empty() ? 0 : static_cast<uint32_t>(levelStarts.size() - 1);
+		if(structureChanged || depth + 1 < levelCount) {
+			structureChanged = true;
+		}
+		else if(depth + 1 == levelCount) {
+			levelStarts.back()++;
+		}
+		else {
+			if(levelStarts.empty()) {
+				levelStarts.push_back(0);
+			}
+			levelStarts.push_back(slot + 1);
+		}
+		return handle;
+	}
+
+	void TransformHierarchy::destroy(uint32_t node) {
+		checkNode(node);
+		// Descendants are found and the slots compacted by the next update
+		destroyed[node] = 1;
+		structureChanged = true;
+	}
+
+	void TransformHierarchy::setParent(uint32_t node, uint32_t parent) {
+		checkNode(node);
+		if(parent != none) {
+			checkNode(parent);
+		}
+
+		uint32_t slot = slots[node];
+		uint32_t parentSlot = parent == none ? none : slots[parent];
+		for(uint32_t ancestor = parentSlot; ancestor != none; ancestor = parents[ancestor]) {
+			if(ancestor == slot) {
+				throw std::runtime_error("transform hierarchy: a node cannot be parented to itself or its descendants");
+			}
+		}
+		parents[slot] = parentSlot;
+		dirty[slot] = 1;
+		firstDirty = std::min(firstDirty, slot);
+		lastDirty = lastDirty == none ? slot : std::max(lastDirty, slot);
+		structureChanged = true;
+	}
+
+	uint32_t TransformHierarchy::getParent(uint32_t node) const {
+		checkNode(node);
+		uint32_t parentSlot = parents[slots[node]];
+		return parentSlot == none ? none : handles[parentSlot];
+	}
+
+	void TransformHierarchy::setLocal(uint32_t node, const glm::mat4& local) {
+		checkNode(node);
+		uint32_t slot = slots[node];
+		locals[slot] = local;
+		dirty[slot] = 1;
+		firstDirty = std::min(firstDirty, slot);
+		lastDirty = lastDirty == none ? slot : std::max(lastDirty, slot);
+	}
+
+	const glm::mat4& TransformHierarchy::getLocal(uint32_t node) const {
+		checkNode(node);
+		return locals[slots[node]];
+	}
+
+	const glm::mat4& TransformHierarchy::getWorld(uint32_t node) const {
+		checkNode(node);
+		return worlds[slots[node]];
+	}
+
+	uint32_t TransformHierarchy::getSlot(uint32_t node) const {
+		checkNode(node);
+		return slots[node];
+	}
+
+	uint32_t TransformHierarchy::size() const {
+		return static_cast<uint32_t>(locals.size());
+	}
+
+	uint32_t TransformHierarchy::update(ktw::JobSystem* jobSystem) {
+		if(structureChanged) {
+			rebuild();
+		}
+		if(firstDirty == none) {
+			return 0;
+		}
+
+		updateIndex++;
+		uint32_t recomputed = 0;
+		uint32_t level = static_cast<uint32_t>(std::upper_bound(levelStarts.begin(), levelStarts.end(), firstDirty) - levelStarts.begin() - 1);
+		for(; level + 1 < levelStarts.size(); level++) {
+			// Parents are one level up, so a level's nodes are independent
+			uint32_t begin = std::max(levelStarts[level], firstDirty);
+			uint32_t end = levelStarts[level + 1];
+			uint32_t levelRecomputed = 0;
+			if(jobSystem && end - begin > batchSize) {
+				std::atomic<uint32_t> count(0);
+				jobSystem->parallelFor(end - begin, batchSize, [&](uint32_t batchBegin, uint32_t batchEnd) {
+					count += updateRange(begin + batchBegin, begin + batchEnd);
+				});
+				levelRecomputed = count;
+			}
+			else {
+				levelRecomputed = updateRange(begin, end);
+			}
+			recomputed += levelRecomputed;
+			// Nothing changed to propagate and no dirty node further
+			if(levelRecomputed == 0 && end > lastDirty) {
+				break;
+			}
+		}
+
+		firstPending = std::min(firstPending, firstDirty);
+		firstDirty = none;
+		lastDirty = none;
+		return recomputed;
+	}
+
+	void TransformHierarchy::write(glm::mat4* matrices) {
+		if(firstPending == none) {
+			return;
+		}
+		uint32_t nextPending = none;
+		uint32_t count = size();
+		for(uint32_t slot = firstPending; slot < count; slot++) {
+			// Mostly zeros, skipped 8 at a time
+			uint64_t word;
+			if(slot + 8 <= count && (memcpy(&word, &pendingWrites[slot], sizeof(word)), word == 0)) {
+				slot += 7;
+				continue;
+			}
+			if(pendingWrites[slot] == 0) {
+				continue;
+			}
+			matrices[slot] = worlds[slot];
+			if(--pendingWrites[slot] > 0 && nextPending == none) {
+				nextPending = slot;
+			}
+		}
+		firstPending = nextPending;
+	}
+
+	void TransformHierarchy::invalidate() {
+		std::fill(pendingWrites.begin(), pendingWrites.end(), static_cast<uint8_t>(frameCount));
+		firstPending = size() > 0 ? 0 : none;
+	}
+
+	void TransformHierarchy::checkNode(uint32_t node) const {
+		// Freed handles have no slot, a recycled one cannot be told from the new node though
+		if(node >= slots.size() || slots[node] == none || destroyed[node]) {
+			throw std::runtime_error("transform hierarchy: node " + std::to_string(node) + " does not exist or was destroyed");
+		}
+	}
+
+	void TransformHierarchy::rebuild() {
+		uint32_t count = size();
+
+		// Children of each slot, in slot order
+		std::vector<uint32_t> childStarts(count + 1, 0);
+		for(uint32_t slot = 0; slot < count; slot++) {
+			if(parents[slot] != none) {
+				childStarts[parents[slot] + 1]++;
+			}
+		}
+		for(uint32_t slot = 0; slot < count; slot++) {
+			childStarts[slot + 1] += childStarts[slot];
+		}
+		std::vector<uint32_t> children(childStarts[count]);
+		std::vector<uint32_t> cursors(childStarts.begin(), childStarts.end() - 1);
+		for(uint32_t slot = 0; slot < count; slot++) {
+			if(parents[slot] != none) {
+				children[cursors[parents[slot]]++] = slot;
+			}
+		}
+
+		// Breadth-first from the roots: a level's nodes follow the order of their
+		// parents, so the children of a node are contiguous and the update reads
+		// the level above sequentially. Descendants of destroyed nodes go too.
+		std::vector<uint32_t> order;
+		order.reserve(count);
+		std::vector<uint32_t> newDepths(count, 0);
+		std::vector<uint8_t> removed(count, 0);
+		for(uint32_t slot = 0; slot < count; slot++) {
+			if(parents[slot] == none) {
+				removed[slot] = destroyed[handles[slot]];
+				order.push_back(slot);
+			}
+		}
+		for(size_t i = 0; i < order.size(); i++) {
+			uint32_t slot = order[i];
+			for(uint32_t c = childStarts[slot]; c < childStarts[slot + 1]; c++) {
+				uint32_t child = children[c];
+				removed[child] = removed[slot] || destroyed[handles[child]];
+				newDepths[child] = newDepths[slot] + 1;
+				order.push_back(child);
+			}
+		}
+
+		std::vector<uint32_t> newSlots(count, none);
+		uint32_t newCount = 0;
+		levelStarts.clear();
+		for(uint32_t slot : order) {
+			if(removed[slot]) {
+				slots[handles[slot]] = none;
+				destroyed[handles[slot]] = 0;
+				freeHandles.push_back(handles[slot]);
+				continue;
+			}
+			while(levelStarts.size() <= newDepths[slot]) {
+				levelStarts.push_back(newCount);
+			}
+			newSlots[slot] = newCount++;
+		}
+		levelStarts.push_back(newCount);
+
+		std::vector<glm::mat4> newLocals(newCount), newWorlds(newCount);
+		std::vector<uint32_t> newParents(newCount), newHandles(newCount), sortedDepths(newCount), newChanged(newCount);
+		std::vector<uint8_t> newDirty(newCount), newPendingWrites(newCount);
+		firstDirty = none;
+		lastDirty = none;
+		firstPending = none;
+		for(uint32_t slot = 0; slot < count; slot++) {
+			uint32_t newSlot = newSlots[slot];
+			if(newSlot == none) {
+				continue;
+			}
+			newLocals[newSlot] = locals[slot];
+			newWorlds[newSlot] = worlds[slot];
+			newParents[newSlot] = parents[slot] == none ? none : newSlots[parents[slot]];
+			newHandles[newSlot] = handles[slot];
+			sortedDepths[newSlot] = newDepths[slot];
+			newDirty[newSlot] = dirty[slot];
+			newChanged[newSlot] = changed[slot];
+			// Moved matrices are missing from every frame buffer at their new slot
+			newPendingWrites[newSlot] = newSlot == slot ? pendingWrites[slot] : static_cast<uint8_t>(frameCount);
+			slots[handles[slot]] = newSlot;
+			if(newDirty[newSlot]) {
+				firstDirty = std::min(firstDirty, newSlot);
+				lastDirty = lastDirty == none ? newSlot : std::max(lastDirty, newSlot);
+			}
+			if(newPendingWrites[newSlot]) {
+				firstPending = std::min(firstPending, newSlot);
+			}
+		}
+
+		locals = std::move(newLocals);
+		worlds = std::move(newWorlds);
+		parents = std::move(newParents);
+		handles = std::move(newHandles);
+		depths = std::move(sortedDepths);
+		dirty = std::move(newDirty);
+		changed = std::move(newChanged);
+		pendingWrites = std::move(newPendingWrites);
+		structureChanged = false;
+	}
+
+	uint32_t TransformHierarchy::updateRange(uint32_t begin, uint32_t end) {
+		uint32_t recomputed = 0;
+		for(uint32_t slot = begin; slot < end; slot++) {
+			uint32_t parent = parents[slot];
+			if(!dirty[slot] && (parent == none || changed[parent] != updateIndex)) {
+				continue;
+			}
+			if(parent == none) {
+				worlds[slot] = locals[slot];
+			}
+			else {
+				multiply(worlds[parent], locals[slot], worlds[slot]);
+			}
+			dirty[slot] = 0;
+			changed[slot] = updateIndex;
+			pendingWrites[slot] = static_cast<uint8_t>(frameCount);
+			recomputed++;
+		}
+		return recomputed;
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <limits>
+#include <vector>
+
+#include "JobSystem.hpp"
+
+namespace ktw {
+	// Parent/child transforms. Nodes are stored breadth-first, parents before
+	// children and each depth contiguous, so world matrices are computed in
+	// one pass, a level at a time. Only the subtrees under a changed local
+	// matrix are recomputed, a static scene costs nothing per frame.
+	// Nodes are referred to by handles, their slot in the arrays, which is
+	// where their matrix goes in the uploaded buffer, changes when the
+	// hierarchy does. Every method taking a handle throws when the node does
+	// not exist or was destroyed.
+	class TransformHierarchy {
+	public:
+		static const uint32_t none = std::numeric_limits<uint32_t>::max();
+
+		// frameCount is the number of per-frame buffers write is called with in turn
+		explicit TransformHierarchy(uint32_t frameCount = 2);
+		uint32_t create(const glm::mat4& local = glm::mat4(1.0f), uint32_t parent = none);
+		// Destroys the node and its descendants, destroying it twice throws
+		void destroy(uint32_t node);
+		void setParent(uint32_t node, uint32_t parent);
+		uint32_t getParent(uint32_t node) const;
+		void setLocal(uint32_t node, const glm::mat4& local);
+		const glm::mat4& getLocal(uint32_t node) const;
+		// As of the last update
+		const glm::mat4& getWorld(uint32_t node) const;
+		uint32_t getSlot(uint32_t node) const;
+		uint32_t size() const;
+		// Applies the changes to the hierarchy and recomputes the world matrices
+		// of dirty subtrees. Large levels are split over the job system when one
+		// is given. Returns the number of matrices recomputed.
+		uint32_t update(ktw::JobSystem* jobSystem = nullptr);
+		// Copies the world matrices the frame's buffer misses, matrices holds size() of them
+		void write(glm::mat4* matrices);
+		// For new buffers, the next frameCount writes copy every matrix
+		void invalidate();
+
+	private:
+		uint32_t frameCount;
+		// By slot
+		std::vector<glm::mat4> locals;
+		std::vector<glm::mat4> worlds;
+		std::vector<uint32_t> parents;
+		std::vector<uint32_t> handles;
+		std::vector<uint32_t> depths;
+		std::vector<uint8_t> dirty;
+		// Update in which the world matrix last changed
+		std::vector<uint32_t> changed;
+		// Writes left before every frame buffer has the matrix
+		std::vector<uint8_t> pendingWrites;
+		// First slot of each depth, and the end of the last one
+		std::vector<uint32_t> levelStarts;
+		// By handle
+		std::vector<uint32_t> slots;
+		std::vector<uint32_t> freeHandles;
+		std::vector<uint8_t> destroyed;
+		bool structureChanged = false;
+		uint32_t firstDirty = none;
+		uint32_t lastDirty = none;
+		uint32_t firstPending = none;
+		uint32_t updateIndex = 0;
+
+		// Throws for handles out of range, freed or destroyed
+		void checkNode(uint32_t node) const;
+		void rebuild();
+		uint32_t updateRange(uint32_t begin, uint32_t end);
+	};
+}
@@ -0,0 +1,242 @@
+#include "pch.hpp"
+#include "World.hpp"
+
+#include <new>
+
+namespace ktw {
+	namespace {
+		// Component arrays start on their own cache line, which also suits aligned SIMD loads
+		const uint32_t columnAlignment = 64;
+
+		uint32_t alignUp(uint32_t value, uint32_t alignment) {
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		// Fixed storage, so ids handed out can be read without locking while others register
+		std::array<ktw::ComponentRegistry::Info, maxComponentTypes> registeredTypes;
+		uint32_t registeredTypeCount = 0;
+		std::mutex registryMutex;
+	}
+
+	uint32_t ComponentRegistry::registerType(uint32_t size, uint32_t alignment) {
+		std::lock_guard<std::mutex> lock(registryMutex);
+		if(registeredTypeCount >= maxComponentTypes) {
+			throw std::runtime_error("too many component types, the limit is " + std::to_string(maxComponentTypes));
+		}
+		if(alignment > columnAlignment) {
+			throw std::runtime_error("component alignment above " + std::to_string(columnAlignment) + " is not supported");
+		}
+		registeredTypes[registeredTypeCount] = {size, alignment};
+		return registeredTypeCount++;
+	}
+
+	const ComponentRegistry::Info& ComponentRegistry::getInfo(uint32_t id) {
+		return registeredTypes[id];
+	}
+
+	ChunkAllocator::~ChunkAllocator() {
+		for(uint8_t* block : blocks) {
+			::operator delete(block, std::align_val_t(columnAlignment));
+		}
+	}
+
+	uint8_t* ChunkAllocator::allocate() {
+		if(!freeBlocks.empty()) {
+			uint8_t* block = freeBlocks.back();
+			freeBlocks.pop_back();
+			return block;
+		}
+		uint8_t* block = static_cast<uint8_t*>(::operator new(chunkSize, std::align_val_t(columnAlignment)));
+		blocks.push_back(block);
+		return block;
+	}
+
+	void ChunkAllocator::free(uint8_t* chunk) {
+		freeBlocks.push_back(chunk);
+	}
+
+	World::World() {
+		// Entities without any component live in the empty archetype
+		getArchetype(ComponentMask());
+	}
+
+	ktw::Entity World::create() {
+		return createIn(getArchetype(ComponentMask()));
+	}
+
+	void World::destroy(ktw::Entity entity) {
+		removeRow(getRecord(entity));
+		auto& record = records[entity.index];
+		record.archetype = nullptr;
+		record.generation++;
+		freeIndices.push_back(entity.index);
+		entityCount--;
+	}
+
+	bool World::isAlive(ktw::Entity entity) const {
+		return entity.index < records.size() && records[entity.index].archetype && records[entity.index].generation == entity.generation;
+	}
+
+	uint32_t World::getEntityCount() const {
+		return entityCount;
+	}
+
+	ktw::Archetype* World::getArchetype(const ComponentMask& mask) {
+		auto it = archetypesByMask.find(mask);
+		if(it != archetypesByMask.end()) {
+			return it->second;
+		}
+
+		auto archetype = std::make_unique<ktw::Archetype>();
+		archetype->mask = mask;
+		archetype->columnOffsets.fill(ktw::Archetype::noColumn);
+		uint32_t rowSize = sizeof(ktw::Entity);
+		for(uint32_t id = 0; id < maxComponentTypes; id++) {
+			if(mask.test(id)) {
+				archetype->componentIds.push_back(id);
+				rowSize += ktw::ComponentRegistry::getInfo(id).size;
+			}
+		}
+
+		// Largest capacity whose arrays, padded to their alignment, still fit in a chunk
+		uint32_t capacity = static_cast<uint32_t>(ChunkAllocator::chunkSize / rowSize);
+		for(; capacity > 0; capacity--) {
+			uint32_t offset = capacity * sizeof(ktw::Entity);
+			for(uint32_t id : archetype->componentIds) {
+				offset = alignUp(offset, columnAlignment);
+				archetype->columnOffsets[id] = offset;
+				offset += capacity * ktw::ComponentRegistry::getInfo(id).size;
+			}
+			if(offset <= ChunkAllocator::chunkSize) {
+				break;
+			}
+		}
+		if(capacity == 0) {
+			throw std::runtime_error("components too large to fit a chunk");
+		}
+		archetype->chunkCapacity = capacity;
+
+		ktw::Archetype* result = archetype.get();
+		archetypes.push_back(std::move(archetype));
+		archetypesByMask[mask] = result;
+		return result;
+	}
+
+	ktw::Entity World::createIn(ktw::Archetype* archetype) {
+		uint32_t index;
+		if(!freeIndices.empty()) {
+			index = freeIndices.back();
+			freeIndices.pop_back();
+		}
+		else {
+			index = static_cast<uint32_t>(records.size());
+			records.push_back({nullptr, 0, 0, 0});
+		}
+
+		ktw::Entity entity = {index, records[index].generation};
+		insertRow(entity, archetype);
+		entityCount++;
+		return entity;
+	}
+
+	void* World::addComponent(ktw::Entity entity, uint32_t componentId) {
+		if(void* existing = getComponent(entity, componentId)) {
+			return existing;
+		}
+
+		ktw::Archetype* from = records[entity.index].archetype;
+		ktw::Archetype*& to = from->addEdges[componentId];
+		if(!to) {
+			to = getArchetype(ComponentMask(from->mask).set(componentId));
+		}
+		moveEntity(entity, to);
+		return getComponent(entity, componentId);
+	}
+
+	void World::removeComponent(ktw::Entity entity, uint32_t componentId) {
+		if(!getComponent(entity, componentId)) {
+			return;
+		}
+
+		ktw::Archetype* from = records[entity.index].archetype;
+		ktw::Archetype*& to = from->removeEdges[componentId];
+		if(!to) {
+			to = getArchetype(ComponentMask(from->mask).reset(componentId));
+		}
+		moveEntity(entity, to);
+	}
+
+	void* World::getComponent(ktw::Entity entity, uint32_t componentId) const {
+		const EntityRecord& record = getRecord(entity);
+		uint32_t offset = record.archetype->columnOffsets[componentId];
+		if(offset == ktw::Archetype::noColumn) {
+			return nullptr;
+		}
+		return record.archetype->chunks[record.chunk].data + offset + static_cast<size_t>(record.row) * ktw::ComponentRegistry::getInfo(componentId).size;
+	}
+
+	void World::insertRow(ktw::Entity entity, ktw::Archetype* archetype) {
+		if(archetype->chunks.empty() || archetype->chunks.back().count == archetype->chunkCapacity) {
+			archetype->chunks.push_back({chunkAllocator.allocate(), 0});
+		}
+		auto& chunk = archetype->chunks.back();
+		uint32_t row = chunk.count++;
+		archetype->getEntities(chunk)[row] = entity;
+
+		auto& record = records[entity.index];
+		record.archetype = archetype;
+		record.chunk = static_cast<uint32_t>(archetype->chunks.size() - 1);
+		record.row = row;
+	}
+
+	void World::removeRow(const EntityRecord& record) {
+		// The archetype's last entity fills the hole, so only the last chunk is ever partly filled
+		ktw::Archetype* archetype = record.archetype;
+		auto& last = archetype->chunks.back();
+		uint32_t lastRow = last.count - 1;
+		if(record.chunk != archetype->chunks.size() - 1 || record.row != lastRow) {
+			auto& chunk = archetype->chunks[record.chunk];
+			ktw::Entity moved = archetype->getEntities(last)[lastRow];
+			archetype->getEntities(chunk)[record.row] = moved;
+			for(uint32_t id : archetype->componentIds) {
+				uint32_t size = ktw::ComponentRegistry::getInfo(id).size;
+				uint32_t offset = archetype->columnOffsets[id];
+				memcpy(chunk.data + offset + static_cast<size_t>(record.row) * size, last.data + offset + static_cast<size_t>(lastRow) * size, size);
+			}
+			records[moved.index].chunk = record.chunk;
+			records[moved.index].row = record.row;
+		}
+
+		if(--last.count == 0) {
+			chunkAllocator.free(last.data);
+			archetype->chunks.pop_back();
+		}
+	}
+
+	void World::moveEntity(ktw::Entity entity, ktw::Archetype* to) {
+		EntityRecord from = records[entity.index];
+		insertRow(entity, to);
+		const EntityRecord& record = records[entity.index];
+
+		// Components of both archetypes are carried over, the new one is written by the caller
+		auto& source = from.archetype->chunks[from.chunk];
+		auto& destination = to->chunks[record.chunk];
+		for(uint32_t id : to->componentIds) {
+			uint32_t sourceOffset = from.archetype->columnOffsets[id];
+			if(sourceOffset == ktw::Archetype::noColumn) {
+				continue;
+			}
+			uint32_t size = ktw::ComponentRegistry::getInfo(id).size;
+			memcpy(destination.data + to->columnOffsets[id] + static_cast<size_t>(record.row) * size, source.data + sourceOffset + static_cast<size_t>(from.row) * size, size);
+		}
+
+		removeRow(from);
+	}
+
+	const World::EntityRecord& World::getRecord(ktw::Entity entity) const {
+		if(!isAlive(entity)) {
+			throw std::runtime_error("entity " + std::to_string(entity.index) + " is not alive");
+		}
+		return records[entity.index];
+	}
+}
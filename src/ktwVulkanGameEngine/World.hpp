@@ -0,0 +1,193 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace ktw {
+	struct Entity {
+		uint32_t index;
+		uint32_t generation;
+
+		bool operator==(const Entity& other) const {
+			return index == other.index && generation == other.generation;
+		}
+		bool operator!=(const Entity& other) const {
+			return !(*this == other);
+		}
+	};
+
+	static const uint32_t maxComponentTypes = 64;
+	using ComponentMask = std::bitset<maxComponentTypes>;
+
+	// Process wide ids of the component types, assigned on first use
+	class ComponentRegistry {
+	public:
+		struct Info {
+			uint32_t size;
+			uint32_t alignment;
+		};
+
+		template<typename T>
+		static uint32_t getId() {
+			static_assert(std::is_trivially_copyable<T>::value, "Components are moved between chunks with memcpy");
+			static const uint32_t id = registerType(sizeof(T), alignof(T));
+			return id;
+		}
+		static const Info& getInfo(uint32_t id);
+
+	private:
+		static uint32_t registerType(uint32_t size, uint32_t alignment);
+	};
+
+	// Fixed size blocks chunks are carved from, recycled instead of freed
+	class ChunkAllocator {
+	public:
+		static const size_t chunkSize = 16 * 1024;
+
+		ChunkAllocator() = default;
+		ChunkAllocator(const ChunkAllocator&) = delete;
+		ChunkAllocator& operator=(const ChunkAllocator&) = delete;
+		~ChunkAllocator();
+		uint8_t* allocate();
+		void free(uint8_t* chunk);
+
+	private:
+		std::vector<uint8_t*> blocks;
+		std::vector<uint8_t*> freeBlocks;
+	};
+
+	// Entities with exactly the same component types. Their components are
+	// stored in chunks as one array per type (structure of arrays), after the
+	// array of the entities themselves. Every chunk but the last is full.
+	struct Archetype {
+		struct Chunk {
+			uint8_t* data;
+			uint32_t count;
+		};
+
+		static const uint32_t noColumn = ~0u;
+
+		ComponentMask mask;
+		std::vector<uint32_t> componentIds;
+		// Offset of each component array in a chunk, by component id
+		std::array<uint32_t, maxComponentTypes> columnOffsets;
+		uint32_t chunkCapacity;
+		std::vector<Chunk> chunks;
+		// Archetypes reached by adding or removing one component
+		std::unordered_map<uint32_t, ktw::Archetype*> addEdges;
+		std::unordered_map<uint32_t, ktw::Archetype*> removeEdges;
+
+		ktw::Entity* getEntities(const Chunk& chunk) const {
+			return reinterpret_cast<ktw::Entity*>(chunk.data);
+		}
+
+		template<typename T>
+		T* getColumn(const Chunk& chunk) const {
+			return reinterpret_cast<T*>(chunk.data + columnOffsets[ktw::ComponentRegistry::getId<T>()]);
+		}
+	};
+
+	// Archetype based entity component system. Queries walk the chunks of the
+	// matching archetypes, so systems read each component as a tightly packed
+	// array. Adding or removing a component moves the entity to another
+	// archetype; no entity may be created, destroyed or change components
+	// while a query is running.
+	class World {
+	public:
+		World();
+		World(const World&) = delete;
+		World& operator=(const World&) = delete;
+
+		ktw::Entity create();
+		template<typename... T>
+		ktw::Entity create(const T&... components) {
+			ktw::Entity entity = createIn(getArchetype(getMask<T...>()));
+			(memcpy(getComponent(entity, ktw::ComponentRegistry::getId<T>()), &components, sizeof(T)), ...);
+			return entity;
+		}
+		void destroy(ktw::Entity entity);
+		bool isAlive(ktw::Entity entity) const;
+		uint32_t getEntityCount() const;
+
+		template<typename T>
+		T& add(ktw::Entity entity, const T& component = T()) {
+			T* data = static_cast<T*>(addComponent(entity, ktw::ComponentRegistry::getId<T>()));
+			memcpy(data, &component, sizeof(T));
+			return *data;
+		}
+		template<typename T>
+		void remove(ktw::Entity entity) {
+			removeComponent(entity, ktw::ComponentRegistry::getId<T>());
+		}
+		template<typename T>
+		bool has(ktw::Entity entity) const {
+			return getComponent(entity, ktw::ComponentRegistry::getId<T>()) != nullptr;
+		}
+		// nullptr when the entity has no such component, invalidated by structural changes
+		template<typename T>
+		T* get(ktw::Entity entity) const {
+			return static_cast<T*>(getComponent(entity, ktw::ComponentRegistry::getId<T>()));
+		}
+
+		// function(T&... components) for every entity having all of T
+		template<typename... T, typename F>
+		void each(F&& function) {
+			eachChunk<T...>([&](uint32_t count, const ktw::Entity*, T*... columns) {
+				for(uint32_t i = 0; i < count; i++) {
+					function(columns[i]...);
+				}
+			});
+		}
+		// function(count, entities, T*... columns) once per chunk, for batched or SIMD systems
+		template<typename... T, typename F>
+		void eachChunk(F&& function) {
+			ComponentMask mask = getMask<T...>();
+			for(auto& archetype : archetypes) {
+				if((archetype->mask & mask) != mask) {
+					continue;
+				}
+				for(auto& chunk : archetype->chunks) {
+					function(chunk.count, archetype->getEntities(chunk), archetype->getColumn<T>(chunk)...);
+				}
+			}
+		}
+
+	private:
+		struct EntityRecord {
+			ktw::Archetype* archetype;
+			uint32_t chunk;
+			uint32_t row;
+			uint32_t generation;
+		};
+
+		ChunkAllocator chunkAllocator;
+		std::vector<std::unique_ptr<ktw::Archetype>> archetypes;
+		std::unordered_map<ComponentMask, ktw::Archetype*> archetypesByMask;
+		std::vector<EntityRecord> records;
+		std::vector<uint32_t> freeIndices;
+		uint32_t entityCount = 0;
+
+		template<typename... T>
+		static ComponentMask getMask() {
+			ComponentMask mask;
+			(mask.set(ktw::ComponentRegistry::getId<T>()), ...);
+			return mask;
+		}
+
+		ktw::Archetype* getArchetype(const ComponentMask& mask);
+		ktw::Entity createIn(ktw::Archetype* archetype);
+		void* addComponent(ktw::Entity entity, uint32_t componentId);
+		void removeComponent(ktw::Entity entity, uint32_t componentId);
+		void* getComponent(ktw::Entity entity, uint32_t componentId) const;
+		void insertRow(ktw::Entity entity, ktw::Archetype* archetype);
+		void removeRow(const EntityRecord& record);
+		void moveEntity(ktw::Entity entity, ktw::Archetype* to);
+		const EntityRecord& getRecord(ktw::Entity entity) const;
+	};
+}
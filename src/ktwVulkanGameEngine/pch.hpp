@@ -12,5 +12,6 @@
 #include <chrono>
 #include <fstream>
 #include <streambuf>
+#include <mutex>
 
 #include "Log.hpp"
\ No newline at end of file
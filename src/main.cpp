@@ -1,10 +1,13 @@
 #include <iostream>
 
 #include <ktwVulkanGameEngine/ktwVulkanGameEngine.hpp>
+#include <ktwVulkanGameEngine/EmbeddedShaders.hpp>
+#include <ktwVulkanGameEngine/MeshOptimizer.hpp>
+#include <ktwVulkanGameEngine/Quantization.hpp>
 
 struct Vertex {
 	glm::vec2 pos;
-	glm::vec3 color;
+	uint32_t color;
 };
 
 struct UniformBufferObject {
@@ -19,8 +22,7 @@ public:
 
 private:
 	ktw::GraphicsPipeline* graphicsPipeline;
-	ktw::Buffer* vertexBuffer;
-	ktw::Buffer* indexBuffer;
+	ktw::Mesh* mesh;
 
 	// std::vector<Vertex> vertices = {
 	// 	{{0.0f, -0.5f}, {1.0f, 1.0f, 1.0f}},
@@ -42,51 +44,50 @@ private:
 
 	void userSetup(ktw::Renderer& renderer) override {
 
-		vertices.push_back({{0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}});
-		vertices.push_back({{0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}});
+		uint32_t white = ktw::packColor(glm::vec3(1.0f, 1.0f, 1.0f));
+		uint32_t red = ktw::packColor(glm::vec3(1.0f, 0.0f, 0.0f));
+		vertices.push_back({{0.0f, 0.0f}, white});
+		vertices.push_back({{0.5f, 0.0f}, red});
 		for(int i=0; i<=360; i++) {
 			float angle = i*3.141593f/180;
-			vertices.push_back({{0.5f*glm::cos(angle), 0.5f*glm::sin(angle)}, {1.0f, 0.0f, 0.0f}});
+			vertices.push_back({{0.5f*glm::cos(angle), 0.5f*glm::sin(angle)}, red});
 			indices.push_back(0);
 			indices.push_back(i+1);
 			indices.push_back(i+2);
 		}
 
+		// Reordered once at creation, as an asset bake would do
+		size_t vertexCount = vertices.size();
+		auto report = ktw::MeshOptimizer::optimize(indices, vertices.data(), vertexCount, sizeof(Vertex), offsetof(Vertex, pos), 2);
+		vertices.resize(vertexCount);
+		LOG_INFO("Disc optimized: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+
+		mesh = renderer.createMesh({0, sizeof(Vertex), {
+			{0, ktw::Format::eFloat2, offsetof(Vertex, pos)},
+			{1, ktw::Format::eUByte4Norm, offsetof(Vertex, color)}
+		}}, vertices.data(), vertices.size(), indices);
+
+		// Reflection only sees the vec3 the shader reads, so the packed color
+		// needs the mesh layout to be passed explicitly
 		graphicsPipeline = renderer.createGraphicsPipeline(
 			getSwapchain(),
-			"shaders\\shader.vert",
-			"shaders\\shader.frag",
-			{{
-				0,
-				sizeof(Vertex),
-				{
-					{0, ktw::Format::eFloat2, offsetof(Vertex, pos)},
-					{1, ktw::Format::eFloat3, offsetof(Vertex, color)}
-				}
-			}},
-			{
-				// {
-				// 	0,
-				// 	ktw::ShaderStage::eVertex
-				// }
-			}
+			ktw::ShaderSource(ktw::shaders::shader_vert, ktw::shaders::shader_vert_source),
+			ktw::ShaderSource(ktw::shaders::shader_frag, ktw::shaders::shader_frag_source),
+			{mesh->getVertexBufferBinding()},
+			{}
 		);
-		vertexBuffer = renderer.createVertexBuffer(sizeof(Vertex), vertices.size(), vertices.data());
-		indexBuffer = renderer.createIndexBuffer(indices.size(), indices.data());
+
+		getWorld().create(ktw::Transform(), ktw::Renderable{mesh, graphicsPipeline});
 	}
 
 	void userUpdate(ktw::Renderer& renderer) override {
 		renderer.startCommandBuffer()
-			.bindPipeline(graphicsPipeline)
-			.bindVertexBuffer(vertexBuffer)
-			.bindIndexBuffer(indexBuffer)
-			.drawIndexed(indexBuffer->getCount())
+			.drawRenderables(getWorld())
 			.end();
 	}
 
 	void userCleanup(ktw::Renderer& renderer) override {
-		delete vertexBuffer;
-		delete indexBuffer;
+		delete mesh;
 		delete graphicsPipeline;
 	}
 };
@@ -0,0 +1,250 @@
+// Benchmark of ktw::DynamicBvh against brute force scans as the scene grows.
+//
+//   BvhBenchmark [maxObjectCount]
+//
+// For 1000, 10000... up to maxObjectCount boxes (1M by default) spread at a
+// constant density, times building the tree, moving a tenth of the boxes a
+// little, and three queries, both through the tree and by testing every
+// box: a camera frustum, 1000 ray casts from the camera (closest hit, as
+// picking does) and 1000 neighborhood spheres. Brute force and tree results
+// are checked against each other, along with axis parallel rays starting on
+// a box face.
+
+#include <ktwVulkanGameEngine/DynamicBvh.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	const uint32_t queryCount = 1000;
+	const float neighborhoodRadius = 10.0f;
+
+	double measure(const std::function<void()>& function) {
+		auto start = std::chrono::steady_clock::now();
+		function();
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	// Entry distance of the ray into the box, negative when missed. Axis
+	// parallel rays are tested by position rather than through the tree's
+	// slab arithmetic, so the two check each other.
+	float rayDistance(const ktw::Aabb& bounds, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+		float enter = 0.0f;
+		float exit = maxDistance;
+		for(int axis = 0; axis < 3; axis++) {
+			if(std::isinf(inverseDirection[axis])) {
+				if(origin[axis] < bounds.min[axis] || origin[axis] > bounds.max[axis]) {
+					return -1.0f;
+				}
+				continue;
+			}
+			float t1 = (bounds.min[axis] - origin[axis]) * inverseDirection[axis];
+			float t2 = (bounds.max[axis] - origin[axis]) * inverseDirection[axis];
+			enter = std::max(enter, std::min(t1, t2));
+			exit = std::min(exit, std::max(t1, t2));
+		}
+		return enter <= exit ? enter : -1.0f;
+	}
+
+	bool inFrustum(const ktw::Frustum& frustum, const ktw::Aabb& bounds) {
+		glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+		glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+		for(const auto& plane : frustum.planes) {
+			if(glm::dot(glm::vec3(plane), center) + plane.w < -glm::dot(glm::abs(glm::vec3(plane)), extent)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool inSphere(const glm::vec3& center, float radius, const ktw::Aabb& bounds) {
+		glm::vec3 offset = glm::clamp(center, bounds.min, bounds.max) - center;
+		return glm::dot(offset, offset) <= radius * radius;
+	}
+
+	bool run(uint32_t objectCount) {
+		std::mt19937 random(objectCount);
+		// Constant density, about one box per 1000 cubic units
+		float halfSide = 5.0f * std::cbrt(static_cast<float>(objectCount));
+		std::uniform_real_distribution<float> position(-halfSide, halfSide);
+		std::uniform_real_distribution<float> size(0.5f, 3.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		std::vector<ktw::Aabb> boxes(objectCount);
+		for(auto& box : boxes) {
+			glm::vec3 center(position(random), position(random), position(random));
+			glm::vec3 extent(size(random), size(random), size(random));
+			box = {center - extent, center + extent};
+		}
+
+		ktw::DynamicBvh bvh;
+		std::vector<uint32_t> leaves(objectCount);
+		double buildTime = measure([&]() {
+			for(uint32_t i = 0; i < objectCount; i++) {
+				leaves[i] = bvh.insert(boxes[i], i);
+			}
+		});
+
+		// A tenth of the boxes move as much as in a frame, most stay in their fat bounds
+		uint32_t reinserted = 0;
+		double moveTime = measure([&]() {
+			for(uint32_t i = 0; i < objectCount; i += 10) {
+				glm::vec3 displacement = glm::vec3(unit(random), unit(random), unit(random)) * 0.05f;
+				boxes[i] = {boxes[i].min + displacement, boxes[i].max + displacement};
+				reinserted += bvh.move(leaves[i], boxes[i], displacement);
+			}
+		});
+
+		glm::vec3 eye(0.0f);
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+		glm::mat4 view = glm::lookAt(eye, glm::vec3(0.3f, 0.1f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		ktw::Frustum frustum(projection * view);
+
+		std::vector<uint32_t> treeVisible, bruteVisible;
+		double treeFrustumTime = measure([&]() {
+			bvh.queryFrustum(frustum, treeVisible);
+		});
+		double bruteFrustumTime = measure([&]() {
+			for(uint32_t i = 0; i < objectCount; i++) {
+				if(inFrustum(frustum, boxes[i])) {
+					bruteVisible.push_back(i);
+				}
+			}
+		});
+
+		std::vector<glm::vec3> directions(queryCount);
+		for(auto& direction : directions) {
+			direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)));
+		}
+		std::vector<uint32_t> treeHits(queryCount), bruteHits(queryCount);
+		double treeRayTime = measure([&]() {
+			for(uint32_t r = 0; r < queryCount; r++) {
+				glm::vec3 inverseDirection = 1.0f / directions[r];
+				treeHits[r] = bvh.rayCast(eye, directions[r], 1000.0f, [&](uint32_t object, float maxDistance) {
+					return rayDistance(boxes[object], eye, inverseDirection, maxDistance);
+				});
+			}
+		});
+		double bruteRayTime = measure([&]() {
+			for(uint32_t r = 0; r < queryCount; r++) {
+				glm::vec3 inverseDirection = 1.0f / directions[r];
+				float closest = 1000.0f;
+				bruteHits[r] = ktw::DynamicBvh::nullNode;
+				for(uint32_t i = 0; i < objectCount; i++) {
+					float distance = rayDistance(boxes[i], eye, inverseDirection, closest);
+					if(distance >= 0.0f) {
+						closest = distance;
+						bruteHits[r] = i;
+					}
+				}
+			}
+		});
+
+		// Straight down rays starting on the x plane of a leaf's fat bounds, where
+		// the slab test multiplies 0 by an infinite inverse. Hits are tested
+		// against the fat bounds, the ones the tree traverses, so the leaf's
+		// box is hit at distance 1 unless something is closer.
+		bool parallelMatch = true;
+		uint32_t parallelHits = 0;
+		glm::vec3 down(0.0f, -1.0f, 0.0f);
+		glm::vec3 inverseDown = 1.0f / down;
+		for(uint32_t r = 0; r < queryCount; r++) {
+			const ktw::Aabb& target = bvh.getFatBounds(leaves[r * (objectCount / queryCount)]);
+			glm::vec3 origin(target.min.x, target.max.y + 1.0f, (target.min.z + target.max.z) * 0.5f);
+			auto fatDistance = [&](uint32_t object, float maxDistance) {
+				return rayDistance(bvh.getFatBounds(leaves[object]), origin, inverseDown, maxDistance);
+			};
+			uint32_t treeHit = bvh.rayCast(origin, down, 1000.0f, fatDistance);
+			float closest = 1000.0f;
+			uint32_t bruteHit = ktw::DynamicBvh::nullNode;
+			for(uint32_t i = 0; i < objectCount; i++) {
+				float distance = fatDistance(i, closest);
+				if(distance >= 0.0f) {
+					closest = distance;
+					bruteHit = i;
+				}
+			}
+			parallelHits += treeHit != ktw::DynamicBvh::nullNode;
+			if(bruteHit == ktw::DynamicBvh::nullNode || treeHit == ktw::DynamicBvh::nullNode) {
+				parallelMatch &= treeHit == bruteHit;
+			}
+			else {
+				parallelMatch &= fatDistance(treeHit, 1000.0f) == closest;
+			}
+		}
+
+		std::vector<glm::vec3> centers(queryCount);
+		for(auto& center : centers) {
+			center = glm::vec3(position(random), position(random), position(random));
+		}
+		size_t treeNeighbors = 0, bruteNeighbors = 0;
+		bool neighborsMatch = true;
+		std::vector<uint32_t> found;
+		double treeSphereTime = measure([&]() {
+			for(const auto& center : centers) {
+				found.clear();
+				bvh.querySphere(center, neighborhoodRadius, found);
+				// Fat bounds give a superset, the exact test is part of the query
+				for(uint32_t object : found) {
+					treeNeighbors += inSphere(center, neighborhoodRadius, boxes[object]);
+				}
+			}
+		});
+		double bruteSphereTime = measure([&]() {
+			for(const auto& center : centers) {
+				for(uint32_t i = 0; i < objectCount; i++) {
+					bruteNeighbors += inSphere(center, neighborhoodRadius, boxes[i]);
+				}
+			}
+		});
+		neighborsMatch = treeNeighbors == bruteNeighbors;
+
+		// Fat bounds contain the exact ones, so the tree sees at least what brute force sees
+		std::sort(treeVisible.begin(), treeVisible.end());
+		bool visibleMatch = std::includes(treeVisible.begin(), treeVisible.end(), bruteVisible.begin(), bruteVisible.end());
+		// Boxes hit at the same distance may be reported in either order
+		bool hitsMatch = true;
+		for(uint32_t r = 0; r < queryCount; r++) {
+			if((treeHits[r] == ktw::DynamicBvh::nullNode) != (bruteHits[r] == ktw::DynamicBvh::nullNode)) {
+				hitsMatch = false;
+			}
+			else if(treeHits[r] != ktw::DynamicBvh::nullNode) {
+				glm::vec3 inverseDirection = 1.0f / directions[r];
+				hitsMatch &= rayDistance(boxes[treeHits[r]], eye, inverseDirection, 1000.0f) == rayDistance(boxes[bruteHits[r]], eye, inverseDirection, 1000.0f);
+			}
+		}
+
+		std::printf("%8u objects, height %2u, build %9.3f ms, move %8.3f ms (%u reinserted)\n", objectCount, bvh.getHeight(), buildTime, moveTime, reinserted);
+		std::printf("  frustum       tree %9.3f ms  brute %9.3f ms  %7.1fx  %zu visible\n", treeFrustumTime, bruteFrustumTime, bruteFrustumTime / treeFrustumTime, bruteVisible.size());
+		std::printf("  %u rays     tree %9.3f ms  brute %9.3f ms  %7.1fx\n", queryCount, treeRayTime, bruteRayTime, bruteRayTime / treeRayTime);
+		std::printf("  %u axis parallel rays from a slab plane, %u hits\n", queryCount, parallelHits);
+		std::printf("  %u spheres  tree %9.3f ms  brute %9.3f ms  %7.1fx  %zu neighbors\n", queryCount, treeSphereTime, bruteSphereTime, bruteSphereTime / treeSphereTime, bruteNeighbors);
+
+		if(!visibleMatch || !hitsMatch || !parallelMatch || !neighborsMatch) {
+			std::fprintf(stderr, "tree and brute force results differ\n");
+			return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv) {
+	uint32_t maxObjectCount = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 1000000;
+
+	for(uint32_t objectCount = 1000; objectCount <= maxObjectCount; objectCount *= 10) {
+		if(!run(objectCount)) {
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,98 @@
+// Microbenchmark of ktw::FrustumCuller.
+//
+//   CullingBenchmark [objectCount] [iterations]
+//
+// Scatters objectCount spheres (1M by default) in a cube around a camera
+// and times culling them against its frustum with each instruction set the
+// CPU supports, on one thread and then split over the job system. The best
+// time of the iterations is reported, along with the visible count, which
+// has to be the same for every run.
+
+#include <ktwVulkanGameEngine/FrustumCuller.hpp>
+#include <ktwVulkanGameEngine/JobSystem.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	const char* name(ktw::FrustumCuller::InstructionSet instructionSet) {
+		switch(instructionSet) {
+		case ktw::FrustumCuller::InstructionSet::eAVX2:
+			return "AVX2";
+		case ktw::FrustumCuller::InstructionSet::eSSE:
+			return "SSE";
+		default:
+			return "scalar";
+		}
+	}
+
+	// Best time in milliseconds, the visible count of the last iteration in visibleCount
+	double measure(ktw::FrustumCuller& culler, const ktw::Frustum& frustum, ktw::JobSystem* jobSystem, uint32_t iterations, size_t& visibleCount) {
+		std::vector<uint32_t> visible;
+		visible.reserve(culler.size());
+		double best = 1e30;
+		for(uint32_t i = 0; i < iterations; i++) {
+			visible.clear();
+			auto start = std::chrono::steady_clock::now();
+			culler.cull(frustum, visible, jobSystem);
+			auto end = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		visibleCount = visible.size();
+		return best;
+	}
+}
+
+int main(int argc, char** argv) {
+	uint32_t objectCount = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 1000000;
+	uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 50;
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.5f, 5.0f);
+	ktw::FrustumCuller culler;
+	culler.resize(objectCount);
+	for(uint32_t i = 0; i < objectCount; i++) {
+		culler.set(i, glm::vec3(position(random), position(random), position(random)), size(random));
+	}
+
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 400.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.3f, 0.1f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	ktw::Frustum frustum(projection * view);
+
+	ktw::JobSystem jobSystem;
+	std::printf("%u objects, best of %u, %u workers\n", objectCount, iterations, jobSystem.getWorkerCount());
+
+	size_t expected = 0;
+	double scalarTime = 0.0;
+	bool mismatch = false;
+	auto supported = ktw::FrustumCuller::getSupportedInstructionSet();
+	for(int level = 0; level <= static_cast<int>(supported); level++) {
+		auto instructionSet = static_cast<ktw::FrustumCuller::InstructionSet>(level);
+		culler.setInstructionSet(instructionSet);
+		for(ktw::JobSystem* jobs : {static_cast<ktw::JobSystem*>(nullptr), &jobSystem}) {
+			size_t visibleCount;
+			double time = measure(culler, frustum, jobs, iterations, visibleCount);
+			if(level == 0 && !jobs) {
+				expected = visibleCount;
+				scalarTime = time;
+			}
+			mismatch |= visibleCount != expected;
+			std::printf("%-7s %-9s %8.3f ms  %6.1fx  %zu visible\n", name(instructionSet), jobs ? "parallel" : "1 thread", time, scalarTime / time, visibleCount);
+		}
+	}
+
+	if(mismatch) {
+		std::fprintf(stderr, "visible counts differ between runs\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,833 @@
+// Offline converter from OBJ and glTF 2.0 (.gltf/.glb) to the .ktwmesh
+// format loaded by ktw::Mesh.
+//
+//   MeshConverter [--no-optimize] [--no-lods] [--compact] input.obj|input.gltf|input.glb output.ktwmesh
+//
+// Vertices are written interleaved: position (location 0), then normal
+// (location 1) and texture coordinates (location 2) when the source has
+// them. Each OBJ material group or glTF triangle primitive becomes a
+// submesh. glTF node transforms are not applied. Unless --no-optimize is
+// given, each submesh goes through ktw::MeshOptimizer and the vertex cache
+// statistics are printed before and after. The triangles of each submesh are
+// then grouped into meshlets (ktw::MeshletBuilder) for GPU culling, and unless
+// --no-lods is given, simplified into a chain of levels of detail
+// (ktw::MeshSimplifier) stored as extra index ranges. --compact
+// stores half float positions and UVs and 10:10:10:2 normals, 16 bytes per
+// vertex instead of 32, and refuses meshes outside the half float range.
+
+#include <ktwVulkanGameEngine/MeshFormat.hpp>
+#include <ktwVulkanGameEngine/MeshOptimizer.hpp>
+#include <ktwVulkanGameEngine/MeshletBuilder.hpp>
+#include <ktwVulkanGameEngine/MeshSimplifier.hpp>
+#include <ktwVulkanGameEngine/Quantization.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+	// VkFormat values, the converter does not depend on the Vulkan headers
+	const uint32_t formatFloat2 = 103; // VK_FORMAT_R32G32_SFLOAT
+	const uint32_t formatFloat3 = 106; // VK_FORMAT_R32G32B32_SFLOAT
+	const uint32_t formatHalf2 = 83; // VK_FORMAT_R16G16_SFLOAT
+	const uint32_t formatHalf4 = 97; // VK_FORMAT_R16G16B16A16_SFLOAT
+	const uint32_t formatInt1010102Norm = 65; // VK_FORMAT_A2B10G10R10_SNORM_PACK32
+
+	struct Vertex {
+		float position[3] = {0.0f, 0.0f, 0.0f};
+		float normal[3] = {0.0f, 0.0f, 0.0f};
+		float uv[2] = {0.0f, 0.0f};
+	};
+
+	struct SourceSubmesh {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		uint32_t materialIndex = 0;
+		// Index ranges local to the submesh
+		std::vector<ktw::Meshlet> meshlets;
+		// Levels 1 and up, over the same vertices
+		std::vector<ktw::SimplifiedLod> lods;
+	};
+
+	struct SourceMesh {
+		std::vector<SourceSubmesh> submeshes;
+		bool hasNormals = false;
+		bool hasUVs = false;
+	};
+
+	std::vector<uint8_t> readFile(const std::filesystem::path& path) {
+		std::ifstream file(path, std::ios::binary);
+		if(!file) {
+			throw std::runtime_error("failed to open file: " + path.string());
+		}
+		return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	/////////////////////////////////////////
+	// OBJ
+	/////////////////////////////////////////
+
+	SourceMesh loadObj(const std::filesystem::path& path) {
+		std::ifstream file(path);
+		if(!file) {
+			throw std::runtime_error("failed to open file: " + path.string());
+		}
+
+		std::vector<std::array<float, 3>> positions;
+		std::vector<std::array<float, 3>> normals;
+		std::vector<std::array<float, 2>> uvs;
+		std::map<std::string, uint32_t> materials;
+
+		SourceMesh mesh;
+		mesh.submeshes.emplace_back();
+		// One vertex per distinct position/uv/normal triplet of the current submesh
+		std::map<std::tuple<int, int, int>, uint32_t> vertexIndices;
+
+		auto resolve = [](int index, size_t count) {
+			// OBJ indices are 1-based, negative ones count from the end
+			return index > 0 ? index - 1 : static_cast<int>(count) + index;
+		};
+
+		std::string line;
+		while(std::getline(file, line)) {
+			std::istringstream stream(line);
+			std::string keyword;
+			stream >> keyword;
+
+			if(keyword == "v") {
+				std::array<float, 3> p{};
+				stream >> p[0] >> p[1] >> p[2];
+				positions.push_back(p);
+			}
+			else if(keyword == "vn") {
+				std::array<float, 3> n{};
+				stream >> n[0] >> n[1] >> n[2];
+				normals.push_back(n);
+			}
+			else if(keyword == "vt") {
+				std::array<float, 2> t{};
+				stream >> t[0] >> t[1];
+				// OBJ has v going up, Vulkan samples with v going down
+				t[1] = 1.0f - t[1];
+				uvs.push_back(t);
+			}
+			else if(keyword == "usemtl") {
+				std::string name;
+				stream >> name;
+				uint32_t materialIndex = materials.emplace(name, static_cast<uint32_t>(materials.size())).first->second;
+				if(!mesh.submeshes.back().indices.empty()) {
+					mesh.submeshes.emplace_back();
+					vertexIndices.clear();
+				}
+				mesh.submeshes.back().materialIndex = materialIndex;
+			}
+			else if(keyword == "f") {
+				std::vector<uint32_t> face;
+				std::string corner;
+				while(stream >> corner) {
+					int v = 0, t = 0, n = 0;
+					if(sscanf(corner.c_str(), "%d/%d/%d", &v, &t, &n) != 3 && sscanf(corner.c_str(), "%d//%d", &v, &n) != 2 && sscanf(corner.c_str(), "%d/%d", &v, &t) != 2) {
+						sscanf(corner.c_str(), "%d", &v);
+					}
+					v = resolve(v, positions.size());
+					t = t != 0 ? resolve(t, uvs.size()) : -1;
+					n = n != 0 ? resolve(n, normals.size()) : -1;
+					if(v < 0 || v >= static_cast<int>(positions.size()) || t >= static_cast<int>(uvs.size()) || n >= static_cast<int>(normals.size())) {
+						throw std::runtime_error(path.string() + ": face index out of range");
+					}
+
+					auto& submesh = mesh.submeshes.back();
+					auto [it, inserted] = vertexIndices.emplace(std::make_tuple(v, t, n), static_cast<uint32_t>(submesh.vertices.size()));
+					if(inserted) {
+						Vertex vertex;
+						std::copy(positions[v].begin(), positions[v].end(), vertex.position);
+						if(t >= 0) {
+							std::copy(uvs[t].begin(), uvs[t].end(), vertex.uv);
+							mesh.hasUVs = true;
+						}
+						if(n >= 0) {
+							std::copy(normals[n].begin(), normals[n].end(), vertex.normal);
+							mesh.hasNormals = true;
+						}
+						submesh.vertices.push_back(vertex);
+					}
+					face.push_back(it->second);
+				}
+
+				// Polygons are triangulated as fans
+				for(size_t i = 2; i < face.size(); i++) {
+					mesh.submeshes.back().indices.insert(mesh.submeshes.back().indices.end(), {face[0], face[i - 1], face[i]});
+				}
+			}
+		}
+
+		mesh.submeshes.erase(std::remove_if(mesh.submeshes.begin(), mesh.submeshes.end(), [](const SourceSubmesh& submesh) {
+			return submesh.indices.empty();
+		}), mesh.submeshes.end());
+		return mesh;
+	}
+
+	/////////////////////////////////////////
+	// JSON (just enough for glTF)
+	/////////////////////////////////////////
+
+	struct Json {
+		enum Type { eNull, eBool, eNumber, eString, eArray, eObject } type = eNull;
+		double number = 0.0;
+		std::string string;
+		std::vector<Json> array;
+		std::map<std::string, Json> object;
+
+		const Json& operator[](const std::string& key) const {
+			static const Json null;
+			auto it = object.find(key);
+			return it == object.end() ? null : it->second;
+		}
+
+		const Json& operator[](size_t index) const {
+			static const Json null;
+			return index < array.size() ? array[index] : null;
+		}
+
+		bool has(const std::string& key) const {
+			return object.count(key) > 0;
+		}
+
+		size_t asIndex() const {
+			return static_cast<size_t>(number);
+		}
+	};
+
+	class JsonParser {
+	public:
+		JsonParser(const char* begin, const char* end) : current(begin), end(end) {}
+
+		Json parse() {
+			Json value = parseValue();
+			skipSpaces();
+			if(current != end) {
+				fail("trailing characters");
+			}
+			return value;
+		}
+
+	private:
+		const char* current;
+		const char* end;
+
+		[[noreturn]] void fail(const std::string& message) {
+			throw std::runtime_error("invalid glTF JSON: " + message);
+		}
+
+		void skipSpaces() {
+			while(current != end && (*current == ' ' || *current == '\t' || *current == '\n' || *current == '\r')) {
+				current++;
+			}
+		}
+
+		void expect(char c) {
+			skipSpaces();
+			if(current == end || *current != c) {
+				fail(std::string("expected '") + c + "'");
+			}
+			current++;
+		}
+
+		Json parseValue() {
+			skipSpaces();
+			if(current == end) {
+				fail("unexpected end");
+			}
+
+			Json value;
+			if(*current == '{') {
+				value.type = Json::eObject;
+				current++;
+				skipSpaces();
+				if(current != end && *current == '}') {
+					current++;
+					return value;
+				}
+				do {
+					skipSpaces();
+					std::string key = parseString();
+					expect(':');
+					value.object[key] = parseValue();
+					skipSpaces();
+				} while(current != end && *current == ',' && current++);
+				expect('}');
+			}
+			else if(*current == '[') {
+				value.type = Json::eArray;
+				current++;
+				skipSpaces();
+				if(current != end && *current == ']') {
+					current++;
+					return value;
+				}
+				do {
+					value.array.push_back(parseValue());
+					skipSpaces();
+				} while(current != end && *current == ',' && current++);
+				expect(']');
+			}
+			else if(*current == '"') {
+				value.type = Json::eString;
+				value.string = parseString();
+			}
+			else if(end - current >= 4 && strncmp(current, "true", 4) == 0) {
+				value.type = Json::eBool;
+				value.number = 1.0;
+				current += 4;
+			}
+			else if(end - current >= 5 && strncmp(current, "false", 5) == 0) {
+				value.type = Json::eBool;
+				current += 5;
+			}
+			else if(end - current >= 4 && strncmp(current, "null", 4) == 0) {
+				current += 4;
+			}
+			else {
+				value.type = Json::eNumber;
+				const char* start = current;
+				while(current != end && (isdigit(*current) || *current == '-' || *current == '+' || *current == '.' || *current == 'e' || *current == 'E')) {
+					current++;
+				}
+				if(start == current) {
+					fail("unexpected character");
+				}
+				value.number = std::stod(std::string(start, current));
+			}
+			return value;
+		}
+
+		std::string parseString() {
+			if(current == end || *current != '"') {
+				fail("expected a string");
+			}
+			current++;
+
+			std::string result;
+			while(current != end && *current != '"') {
+				if(*current == '\\' && current + 1 != end) {
+					current++;
+					switch(*current) {
+						case 'n': result += '\n'; break;
+						case 't': result += '\t'; break;
+						case 'r': result += '\r'; break;
+						case 'b': result += '\b'; break;
+						case 'f': result += '\f'; break;
+						// Names only, non-ASCII escapes are kept as a placeholder
+						case 'u': result += '?'; current += std::min<ptrdiff_t>(4, end - current - 1); break;
+						default: result += *current; break;
+					}
+				}
+				else {
+					result += *current;
+				}
+				current++;
+			}
+			if(current == end) {
+				fail("unterminated string");
+			}
+			current++;
+			return result;
+		}
+	};
+
+	/////////////////////////////////////////
+	// glTF
+	/////////////////////////////////////////
+
+	std::vector<uint8_t> decodeBase64(const std::string& text) {
+		auto decode = [](char c) -> int {
+			if(c >= 'A' && c <= 'Z') return c - 'A';
+			if(c >= 'a' && c <= 'z') return c - 'a' + 26;
+			if(c >= '0' && c <= '9') return c - '0' + 52;
+			if(c == '+') return 62;
+			if(c == '/') return 63;
+			return -1;
+		};
+
+		std::vector<uint8_t> result;
+		uint32_t bits = 0;
+		int bitCount = 0;
+		for(char c : text) {
+			int value = decode(c);
+			if(value < 0) {
+				continue;
+			}
+			bits = (bits << 6) | value;
+			bitCount += 6;
+			if(bitCount >= 8) {
+				bitCount -= 8;
+				result.push_back(static_cast<uint8_t>((bits >> bitCount) & 0xFF));
+			}
+		}
+		return result;
+	}
+
+	class Gltf {
+	public:
+		Gltf(const std::filesystem::path& path) {
+			std::vector<uint8_t> file = readFile(path);
+			std::vector<uint8_t> binaryChunk;
+
+			if(file.size() >= 12 && memcmp(file.data(), "glTF", 4) == 0) {
+				// GLB: 12 byte header, then a JSON chunk and an optional BIN chunk
+				size_t offset = 12;
+				while(offset + 8 <= file.size()) {
+					uint32_t chunkLength, chunkType;
+					memcpy(&chunkLength, file.data() + offset, 4);
+					memcpy(&chunkType, file.data() + offset + 4, 4);
+					offset += 8;
+					if(offset + chunkLength > file.size()) {
+						throw std::runtime_error(path.string() + ": truncated GLB chunk");
+					}
+					if(chunkType == 0x4E4F534A) {
+						json = JsonParser(reinterpret_cast<const char*>(file.data() + offset), reinterpret_cast<const char*>(file.data() + offset + chunkLength)).parse();
+					}
+					else if(chunkType == 0x004E4942) {
+						binaryChunk.assign(file.begin() + offset, file.begin() + offset + chunkLength);
+					}
+					offset += chunkLength;
+				}
+			}
+			else {
+				json = JsonParser(reinterpret_cast<const char*>(file.data()), reinterpret_cast<const char*>(file.data() + file.size())).parse();
+			}
+
+			for(auto& buffer : json["buffers"].array) {
+				if(!buffer.has("uri")) {
+					buffers.push_back(binaryChunk);
+				}
+				else if(buffer["uri"].string.rfind("data:", 0) == 0) {
+					const std::string& uri = buffer["uri"].string;
+					buffers.push_back(decodeBase64(uri.substr(uri.find(',') + 1)));
+				}
+				else {
+					buffers.push_back(readFile(path.parent_path() / buffer["uri"].string));
+				}
+			}
+		}
+
+		SourceMesh load() {
+			SourceMesh mesh;
+			for(auto& gltfMesh : json["meshes"].array) {
+				for(auto& primitive : gltfMesh["primitives"].array) {
+					if(primitive.has("mode") && primitive["mode"].number != 4) {
+						std::cerr << "Skipping a non-triangle primitive" << std::endl;
+						continue;
+					}
+
+					auto& attributes = primitive["attributes"];
+					if(!attributes.has("POSITION")) {
+						continue;
+					}
+
+					SourceSubmesh submesh;
+					submesh.materialIndex = primitive.has("material") ? static_cast<uint32_t>(primitive["material"].number) : 0;
+
+					std::vector<float> positions = readFloats(attributes["POSITION"].asIndex(), 3);
+					submesh.vertices.resize(positions.size() / 3);
+					for(size_t i = 0; i < submesh.vertices.size(); i++) {
+						std::copy(&positions[i * 3], &positions[i * 3] + 3, submesh.vertices[i].position);
+					}
+					if(attributes.has("NORMAL")) {
+						std::vector<float> normals = readFloats(attributes["NORMAL"].asIndex(), 3);
+						for(size_t i = 0; i < submesh.vertices.size() && i * 3 + 2 < normals.size(); i++) {
+							std::copy(&normals[i * 3], &normals[i * 3] + 3, submesh.vertices[i].normal);
+						}
+						mesh.hasNormals = true;
+					}
+					if(attributes.has("TEXCOORD_0")) {
+						std::vector<float> uvs = readFloats(attributes["TEXCOORD_0"].asIndex(), 2);
+						for(size_t i = 0; i < submesh.vertices.size() && i * 2 + 1 < uvs.size(); i++) {
+							std::copy(&uvs[i * 2], &uvs[i * 2] + 2, submesh.vertices[i].uv);
+						}
+						mesh.hasUVs = true;
+					}
+
+					if(primitive.has("indices")) {
+						submesh.indices = readIndices(primitive["indices"].asIndex());
+					}
+					else {
+						for(uint32_t i = 0; i < submesh.vertices.size(); i++) {
+							submesh.indices.push_back(i);
+						}
+					}
+					mesh.submeshes.push_back(std::move(submesh));
+				}
+			}
+			return mesh;
+		}
+
+	private:
+		Json json;
+		std::vector<std::vector<uint8_t>> buffers;
+
+		// Returns the start of the accessor data and the distance between elements
+		const uint8_t* accessorData(const Json& accessor, size_t elementSize, size_t& stride) {
+			if(!accessor.has("bufferView")) {
+				throw std::runtime_error("sparse or empty glTF accessors are not supported");
+			}
+			auto& bufferView = json["bufferViews"][accessor["bufferView"].asIndex()];
+			auto& buffer = buffers.at(bufferView["buffer"].asIndex());
+
+			stride = bufferView.has("byteStride") ? bufferView["byteStride"].asIndex() : elementSize;
+			size_t offset = bufferView["byteOffset"].asIndex() + accessor["byteOffset"].asIndex();
+			size_t count = accessor["count"].asIndex();
+			if(count > 0 && offset + (count - 1) * stride + elementSize > buffer.size()) {
+				throw std::runtime_error("glTF accessor out of its buffer");
+			}
+			return buffer.data() + offset;
+		}
+
+		std::vector<float> readFloats(size_t accessorIndex, size_t components) {
+			auto& accessor = json["accessors"][accessorIndex];
+			if(accessor["componentType"].number != 5126) {
+				throw std::runtime_error("only float glTF vertex attributes are supported");
+			}
+
+			size_t stride;
+			const uint8_t* data = accessorData(accessor, components * sizeof(float), stride);
+			size_t count = accessor["count"].asIndex();
+
+			std::vector<float> result(count * components);
+			for(size_t i = 0; i < count; i++) {
+				memcpy(&result[i * components], data + i * stride, components * sizeof(float));
+			}
+			return result;
+		}
+
+		std::vector<uint32_t> readIndices(size_t accessorIndex) {
+			auto& accessor = json["accessors"][accessorIndex];
+			uint32_t componentType = static_cast<uint32_t>(accessor["componentType"].number);
+			size_t size = componentType == 5121 ? 1 : componentType == 5123 ? 2 : componentType == 5125 ? 4 : 0;
+			if(size == 0) {
+				throw std::runtime_error("invalid glTF index type");
+			}
+
+			size_t stride;
+			const uint8_t* data = accessorData(accessor, size, stride);
+			size_t count = accessor["count"].asIndex();
+
+			std::vector<uint32_t> result(count);
+			for(size_t i = 0; i < count; i++) {
+				uint32_t index = 0;
+				memcpy(&index, data + i * stride, size);
+				result[i] = index;
+			}
+			return result;
+		}
+	};
+
+	// Indices index the optimizer and meshlet builder arrays, a bad one would write out of them
+	void checkIndices(const SourceMesh& mesh, const std::filesystem::path& path) {
+		for(size_t i = 0; i < mesh.submeshes.size(); i++) {
+			auto& submesh = mesh.submeshes[i];
+			for(size_t j = 0; j < submesh.indices.size(); j++) {
+				if(submesh.indices[j] >= submesh.vertices.size()) {
+					throw std::runtime_error(path.string() + ": submesh " + std::to_string(i) + " index " + std::to_string(j) + " is " + std::to_string(submesh.indices[j]) + ", out of its " + std::to_string(submesh.vertices.size()) + " vertices");
+				}
+			}
+		}
+	}
+
+	/////////////////////////////////////////
+	// Optimization
+	/////////////////////////////////////////
+
+	void optimizeMesh(SourceMesh& mesh) {
+		for(size_t i = 0; i < mesh.submeshes.size(); i++) {
+			auto& submesh = mesh.submeshes[i];
+			size_t vertexCount = submesh.vertices.size();
+			auto report = ktw::MeshOptimizer::optimize(submesh.indices, submesh.vertices.data(), vertexCount, sizeof(Vertex), offsetof(Vertex, position));
+			submesh.vertices.resize(vertexCount);
+
+			std::cout << "submesh " << i << ": ACMR " << report.before.acmr << " -> " << report.after.acmr
+				<< ", ATVR " << report.before.atvr << " -> " << report.after.atvr
+				<< ", vertices " << report.vertexCountBefore << " -> " << report.vertexCountAfter << std::endl;
+		}
+	}
+
+	void buildMeshlets(SourceMesh& mesh) {
+		// Last, it reorders the triangles the optimizer left cache friendly
+		for(size_t i = 0; i < mesh.submeshes.size(); i++) {
+			auto& submesh = mesh.submeshes[i];
+			submesh.meshlets = ktw::MeshletBuilder::build(submesh.indices.data(), submesh.indices.size(), submesh.vertices.data(), submesh.vertices.size(), sizeof(Vertex), offsetof(Vertex, position));
+			size_t withCone = std::count_if(submesh.meshlets.begin(), submesh.meshlets.end(), [](const ktw::Meshlet& meshlet) {
+				return meshlet.coneCutoff < 1.0f;
+			});
+
+			std::cout << "submesh " << i << ": " << submesh.meshlets.size() << " meshlets, "
+				<< withCone << " with a normal cone" << std::endl;
+		}
+	}
+
+	void buildLods(SourceMesh& mesh) {
+		for(size_t i = 0; i < mesh.submeshes.size(); i++) {
+			auto& submesh = mesh.submeshes[i];
+			submesh.lods = ktw::MeshSimplifier::generateLods(submesh.indices.data(), submesh.indices.size(), submesh.vertices.data(), submesh.vertices.size(), sizeof(Vertex), offsetof(Vertex, position));
+
+			std::cout << "submesh " << i << ": LODs " << submesh.indices.size() / 3;
+			for(auto& lod : submesh.lods) {
+				ktw::MeshOptimizer::optimizeVertexCache(lod.indices.data(), lod.indices.size(), submesh.vertices.size());
+				std::cout << " -> " << lod.indices.size() / 3 << " (error " << lod.error << ")";
+			}
+			std::cout << " triangles" << std::endl;
+		}
+	}
+
+	/////////////////////////////////////////
+	// Output
+	/////////////////////////////////////////
+
+	void checkHalfPositions(const SourceMesh& mesh) {
+		// Half floats top out at 65504 and keep 11 significant bits, so a mesh far
+		// from the origin loses most of its detail even when it is in range
+		float boundsMin[3] = {INFINITY, INFINITY, INFINITY};
+		float boundsMax[3] = {-INFINITY, -INFINITY, -INFINITY};
+		for(auto& submesh : mesh.submeshes) {
+			for(auto& vertex : submesh.vertices) {
+				for(int c = 0; c < 3; c++) {
+					boundsMin[c] = std::min(boundsMin[c], vertex.position[c]);
+					boundsMax[c] = std::max(boundsMax[c], vertex.position[c]);
+				}
+			}
+		}
+		if(boundsMin[0] > boundsMax[0]) {
+			return;
+		}
+		float extent = 0.0f;
+		float magnitude = 0.0f;
+		for(int c = 0; c < 3; c++) {
+			extent = std::max(extent, boundsMax[c] - boundsMin[c]);
+			magnitude = std::max({magnitude, std::abs(boundsMin[c]), std::abs(boundsMax[c])});
+		}
+		if(magnitude > 65504.0f) {
+			throw std::runtime_error("--compact: position " + std::to_string(magnitude) + " is out of the half float range");
+		}
+		// Step between neighbouring halfs at the largest coordinate, warn below 8 bits across the mesh
+		float step = magnitude > 0.0f ? std::ldexp(1.0f, std::ilogb(magnitude) - 10) : 0.0f;
+		if(step > extent / 256.0f) {
+			std::cerr << "Warning: --compact keeps positions to " << step << " on an extent of " << extent
+				<< ", consider moving the mesh to the origin" << std::endl;
+		}
+	}
+
+	void writeMesh(const SourceMesh& mesh, const std::filesystem::path& path, bool compact) {
+		if(compact) {
+			checkHalfPositions(mesh);
+		}
+		uint32_t positionSize = compact ? 4 * sizeof(uint16_t) : 3 * sizeof(float);
+		uint32_t normalSize = compact ? sizeof(uint32_t) : 3 * sizeof(float);
+		uint32_t uvSize = compact ? 2 * sizeof(uint16_t) : 2 * sizeof(float);
+
+		std::vector<ktw::MeshFileAttribute> attributes = {{0, compact ? formatHalf4 : formatFloat3, 0}};
+		uint32_t stride = positionSize;
+		if(mesh.hasNormals) {
+			attributes.push_back({1, compact ? formatInt1010102Norm : formatFloat3, stride});
+			stride += normalSize;
+		}
+		if(mesh.hasUVs) {
+			attributes.push_back({2, compact ? formatHalf2 : formatFloat2, stride});
+			stride += uvSize;
+		}
+
+		ktw::MeshFileHeader header{};
+		memcpy(header.magic, ktw::meshFileMagic, sizeof(header.magic));
+		header.version = ktw::meshFileVersion;
+		header.vertexStride = stride;
+		// Indices are local to their submesh, 16 bits are enough unless a submesh has more vertices
+		bool shortIndices = std::all_of(mesh.submeshes.begin(), mesh.submeshes.end(), [](const SourceSubmesh& submesh) {
+			return submesh.vertices.size() <= 65536;
+		});
+		header.indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+		header.attributeCount = static_cast<uint32_t>(attributes.size());
+		header.submeshCount = static_cast<uint32_t>(mesh.submeshes.size());
+		std::fill(header.boundsMin, header.boundsMin + 3, mesh.submeshes.empty() ? 0.0f : INFINITY);
+		std::fill(header.boundsMax, header.boundsMax + 3, mesh.submeshes.empty() ? 0.0f : -INFINITY);
+
+		std::vector<uint8_t> vertexData;
+		std::vector<uint32_t> indexData;
+		std::vector<ktw::MeshFileSubmesh> submeshes;
+		std::vector<ktw::MeshFileMeshlet> meshlets;
+		std::vector<ktw::MeshFileLod> lods;
+		for(auto& submesh : mesh.submeshes) {
+			// Indices stay local to the submesh, vertexOffset rebases them at draw time
+			submeshes.push_back({static_cast<uint32_t>(indexData.size()), static_cast<uint32_t>(submesh.indices.size()), static_cast<int32_t>(header.vertexCount), submesh.materialIndex});
+			for(auto& meshlet : submesh.meshlets) {
+				ktw::MeshFileMeshlet fileMeshlet{};
+				std::copy(meshlet.center, meshlet.center + 3, fileMeshlet.center);
+				fileMeshlet.radius = meshlet.radius;
+				std::copy(meshlet.coneAxis, meshlet.coneAxis + 3, fileMeshlet.coneAxis);
+				fileMeshlet.coneCutoff = meshlet.coneCutoff;
+				fileMeshlet.firstIndex = static_cast<uint32_t>(indexData.size()) + meshlet.firstIndex;
+				fileMeshlet.indexCount = meshlet.indexCount;
+				fileMeshlet.vertexOffset = static_cast<int32_t>(header.vertexCount);
+				meshlets.push_back(fileMeshlet);
+			}
+			indexData.insert(indexData.end(), submesh.indices.begin(), submesh.indices.end());
+			// Coarser levels follow the full one, sharing its vertices
+			for(auto& lod : submesh.lods) {
+				lods.push_back({static_cast<uint32_t>(submeshes.size() - 1), static_cast<uint32_t>(indexData.size()), static_cast<uint32_t>(lod.indices.size()), lod.error});
+				indexData.insert(indexData.end(), lod.indices.begin(), lod.indices.end());
+			}
+
+			for(auto& vertex : submesh.vertices) {
+				size_t offset = vertexData.size();
+				vertexData.resize(offset + stride);
+				if(compact) {
+					auto position = ktw::packPosition(glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]));
+					memcpy(&vertexData[offset], position.data(), positionSize);
+				}
+				else {
+					memcpy(&vertexData[offset], vertex.position, positionSize);
+				}
+				offset += positionSize;
+				if(mesh.hasNormals) {
+					if(compact) {
+						uint32_t normal = ktw::packNormal(glm::vec3(vertex.normal[0], vertex.normal[1], vertex.normal[2]));
+						memcpy(&vertexData[offset], &normal, normalSize);
+					}
+					else {
+						memcpy(&vertexData[offset], vertex.normal, normalSize);
+					}
+					offset += normalSize;
+				}
+				if(mesh.hasUVs) {
+					if(compact) {
+						auto uv = ktw::packUV(glm::vec2(vertex.uv[0], vertex.uv[1]));
+						memcpy(&vertexData[offset], uv.data(), uvSize);
+					}
+					else {
+						memcpy(&vertexData[offset], vertex.uv, uvSize);
+					}
+				}
+				for(int c = 0; c < 3; c++) {
+					header.boundsMin[c] = std::min(header.boundsMin[c], vertex.position[c]);
+					header.boundsMax[c] = std::max(header.boundsMax[c], vertex.position[c]);
+				}
+			}
+			header.vertexCount += static_cast<uint32_t>(submesh.vertices.size());
+		}
+		header.indexCount = static_cast<uint32_t>(indexData.size());
+
+		uint64_t offset = sizeof(header) + attributes.size() * sizeof(ktw::MeshFileAttribute) + submeshes.size() * sizeof(ktw::MeshFileSubmesh);
+		header.vertexDataOffset = ktw::alignMeshFileOffset(offset);
+		header.indexDataOffset = ktw::alignMeshFileOffset(header.vertexDataOffset + vertexData.size());
+		header.meshletCount = static_cast<uint32_t>(meshlets.size());
+		header.meshletDataOffset = ktw::alignMeshFileOffset(header.indexDataOffset + header.indexCount * header.indexSize);
+		header.lodCount = static_cast<uint32_t>(lods.size());
+		header.lodDataOffset = ktw::alignMeshFileOffset(header.meshletDataOffset + meshlets.size() * sizeof(ktw::MeshFileMeshlet));
+
+		std::vector<uint16_t> shortIndexData;
+		if(shortIndices) {
+			shortIndexData.assign(indexData.begin(), indexData.end());
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		if(!file) {
+			throw std::runtime_error("failed to create file: " + path.string());
+		}
+
+		auto pad = [&](uint64_t to) {
+			static const char zeros[ktw::meshFileAlignment] = {};
+			file.write(zeros, static_cast<std::streamsize>(to - static_cast<uint64_t>(file.tellp())));
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(attributes.data()), attributes.size() * sizeof(ktw::MeshFileAttribute));
+		file.write(reinterpret_cast<const char*>(submeshes.data()), submeshes.size() * sizeof(ktw::MeshFileSubmesh));
+		pad(header.vertexDataOffset);
+		file.write(reinterpret_cast<const char*>(vertexData.data()), vertexData.size());
+		pad(header.indexDataOffset);
+		if(shortIndices) {
+			file.write(reinterpret_cast<const char*>(shortIndexData.data()), shortIndexData.size() * sizeof(uint16_t));
+		}
+		else {
+			file.write(reinterpret_cast<const char*>(indexData.data()), indexData.size() * sizeof(uint32_t));
+		}
+		pad(header.meshletDataOffset);
+		file.write(reinterpret_cast<const char*>(meshlets.data()), meshlets.size() * sizeof(ktw::MeshFileMeshlet));
+		pad(header.lodDataOffset);
+		file.write(reinterpret_cast<const char*>(lods.data()), lods.size() * sizeof(ktw::MeshFileLod));
+
+		std::cout << path.string() << ": " << header.vertexCount << " vertices, " << header.indexCount << " indices, " << header.submeshCount << " submeshes, " << header.meshletCount << " meshlets, " << header.lodCount << " levels of detail" << std::endl;
+	}
+}
+
+int main(int argc, char** argv) {
+	std::vector<std::string> arguments(argv + 1, argv + argc);
+	bool optimize = true;
+	bool compact = false;
+	bool lods = true;
+	while(!arguments.empty() && arguments[0].rfind("--", 0) == 0) {
+		if(arguments[0] == "--no-optimize") {
+			optimize = false;
+		}
+		else if(arguments[0] == "--no-lods") {
+			lods = false;
+		}
+		else if(arguments[0] == "--compact") {
+			compact = true;
+		}
+		else {
+			std::cerr << "Unknown option " << arguments[0] << std::endl;
+			return EXIT_FAILURE;
+		}
+		arguments.erase(arguments.begin());
+	}
+
+	if(arguments.size() != 2) {
+		std::cerr << "Usage: " << argv[0] << " [--no-optimize] [--no-lods] [--compact] input.obj|input.gltf|input.glb output.ktwmesh" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	try {
+		std::filesystem::path input = arguments[0];
+		std::string extension = input.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+		SourceMesh mesh;
+		if(extension == ".obj") {
+			mesh = loadObj(input);
+		}
+		else if(extension == ".gltf" || extension == ".glb") {
+			mesh = Gltf(input).load();
+		}
+		else {
+			throw std::runtime_error("unsupported input format: " + extension);
+		}
+		checkIndices(mesh, input);
+
+		if(optimize) {
+			optimizeMesh(mesh);
+		}
+		buildMeshlets(mesh);
+		if(lods) {
+			buildLods(mesh);
+		}
+		writeMesh(mesh, arguments[1], compact);
+	} catch (const std::exception& e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}